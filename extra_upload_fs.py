@@ -1,5 +1,39 @@
 Import("env")
 
+import gzip
+import os
+import shutil
+
+# The LittleFS image is built from data_dir (platformio.ini), a staging copy of data/ with
+# text assets gzip'd. The server sends the .gz files with Content-Encoding: gzip. Output
+# is deterministic (no gzip timestamp), so unchanged pages keep their ETag across uploads.
+GZIP_EXTENSIONS = (".html", ".js", ".css", ".svg", ".json")
+
+def stage_web_assets():
+    src_dir = os.path.join(env.subst("$PROJECT_DIR"), "data")
+    out_dir = env.subst("$PROJECT_DATA_DIR")
+    if os.path.realpath(out_dir) == os.path.realpath(src_dir):
+        return
+    if os.path.isdir(out_dir):
+        shutil.rmtree(out_dir)
+    for root, _, files in os.walk(src_dir):
+        rel = os.path.relpath(root, src_dir)
+        dest = os.path.normpath(os.path.join(out_dir, rel))
+        os.makedirs(dest, exist_ok=True)
+        for name in files:
+            src = os.path.join(root, name)
+            if not name.endswith(GZIP_EXTENSIONS):
+                shutil.copy2(src, os.path.join(dest, name))
+                continue
+            with open(src, "rb") as f:
+                raw = f.read()
+            with open(os.path.join(dest, name + ".gz"), "wb") as f:
+                with gzip.GzipFile(filename="", mode="wb", fileobj=f, compresslevel=9, mtime=0) as gz:
+                    gz.write(raw)
+            print("Staged %s.gz (%d -> %d bytes)" % (name, len(raw), os.path.getsize(os.path.join(dest, name + ".gz"))))
+
+stage_web_assets()
+
 def after_upload(source, target, env):
     env.Execute("pio run -t uploadfs")
 
@@ -4,20 +4,22 @@
 #include <ESPAsyncWebServer.h>
 #include <vector>
 
+#include "test/SampleRateStats.h"
+#include "test/SampleStore.h"
+#include "test/StepStats.h"
+#include "test/ThrustPid.h"
+
 #ifndef ENABLE_HEAP_LOG
 #define ENABLE_HEAP_LOG 0
 #endif
 
-struct DataPoint {
-  unsigned long timestamp;
-  float thrust;
-  int pwm;
-};
-
+// PWM steps hold pwm. Thrust-target steps ("500g - spinup - stable") have thrustTarget > 0
+// and pwm 0: a PID drives the PWM from the load cell samples for the whole step.
 struct TestStep {
   int pwm;
   unsigned long spinup_ms;
   unsigned long stable_ms;
+  float thrustTarget;
 };
 
 enum class State {
@@ -26,7 +28,8 @@ enum class State {
   PRE_TEST_TARE,
   RUNNING_SEQUENCE,
   SAFETY_SHUTDOWN,
-  TEST_FINISHED
+  TEST_FINISHED,
+  FINALIZING // streaming final results to clients across loop ticks
 };
 
 struct AppState {
@@ -45,10 +48,15 @@ struct AppState {
   bool lastEscTelemStaleNotified = false;
   unsigned long escTelemAgeMs = 0;
   unsigned long lastEscTelemWarningMs = 0;
+  uint32_t escRpm = 0; // bidirectional DShot or KISS eRPM
+  bool escRpmStale = true;
+  int escTemperatureC = 0; // KISS only
+  uint16_t escConsumedMah = 0;
 
   // PWM
   int currentPwm = 1000;
   int previousPwmForRamp = 1000;
+  ThrustPid thrustPid; // thrust-target step in progress
 
   // Simulator
   float simThrust = 0.0f;
@@ -57,13 +65,25 @@ struct AppState {
 
   // State machine / test data
   State currentState = State::IDLE;
-  std::vector<DataPoint> testResults;
+  SampleStore testResults;
   std::vector<TestStep> testSequence;
+  String testSequenceText; // raw sequence as received, recorded in the result journal
   unsigned long testStartTime = 0;
+  uint64_t testStartUs = 0; // testStartTime in microseconds
+  uint32_t testStartEpoch = 0; // wall clock from the client's start_test, 0 if not sent
   unsigned long stepStartTime = 0;
   int currentSequenceStep = 0;
   bool testResultsFullLogged = false;
   unsigned long lastTelemetryMs = 0;
+  size_t liveBatchCursor = 0; // first testResults index not yet streamed live
+  size_t finalizeCursor = 0;  // first testResults index not yet sent as a final chunk
+  unsigned long finalizeProgressMs = 0;
+  StepStats stepStats;                    // accumulator for the step in progress
+  std::vector<StepSummary> stepSummaries; // completed steps of the current/last run
+  bool stepSummariesPending = false;      // summary file not yet written for this run
+  SampleRateStats runRate;                // intervals between recorded samples, whole run
+  SampleRateStats stepRate;               // same, step in progress
+  unsigned long lastSampleRateReportMs = 0;
 
   // Safety trackers
   float lastThrustForSafetyCheck = 0.0f;
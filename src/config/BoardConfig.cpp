@@ -1,450 +1,404 @@
 #include "BoardConfig.h"
 
-#include "FS.h"
-#include "LittleFS.h"
+#include "hal/Hal.h"
 #include <Arduino.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
 
 static const char BOARD_CFG_PATH[] = "/board.cfg";
 
-static const char DEFAULT_BOARD_CFG[] PROGMEM = R"(
-# Thrust Scale Board Configuration
-# Edit and save from the Settings screen. Reboot to apply pin/ESC changes.
-
-[pins]
-# HX711 load cell data pin (GPIO)
-HX711_DOUT_PIN = 21
-# HX711 load cell clock pin (GPIO)
-HX711_SCK_PIN = 22
-# ESC PWM output pin (GPIO)
-ESC_PIN = 27
-# ESC telemetry input pin (GPIO)
-ESC_TELEM_PIN = 32
-
-[esc]
-# PWM channel for ESC (0-15)
-ESC_PWM_CHANNEL = 0
-# PWM frequency in Hz
-PWM_FREQ = 50
-# PWM resolution (bits)
-PWM_RESOLUTION = 16
-# Minimum pulse width in us (1000 typical)
-MIN_PULSE_WIDTH = 1000
-# Maximum pulse width in us (2000 typical)
-MAX_PULSE_WIDTH = 2000
-
-[safety]
-# Trigger safety if thrust drops by this many grams while PWM stable
-ABNORMAL_THRUST_DROP = 75.0
-# How often to check for anomalies (ms)
-SAFETY_CHECK_INTERVAL = 100
-# PWM above this value enables thrust-drop safety check (us)
-SAFETY_PWM_THRESHOLD = 1150
-
-[scale]
-# Default calibration factor if no saved value
-SCALE_FACTOR_DEFAULT = -204.0
-# LittleFS path for scale factor file
-SCALE_FACTOR_FILE = /scale_factor.txt
-
-[wifi]
-# Legacy LittleFS path for WiFi credentials (NVS is used now)
-WIFI_CREDENTIALS_FILE = /wifi.json
-# AP name when in provisioning mode
-WIFI_AP_NAME = ThrustScale_Setup
-# AP password (8+ chars enables WPA2; leave empty for open AP)
-WIFI_AP_PASSWORD =
-# WiFi connection timeout (ms)
-WIFI_CONNECT_TIMEOUT_MS = 10000
-# Delay after save before reboot when provisioning (ms)
-WIFI_SAVE_REBOOT_DELAY_MS = 2500
-
-[test]
-# Maximum number of samples per test run
-MAX_TEST_SAMPLES = 6000
-# PWM during pre-test tare spinup (us)
-PRE_TEST_TARE_PWM = 1100
-# Pre-test tare spinup duration (ms)
-PRE_TEST_TARE_SPINUP_MS = 2000
-# Pre-test tare settle time before tare (ms)
-PRE_TEST_TARE_SETTLE_MS = 500
-# ESC arming hold time at min throttle (ms)
-ESC_ARMING_DELAY_MS = 2100
-
-[esc_telem]
-# Voltage pulse range min (us)
-TELEM_VOLTAGE_MIN = 1000
-# Voltage pulse range max (us)
-TELEM_VOLTAGE_MAX = 2000
-# Current pulse range min (us)
-TELEM_CURRENT_MIN = 2000
-# Current pulse range max (us)
-TELEM_CURRENT_MAX = 3000
-# Scale factor for voltage/current
-TELEM_SCALE = 100.0
-
-[security]
-# Shared auth token required for HTTP/WS access. Empty disables auth.
-AUTH_TOKEN =
-
-[sim]
-# Enable simulated sensor/ESC data (1 = on, 0 = off)
-SIM_ENABLED = 0
-# Max simulated thrust in grams at max PWM
-SIM_THRUST_MAX_G = 2000.0
-# Noise amplitude in grams (+/-)
-SIM_NOISE_G = 5.0
-# First-order response time (ms)
-SIM_RESPONSE_MS = 250
-# Fixed simulated voltage
-SIM_VOLTAGE = 16.0
-# Max simulated current at max PWM
-SIM_CURRENT_MAX = 60.0
-# Random seed (0 = auto)
-SIM_SEED = 0
-)";
+static const char DEFAULT_BOARD_CFG_HEADER[] =
+    "\n"
+    "# Thrust Scale Board Configuration\n"
+    "# Edit and save from the Settings screen. Reboot to apply pin/ESC changes.\n";
+
+// How a key's value text is parsed and stored into its BoardConfig field.
+enum class ConfigType : uint8_t { INT, ULONG, U32, SIZE, FLOAT, BOOL, STRING, ESC_PROTOCOL, ESC_TELEM_SOURCE };
+
+// Extra checks on top of [min, max].
+static const uint8_t CONFIG_EVEN = 0x01;        // even values only
+static const uint8_t CONFIG_ABOVE_MIN = 0x02;   // min itself is rejected
+static const uint8_t CONFIG_MIN_OR_MAX = 0x04;  // only the two endpoints are accepted
+// Read fresh by the code using it, so a saved change can be applied without a reboot. Pins
+// and anything set up once in setup() (ESC output, UART, WiFi, sensors) stay reboot-only.
+static const uint8_t CONFIG_LIVE = 0x08;
+
+static constexpr double CONFIG_NO_MIN = -1e300;
+static constexpr double CONFIG_NO_MAX = 1e300;
+
+// One config key: where it lives in the file, how it is validated, where it is stored and
+// what the default file says about it. Defaults are parsed like any other value, so the
+// table is the single source for setBoardConfigDefaults() and the default board.cfg text.
+struct ConfigKeyDesc {
+  const char *section;
+  const char *key;
+  ConfigType type;
+  uint8_t flags;
+  double min;
+  double max;
+  uint16_t offset;
+  uint16_t size;
+  const char *defaultValue;
+  const char *help;
+};
+
+#define CONFIG_FIELD(field) (uint16_t) offsetof(BoardConfig, field), (uint16_t)sizeof(((BoardConfig *)nullptr)->field)
+
+// Grouped by section, in the order the default file lists them.
+static constexpr ConfigKeyDesc CONFIG_KEYS[] = {
+    {"pins", "HX711_DOUT_PIN", ConfigType::INT, 0, 0, 39, CONFIG_FIELD(hx711_dout_pin), "21",
+     "HX711 load cell data pin (GPIO)"},
+    {"pins", "HX711_SCK_PIN", ConfigType::INT, 0, 0, 39, CONFIG_FIELD(hx711_sck_pin), "22",
+     "HX711 load cell clock pin (GPIO)"},
+    {"pins", "HX711_RATE_PIN", ConfigType::INT, 0, -1, 33, CONFIG_FIELD(hx711_rate_pin), "-1",
+     "HX711 RATE pin driven by the board (GPIO, -1 = strapped on the module)"},
+    {"pins", "ESC_PIN", ConfigType::INT, 0, 0, 39, CONFIG_FIELD(esc_pin), "27", "ESC PWM output pin (GPIO)"},
+    {"pins", "ESC_TELEM_PIN", ConfigType::INT, 0, 0, 39, CONFIG_FIELD(esc_telem_pin), "32",
+     "ESC telemetry input pin (GPIO)"},
+
+    {"esc", "ESC_PROTOCOL", ConfigType::ESC_PROTOCOL, 0, CONFIG_NO_MIN, CONFIG_NO_MAX, CONFIG_FIELD(esc_protocol), "PWM",
+     "ESC signal: PWM, ONESHOT125, MULTISHOT, DSHOT150, DSHOT300 or DSHOT600"},
+    {"esc", "DSHOT_BIDIR", ConfigType::BOOL, 0, CONFIG_NO_MIN, CONFIG_NO_MAX, CONFIG_FIELD(dshot_bidir), "0",
+     "Bidirectional DShot: read motor RPM back on ESC_PIN (1 = on, 0 = off; DSHOT protocols only)"},
+    {"esc", "MOTOR_POLES", ConfigType::INT, CONFIG_EVEN | CONFIG_LIVE, 2, 64, CONFIG_FIELD(motor_poles), "14",
+     "Motor magnet count (poles), used to turn electrical RPM into RPM"},
+    {"esc", "ESC_PWM_CHANNEL", ConfigType::INT, 0, 0, 15, CONFIG_FIELD(esc_pwm_channel), "0", "PWM channel for ESC (0-15)"},
+    {"esc", "PWM_FREQ", ConfigType::INT, 0, 1, 40000, CONFIG_FIELD(pwm_freq), "400",
+     "Output rate in Hz: PWM/Oneshot/Multishot frequency or DShot frame rate (50 only for servo-style ESCs)"},
+    {"esc", "PWM_RESOLUTION", ConfigType::INT, 0, 1, 16, CONFIG_FIELD(pwm_resolution), "16", "PWM resolution (bits)"},
+    {"esc", "MIN_PULSE_WIDTH", ConfigType::INT, 0, 500, 2500, CONFIG_FIELD(min_pulse_width), "1000",
+     "Minimum pulse width in us (1000 typical)"},
+    {"esc", "MAX_PULSE_WIDTH", ConfigType::INT, 0, 500, 2500, CONFIG_FIELD(max_pulse_width), "2000",
+     "Maximum pulse width in us (2000 typical)"},
+
+    {"safety", "ABNORMAL_THRUST_DROP", ConfigType::FLOAT, CONFIG_LIVE, 0, 500, CONFIG_FIELD(abnormal_thrust_drop), "75.0",
+     "Trigger safety if thrust drops by this many grams while PWM stable"},
+    {"safety", "SAFETY_CHECK_INTERVAL", ConfigType::ULONG, CONFIG_LIVE, 10, 10000, CONFIG_FIELD(safety_check_interval), "100",
+     "How often to check for anomalies (ms)"},
+    {"safety", "SAFETY_PWM_THRESHOLD", ConfigType::INT, CONFIG_LIVE, 1000, 2000, CONFIG_FIELD(safety_pwm_threshold), "1150",
+     "PWM above this value enables thrust-drop safety check (us)"},
+
+    {"scale", "SCALE_FACTOR_DEFAULT", ConfigType::FLOAT, 0, CONFIG_NO_MIN, CONFIG_NO_MAX, CONFIG_FIELD(scale_factor_default),
+     "-204.0", "Default calibration factor if no saved value"},
+    {"scale", "SCALE_FACTOR_FILE", ConfigType::STRING, 0, CONFIG_NO_MIN, CONFIG_NO_MAX, CONFIG_FIELD(scale_factor_file),
+     "/scale_factor.txt", "LittleFS path for scale factor file"},
+    {"scale", "SAMPLE_GAP_MS", ConfigType::ULONG, CONFIG_LIVE, 0, 10000, CONFIG_FIELD(sample_gap_ms), "0",
+     "Sample interval counted as a gap in run/step rate stats (ms, 0 = 1.5x the average)"},
+    {"scale", "HX711_RATE", ConfigType::INT, CONFIG_MIN_OR_MAX, 10, 80, CONFIG_FIELD(hx711_rate), "10",
+     "HX711 output data rate (10 or 80 SPS; must match the RATE strap when HX711_RATE_PIN = -1)"},
+
+    {"wifi", "WIFI_CREDENTIALS_FILE", ConfigType::STRING, 0, CONFIG_NO_MIN, CONFIG_NO_MAX,
+     CONFIG_FIELD(wifi_credentials_file), "/wifi.json", "Legacy LittleFS path for WiFi credentials (NVS is used now)"},
+    {"wifi", "WIFI_AP_NAME", ConfigType::STRING, 0, CONFIG_NO_MIN, CONFIG_NO_MAX, CONFIG_FIELD(wifi_ap_name),
+     "ThrustScale_Setup", "AP name when in provisioning mode"},
+    {"wifi", "WIFI_AP_PASSWORD", ConfigType::STRING, 0, CONFIG_NO_MIN, CONFIG_NO_MAX, CONFIG_FIELD(wifi_ap_password), "",
+     "AP password (8+ chars enables WPA2; leave empty for open AP)"},
+    {"wifi", "WIFI_CONNECT_TIMEOUT_MS", ConfigType::ULONG, 0, 1000, CONFIG_NO_MAX, CONFIG_FIELD(wifi_connect_timeout_ms),
+     "10000", "WiFi connection timeout (ms)"},
+    {"wifi", "WIFI_SAVE_REBOOT_DELAY_MS", ConfigType::ULONG, 0, 0, 10000, CONFIG_FIELD(wifi_save_reboot_delay_ms), "2500",
+     "Delay after save before reboot when provisioning (ms)"},
+
+    {"test", "MAX_TEST_SAMPLES", ConfigType::SIZE, CONFIG_LIVE, 100, 80000, CONFIG_FIELD(max_test_samples), "6000",
+     "Samples kept in RAM for live/final streaming (the flash journal keeps the full run)"},
+    {"test", "PRE_TEST_TARE_PWM", ConfigType::INT, CONFIG_LIVE, 1000, 2000, CONFIG_FIELD(pre_test_tare_pwm), "1100",
+     "PWM during pre-test tare spinup (us)"},
+    {"test", "PRE_TEST_TARE_SPINUP_MS", ConfigType::ULONG, CONFIG_LIVE, 0, 60000, CONFIG_FIELD(pre_test_tare_spinup_ms), "2000",
+     "Pre-test tare spinup duration (ms)"},
+    {"test", "PRE_TEST_TARE_SETTLE_MS", ConfigType::ULONG, CONFIG_LIVE, 0, 10000, CONFIG_FIELD(pre_test_tare_settle_ms), "500",
+     "Pre-test tare settle time before tare (ms)"},
+    {"test", "ESC_ARMING_DELAY_MS", ConfigType::ULONG, CONFIG_LIVE, 1000, 30000, CONFIG_FIELD(esc_arming_delay_ms), "2100",
+     "ESC arming hold time at min throttle (ms)"},
+    {"test", "TELEMETRY_INTERVAL_MS", ConfigType::ULONG, CONFIG_LIVE, 20, 2000, CONFIG_FIELD(telemetry_interval_ms), "200",
+     "Live telemetry interval to WebSocket clients (ms)"},
+    {"test", "THRUST_PID_KP", ConfigType::FLOAT, CONFIG_LIVE, 0, 100, CONFIG_FIELD(thrust_pid_kp), "0.2",
+     "Thrust-target steps: proportional gain (us of PWM per g of error)"},
+    {"test", "THRUST_PID_KI", ConfigType::FLOAT, CONFIG_LIVE, 0, 1000, CONFIG_FIELD(thrust_pid_ki), "0.8",
+     "Thrust-target steps: integral gain (us per g*s)"},
+    {"test", "THRUST_PID_KD", ConfigType::FLOAT, CONFIG_LIVE, 0, 100, CONFIG_FIELD(thrust_pid_kd), "0.0",
+     "Thrust-target steps: derivative gain on measured thrust (us per g/s)"},
+    {"test", "THRUST_PID_SLEW", ConfigType::FLOAT, CONFIG_LIVE, 0, 100000, CONFIG_FIELD(thrust_pid_slew), "500.0",
+     "Thrust-target steps: fastest PWM change (us/s, 0 = unlimited)"},
+    {"test", "THRUST_PID_MAX_HOLD_MS", ConfigType::ULONG, CONFIG_LIVE, 0, 60000, CONFIG_FIELD(thrust_pid_max_hold_ms),
+     "3000", "Thrust-target steps: safety shutdown after this long at MAX_PULSE_WIDTH (ms, 0 = never)"},
+
+    {"esc_telem", "ESC_TELEM_SOURCE", ConfigType::ESC_TELEM_SOURCE, 0, CONFIG_NO_MIN, CONFIG_NO_MAX,
+     CONFIG_FIELD(esc_telem_source), "PWM",
+     "Telemetry source: PWM (pulse widths below) or KISS (serial frames, as sent by KISS/BLHeli_32/AM32)"},
+    {"esc_telem", "ESC_TELEM_BAUD", ConfigType::U32, 0, 9600, 1000000, CONFIG_FIELD(esc_telem_baud), "115200",
+     "KISS serial baud rate"},
+    {"esc_telem", "ESC_TELEM_REQUEST_HZ", ConfigType::INT, CONFIG_LIVE, 1, 200, CONFIG_FIELD(esc_telem_request_hz), "50",
+     "KISS telemetry requests per second (sent in DShot frames; PWM ESCs must send on their own)"},
+    {"esc_telem", "TELEM_VOLTAGE_MIN", ConfigType::INT, CONFIG_LIVE, 0, CONFIG_NO_MAX, CONFIG_FIELD(telem_voltage_min), "1000",
+     "Voltage pulse range min (us)"},
+    {"esc_telem", "TELEM_VOLTAGE_MAX", ConfigType::INT, CONFIG_LIVE, 0, CONFIG_NO_MAX, CONFIG_FIELD(telem_voltage_max), "2000",
+     "Voltage pulse range max (us)"},
+    {"esc_telem", "TELEM_CURRENT_MIN", ConfigType::INT, CONFIG_LIVE, 0, CONFIG_NO_MAX, CONFIG_FIELD(telem_current_min), "2000",
+     "Current pulse range min (us)"},
+    {"esc_telem", "TELEM_CURRENT_MAX", ConfigType::INT, CONFIG_LIVE, 0, CONFIG_NO_MAX, CONFIG_FIELD(telem_current_max), "3000",
+     "Current pulse range max (us)"},
+    {"esc_telem", "TELEM_SCALE", ConfigType::FLOAT, CONFIG_ABOVE_MIN | CONFIG_LIVE, 0, CONFIG_NO_MAX, CONFIG_FIELD(telem_scale), "100.0",
+     "Scale factor for voltage/current"},
+
+    {"security", "AUTH_TOKEN", ConfigType::STRING, 0, CONFIG_NO_MIN, CONFIG_NO_MAX, CONFIG_FIELD(auth_token), "",
+     "Shared auth token required for HTTP/WS access. Empty disables auth."},
+
+    {"sim", "SIM_ENABLED", ConfigType::BOOL, 0, CONFIG_NO_MIN, CONFIG_NO_MAX, CONFIG_FIELD(sim_enabled), "0",
+     "Enable simulated sensor/ESC data (1 = on, 0 = off)"},
+    {"sim", "SIM_THRUST_MAX_G", ConfigType::FLOAT, CONFIG_LIVE, 0, CONFIG_NO_MAX, CONFIG_FIELD(sim_thrust_max_g), "2000.0",
+     "Max simulated thrust in grams at max PWM"},
+    {"sim", "SIM_NOISE_G", ConfigType::FLOAT, CONFIG_LIVE, 0, CONFIG_NO_MAX, CONFIG_FIELD(sim_noise_g), "5.0",
+     "Noise amplitude in grams (+/-)"},
+    {"sim", "SIM_RESPONSE_MS", ConfigType::ULONG, CONFIG_LIVE, 0, 10000, CONFIG_FIELD(sim_response_ms), "250",
+     "First-order response time (ms)"},
+    {"sim", "SIM_VOLTAGE", ConfigType::FLOAT, CONFIG_LIVE, 0, CONFIG_NO_MAX, CONFIG_FIELD(sim_voltage), "16.0", "Fixed simulated voltage"},
+    {"sim", "SIM_CURRENT_MAX", ConfigType::FLOAT, CONFIG_LIVE, 0, CONFIG_NO_MAX, CONFIG_FIELD(sim_current_max), "60.0",
+     "Max simulated current at max PWM"},
+    {"sim", "SIM_SEED", ConfigType::U32, 0, 0, 4294967295.0, CONFIG_FIELD(sim_seed), "0", "Random seed (0 = auto)"},
+};
+
+#undef CONFIG_FIELD
+
+static const size_t CONFIG_KEY_COUNT = sizeof(CONFIG_KEYS) / sizeof(CONFIG_KEYS[0]);
+
+static constexpr bool configFieldSizeOk(const ConfigKeyDesc &d) {
+  return d.type == ConfigType::INT                ? d.size == sizeof(int)
+         : d.type == ConfigType::ULONG            ? d.size == sizeof(unsigned long)
+         : d.type == ConfigType::U32              ? d.size == sizeof(uint32_t)
+         : d.type == ConfigType::SIZE             ? d.size == sizeof(size_t)
+         : d.type == ConfigType::FLOAT            ? d.size == sizeof(float)
+         : d.type == ConfigType::BOOL             ? d.size == sizeof(bool)
+         : d.type == ConfigType::ESC_PROTOCOL     ? d.size == sizeof(EscProtocol)
+         : d.type == ConfigType::ESC_TELEM_SOURCE ? d.size == sizeof(EscTelemSource)
+                                                  : d.size > 1;
+}
+
+static constexpr bool configKeysOk(size_t i) {
+  return i == CONFIG_KEY_COUNT || (configFieldSizeOk(CONFIG_KEYS[i]) && configKeysOk(i + 1));
+}
+
+static_assert(configKeysOk(0), "CONFIG_KEYS type does not match the BoardConfig field");
 
 const char *getBoardConfigPath() { return BOARD_CFG_PATH; }
 
-const char *getDefaultBoardConfigPgm() { return DEFAULT_BOARD_CFG; }
+// Text span into the buffer being parsed; nothing is copied until a value is stored.
+struct ConfigSpan {
+  const char *p;
+  size_t len;
+};
 
-size_t getDefaultBoardConfigLen() { return strlen_P(DEFAULT_BOARD_CFG); }
+static bool isConfigSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v'; }
 
-void setBoardConfigDefaults(BoardConfig &cfg) {
-  cfg.hx711_dout_pin = 21;
-  cfg.hx711_sck_pin = 22;
-  cfg.esc_pin = 27;
-  cfg.esc_telem_pin = 32;
-  cfg.esc_pwm_channel = 0;
-  cfg.pwm_freq = 50;
-  cfg.pwm_resolution = 16;
-  cfg.min_pulse_width = 1000;
-  cfg.max_pulse_width = 2000;
-  cfg.abnormal_thrust_drop = 75.0f;
-  cfg.safety_check_interval = 100;
-  cfg.safety_pwm_threshold = 1150;
-  cfg.scale_factor_default = -204.0f;
-  strncpy(cfg.scale_factor_file, "/scale_factor.txt", sizeof(cfg.scale_factor_file) - 1);
-  cfg.scale_factor_file[sizeof(cfg.scale_factor_file) - 1] = '\0';
-  strncpy(cfg.wifi_credentials_file, "/wifi.json", sizeof(cfg.wifi_credentials_file) - 1);
-  cfg.wifi_credentials_file[sizeof(cfg.wifi_credentials_file) - 1] = '\0';
-  strncpy(cfg.wifi_ap_name, "ThrustScale_Setup", sizeof(cfg.wifi_ap_name) - 1);
-  cfg.wifi_ap_name[sizeof(cfg.wifi_ap_name) - 1] = '\0';
-  cfg.wifi_ap_password[0] = '\0';
-  cfg.wifi_connect_timeout_ms = 10000;
-  cfg.wifi_save_reboot_delay_ms = 2500;
-  cfg.max_test_samples = 6000;
-  cfg.pre_test_tare_pwm = 1100;
-  cfg.pre_test_tare_spinup_ms = 2000;
-  cfg.pre_test_tare_settle_ms = 500;
-  cfg.esc_arming_delay_ms = 2100;
-  cfg.telem_voltage_min = 1000;
-  cfg.telem_voltage_max = 2000;
-  cfg.telem_current_min = 2000;
-  cfg.telem_current_max = 3000;
-  cfg.telem_scale = 100.0f;
-  cfg.auth_token[0] = '\0';
-  cfg.sim_enabled = false;
-  cfg.sim_thrust_max_g = 2000.0f;
-  cfg.sim_noise_g = 5.0f;
-  cfg.sim_response_ms = 250;
-  cfg.sim_voltage = 16.0f;
-  cfg.sim_current_max = 60.0f;
-  cfg.sim_seed = 0;
+static ConfigSpan trimSpan(const char *begin, const char *end) {
+  while (begin < end && isConfigSpace(*begin)) begin++;
+  while (end > begin && isConfigSpace(end[-1])) end--;
+  return {begin, (size_t)(end - begin)};
 }
 
-enum class ConfigKeyResult { OK, UNKNOWN, INVALID };
+static bool spanEquals(ConfigSpan span, const char *s) { return strncmp(span.p, s, span.len) == 0 && s[span.len] == '\0'; }
 
-static ConfigKeyResult setConfigKey(BoardConfig &cfg, const char *section, const char *key, const char *value) {
-  if (strcmp(section, "pins") == 0) {
-    if (strcmp(key, "HX711_DOUT_PIN") == 0) {
-      int v = atoi(value);
-      if (v >= 0 && v <= 39) {
-        cfg.hx711_dout_pin = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "HX711_SCK_PIN") == 0) {
-      int v = atoi(value);
-      if (v >= 0 && v <= 39) {
-        cfg.hx711_sck_pin = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "ESC_PIN") == 0) {
-      int v = atoi(value);
-      if (v >= 0 && v <= 39) {
-        cfg.esc_pin = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "ESC_TELEM_PIN") == 0) {
-      int v = atoi(value);
-      if (v >= 0 && v <= 39) {
-        cfg.esc_telem_pin = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
+static void copySpan(char *dst, size_t dstLen, ConfigSpan span) {
+  const size_t n = span.len < dstLen - 1 ? span.len : dstLen - 1;
+  memcpy(dst, span.p, n);
+  dst[n] = '\0';
+}
+
+static bool parseEscTelemSource(const char *text, EscTelemSource &out) {
+  if (strcasecmp(text, "PWM") == 0) {
+    out = EscTelemSource::PWM;
+    return true;
   }
-  if (strcmp(section, "esc") == 0) {
-    if (strcmp(key, "ESC_PWM_CHANNEL") == 0) {
-      int v = atoi(value);
-      if (v >= 0 && v <= 15) {
-        cfg.esc_pwm_channel = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "PWM_FREQ") == 0) {
-      int v = atoi(value);
-      if (v > 0 && v <= 40000) {
-        cfg.pwm_freq = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "PWM_RESOLUTION") == 0) {
-      int v = atoi(value);
-      if (v >= 1 && v <= 16) {
-        cfg.pwm_resolution = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "MIN_PULSE_WIDTH") == 0) {
-      int v = atoi(value);
-      if (v >= 500 && v <= 2500) {
-        cfg.min_pulse_width = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "MAX_PULSE_WIDTH") == 0) {
-      int v = atoi(value);
-      if (v >= 500 && v <= 2500) {
-        cfg.max_pulse_width = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
+  if (strcasecmp(text, "KISS") == 0) {
+    out = EscTelemSource::KISS;
+    return true;
   }
-  if (strcmp(section, "safety") == 0) {
-    if (strcmp(key, "ABNORMAL_THRUST_DROP") == 0) {
-      float v = atof(value);
-      if (v >= 0 && v <= 500) {
-        cfg.abnormal_thrust_drop = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "SAFETY_CHECK_INTERVAL") == 0) {
-      unsigned long v = atol(value);
-      if (v >= 10 && v <= 10000) {
-        cfg.safety_check_interval = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "SAFETY_PWM_THRESHOLD") == 0) {
-      int v = atoi(value);
-      if (v >= 1000 && v <= 2000) {
-        cfg.safety_pwm_threshold = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
+  return false;
+}
+
+static bool configValueInRange(const ConfigKeyDesc &d, double v) {
+  if (v < d.min || v > d.max) return false;
+  if ((d.flags & CONFIG_ABOVE_MIN) && v == d.min) return false;
+  if ((d.flags & CONFIG_MIN_OR_MAX) && v != d.min && v != d.max) return false;
+  if ((d.flags & CONFIG_EVEN) && ((long long)v % 2) != 0) return false;
+  return true;
+}
+
+// Parses value into d's field. Numbers are read like atoi/atof: trailing text is ignored.
+// Nothing is stored when the value is rejected.
+static bool applyConfigValue(BoardConfig &cfg, const ConfigKeyDesc &d, ConfigSpan value) {
+  uint8_t *field = reinterpret_cast<uint8_t *>(&cfg) + d.offset;
+  if (d.type == ConfigType::STRING) {
+    memset(field, 0, d.size); // keeps equal values byte-identical for configFieldChanged()
+    copySpan(reinterpret_cast<char *>(field), d.size, value);
+    return true;
   }
-  if (strcmp(section, "scale") == 0) {
-    if (strcmp(key, "SCALE_FACTOR_DEFAULT") == 0) {
-      cfg.scale_factor_default = atof(value);
-      return ConfigKeyResult::OK;
-    }
-    if (strcmp(key, "SCALE_FACTOR_FILE") == 0) {
-      strncpy(cfg.scale_factor_file, value, sizeof(cfg.scale_factor_file) - 1);
-      cfg.scale_factor_file[sizeof(cfg.scale_factor_file) - 1] = '\0';
-      return ConfigKeyResult::OK;
-    }
+  char text[32];
+  copySpan(text, sizeof(text), value);
+  switch (d.type) {
+    case ConfigType::ESC_PROTOCOL:
+      return parseEscProtocol(text, *reinterpret_cast<EscProtocol *>(field));
+    case ConfigType::ESC_TELEM_SOURCE:
+      return parseEscTelemSource(text, *reinterpret_cast<EscTelemSource *>(field));
+    case ConfigType::BOOL:
+      *reinterpret_cast<bool *>(field) = atoi(text) != 0;
+      return true;
+    case ConfigType::FLOAT: {
+      const float v = strtof(text, nullptr);
+      if (!configValueInRange(d, v)) return false;
+      *reinterpret_cast<float *>(field) = v;
+      return true;
+    }
+    default:
+      break;
   }
-  if (strcmp(section, "wifi") == 0) {
-    if (strcmp(key, "WIFI_CREDENTIALS_FILE") == 0) {
-      strncpy(cfg.wifi_credentials_file, value, sizeof(cfg.wifi_credentials_file) - 1);
-      cfg.wifi_credentials_file[sizeof(cfg.wifi_credentials_file) - 1] = '\0';
-      return ConfigKeyResult::OK;
-    }
-    if (strcmp(key, "WIFI_AP_NAME") == 0) {
-      strncpy(cfg.wifi_ap_name, value, sizeof(cfg.wifi_ap_name) - 1);
-      cfg.wifi_ap_name[sizeof(cfg.wifi_ap_name) - 1] = '\0';
-      return ConfigKeyResult::OK;
-    }
-    if (strcmp(key, "WIFI_AP_PASSWORD") == 0) {
-      strncpy(cfg.wifi_ap_password, value, sizeof(cfg.wifi_ap_password) - 1);
-      cfg.wifi_ap_password[sizeof(cfg.wifi_ap_password) - 1] = '\0';
-      return ConfigKeyResult::OK;
-    }
-    if (strcmp(key, "WIFI_CONNECT_TIMEOUT_MS") == 0) {
-      unsigned long v = atol(value);
-      if (v >= 1000) {
-        cfg.wifi_connect_timeout_ms = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "WIFI_SAVE_REBOOT_DELAY_MS") == 0) {
-      unsigned long v = atol(value);
-      if (v <= 10000) {
-        cfg.wifi_save_reboot_delay_ms = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
+  const long long v = strtoll(text, nullptr, 10);
+  if (!configValueInRange(d, (double)v)) return false;
+  switch (d.type) {
+    case ConfigType::INT:
+      *reinterpret_cast<int *>(field) = (int)v;
+      break;
+    case ConfigType::ULONG:
+      *reinterpret_cast<unsigned long *>(field) = (unsigned long)v;
+      break;
+    case ConfigType::U32:
+      *reinterpret_cast<uint32_t *>(field) = (uint32_t)v;
+      break;
+    case ConfigType::SIZE:
+      *reinterpret_cast<size_t *>(field) = (size_t)v;
+      break;
+    default:
+      return false;
   }
-  if (strcmp(section, "test") == 0) {
-    if (strcmp(key, "MAX_TEST_SAMPLES") == 0) {
-      int v = atoi(value);
-      if (v >= 100 && v <= 20000) {
-        cfg.max_test_samples = (size_t)v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "PRE_TEST_TARE_PWM") == 0) {
-      int v = atoi(value);
-      if (v >= 1000 && v <= 2000) {
-        cfg.pre_test_tare_pwm = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "PRE_TEST_TARE_SPINUP_MS") == 0) {
-      unsigned long v = atol(value);
-      if (v <= 60000) {
-        cfg.pre_test_tare_spinup_ms = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "PRE_TEST_TARE_SETTLE_MS") == 0) {
-      unsigned long v = atol(value);
-      if (v <= 10000) {
-        cfg.pre_test_tare_settle_ms = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "ESC_ARMING_DELAY_MS") == 0) {
-      unsigned long v = atol(value);
-      if (v >= 1000 && v <= 30000) {
-        cfg.esc_arming_delay_ms = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
+  return true;
+}
+
+// Rows of one section; sections are contiguous in CONFIG_KEYS. Empty for unknown sections.
+struct ConfigSection {
+  const ConfigKeyDesc *begin;
+  const ConfigKeyDesc *end;
+};
+
+static ConfigSection findConfigSection(const char *section) {
+  const ConfigKeyDesc *end = CONFIG_KEYS + CONFIG_KEY_COUNT;
+  const ConfigKeyDesc *begin = CONFIG_KEYS;
+  while (begin < end && strcmp(begin->section, section) != 0) begin++;
+  const ConfigKeyDesc *last = begin;
+  while (last < end && strcmp(last->section, begin->section) == 0) last++;
+  return {begin, last};
+}
+
+static const ConfigKeyDesc *findConfigKey(ConfigSection section, ConfigSpan key) {
+  for (const ConfigKeyDesc *d = section.begin; d < section.end; d++) {
+    if (d->key[0] == key.p[0] && spanEquals(key, d->key)) return d;
   }
-  if (strcmp(section, "esc_telem") == 0) {
-    if (strcmp(key, "TELEM_VOLTAGE_MIN") == 0) {
-      int v = atoi(value);
-      if (v >= 0) {
-        cfg.telem_voltage_min = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "TELEM_VOLTAGE_MAX") == 0) {
-      int v = atoi(value);
-      if (v >= 0) {
-        cfg.telem_voltage_max = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "TELEM_CURRENT_MIN") == 0) {
-      int v = atoi(value);
-      if (v >= 0) {
-        cfg.telem_current_min = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "TELEM_CURRENT_MAX") == 0) {
-      int v = atoi(value);
-      if (v >= 0) {
-        cfg.telem_current_max = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "TELEM_SCALE") == 0) {
-      float v = atof(value);
-      if (v > 0) {
-        cfg.telem_scale = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
+  return nullptr;
+}
+
+static bool configFieldChanged(const BoardConfig &a, const BoardConfig &b, const ConfigKeyDesc &d) {
+  const uint8_t *fa = reinterpret_cast<const uint8_t *>(&a) + d.offset;
+  const uint8_t *fb = reinterpret_cast<const uint8_t *>(&b) + d.offset;
+  if (d.type == ConfigType::STRING) {
+    return strncmp(reinterpret_cast<const char *>(fa), reinterpret_cast<const char *>(fb), d.size) != 0;
   }
-  if (strcmp(section, "security") == 0) {
-    if (strcmp(key, "AUTH_TOKEN") == 0) {
-      strncpy(cfg.auth_token, value, sizeof(cfg.auth_token) - 1);
-      cfg.auth_token[sizeof(cfg.auth_token) - 1] = '\0';
-      return ConfigKeyResult::OK;
-    }
+  return memcmp(fa, fb, d.size) != 0;
+}
+
+// Live keys are compared with liveBase, reboot-only keys with rebootBase.
+static size_t forEachChangedKey(const BoardConfig &liveBase,
+                                const BoardConfig &rebootBase,
+                                const BoardConfig &next,
+                                ConfigChangeFn fn,
+                                void *arg) {
+  size_t changed = 0;
+  for (size_t i = 0; i < CONFIG_KEY_COUNT; i++) {
+    const ConfigKeyDesc &d = CONFIG_KEYS[i];
+    if (!configFieldChanged((d.flags & CONFIG_LIVE) ? liveBase : rebootBase, next, d)) continue;
+    changed++;
+    if (fn) fn(d.section, d.key, (d.flags & CONFIG_LIVE) != 0, arg);
   }
-  if (strcmp(section, "sim") == 0) {
-    if (strcmp(key, "SIM_ENABLED") == 0) {
-      int v = atoi(value);
-      cfg.sim_enabled = (v != 0);
-      return ConfigKeyResult::OK;
-    }
-    if (strcmp(key, "SIM_THRUST_MAX_G") == 0) {
-      float v = atof(value);
-      if (v >= 0) {
-        cfg.sim_thrust_max_g = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "SIM_NOISE_G") == 0) {
-      float v = atof(value);
-      if (v >= 0) {
-        cfg.sim_noise_g = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "SIM_RESPONSE_MS") == 0) {
-      unsigned long v = atol(value);
-      if (v <= 10000) {
-        cfg.sim_response_ms = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "SIM_VOLTAGE") == 0) {
-      float v = atof(value);
-      if (v >= 0) {
-        cfg.sim_voltage = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "SIM_CURRENT_MAX") == 0) {
-      float v = atof(value);
-      if (v >= 0) {
-        cfg.sim_current_max = v;
-        return ConfigKeyResult::OK;
-      }
-      return ConfigKeyResult::INVALID;
-    }
-    if (strcmp(key, "SIM_SEED") == 0) {
-      unsigned long v = atol(value);
-      cfg.sim_seed = (uint32_t)v;
-      return ConfigKeyResult::OK;
-    }
+  return changed;
+}
+
+size_t forEachChangedConfigKey(const BoardConfig &running, const BoardConfig &next, ConfigChangeFn fn, void *arg) {
+  return forEachChangedKey(running, running, next, fn, arg);
+}
+
+size_t applyLiveConfigKeys(BoardConfig &cfg, const BoardConfig &next) {
+  size_t applied = 0;
+  for (size_t i = 0; i < CONFIG_KEY_COUNT; i++) {
+    const ConfigKeyDesc &d = CONFIG_KEYS[i];
+    if (!(d.flags & CONFIG_LIVE) || !configFieldChanged(cfg, next, d)) continue;
+    memcpy(reinterpret_cast<uint8_t *>(&cfg) + d.offset, reinterpret_cast<const uint8_t *>(&next) + d.offset, d.size);
+    applied++;
+  }
+  return applied;
+}
+
+// Saved config waiting for loop(); written by the web task, taken between loop ticks.
+// s_fileConfig is the last file loaded or saved and s_bootConfig the one loaded at boot,
+// both as parsed: the running config may differ (e.g. MAX_TEST_SAMPLES clamped to the heap).
+static HalMutex s_queuedMutex = nullptr;
+static BoardConfig s_queuedConfig;
+static BoardConfig s_fileConfig;
+static BoardConfig s_bootConfig;
+static bool s_haveQueuedConfig = false;
+
+size_t queueLiveBoardConfig(const BoardConfig &next, ConfigChangeFn fn, void *arg) {
+  if (!s_queuedMutex) return 0;
+  halLock(s_queuedMutex);
+  const size_t changed = forEachChangedKey(s_fileConfig, s_bootConfig, next, fn, arg);
+  s_queuedConfig = next;
+  s_fileConfig = next;
+  s_haveQueuedConfig = true;
+  halUnlock(s_queuedMutex);
+  return changed;
+}
+
+bool takeQueuedBoardConfig(BoardConfig &out) {
+  if (!s_queuedMutex) return false;
+  halLock(s_queuedMutex);
+  const bool have = s_haveQueuedConfig;
+  if (have) out = s_queuedConfig;
+  s_haveQueuedConfig = false;
+  halUnlock(s_queuedMutex);
+  return have;
+}
+
+static BoardConfig parseBoardConfigDefaults() {
+  BoardConfig cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  for (size_t i = 0; i < CONFIG_KEY_COUNT; i++) {
+    const ConfigKeyDesc &d = CONFIG_KEYS[i];
+    applyConfigValue(cfg, d, {d.defaultValue, strlen(d.defaultValue)});
   }
-  return ConfigKeyResult::UNKNOWN;
+  return cfg;
+}
+
+void setBoardConfigDefaults(BoardConfig &cfg) {
+  static const BoardConfig defaults = parseBoardConfigDefaults();
+  cfg = defaults;
+}
+
+size_t printDefaultBoardConfig(Print &out) {
+  size_t n = out.print(DEFAULT_BOARD_CFG_HEADER);
+  const char *section = "";
+  for (size_t i = 0; i < CONFIG_KEY_COUNT; i++) {
+    const ConfigKeyDesc &d = CONFIG_KEYS[i];
+    if (strcmp(d.section, section) != 0) {
+      section = d.section;
+      n += out.print("\n[");
+      n += out.print(section);
+      n += out.print("]\n");
+    }
+    n += out.print("# ");
+    n += out.print(d.help);
+    n += out.print("\n");
+    n += out.print(d.key);
+    n += out.print(d.defaultValue[0] ? " = " : " =");
+    n += out.print(d.defaultValue);
+    n += out.print("\n");
+  }
+  return n;
 }
 
 static bool setError(char *dst, size_t len, const char *value) {
@@ -458,6 +412,88 @@ static bool setError(char *dst, size_t len, const char *value) {
   return true;
 }
 
+static bool failConfigStream(ConfigStreamParser &parser, ConfigSpan key, const char *message) {
+  if (!parser.strict) return true; // lenient: skip the line
+  copySpan(parser.errKey, sizeof(parser.errKey), key);
+  parser.errMessage = message;
+  parser.failed = true;
+  return false;
+}
+
+// One line without its newline; fullLen is its real length when only a prefix was buffered.
+static bool parseConfigLine(ConfigStreamParser &parser, const char *begin, size_t len, size_t fullLen) {
+  const ConfigSpan line = trimSpan(begin, begin + len);
+  if (line.len == 0 || line.p[0] == '#') return true;
+  if (fullLen > CONFIG_MAX_LINE) return failConfigStream(parser, {line.p, 0}, "Line too long");
+  const char *lineEnd = line.p + line.len;
+  if (line.p[0] == '[') {
+    const char *close = (const char *)memchr(line.p, ']', line.len);
+    if (close && close > line.p + 1) {
+      copySpan(parser.section, sizeof(parser.section), {line.p + 1, (size_t)(close - line.p - 1)});
+      for (size_t i = 0; parser.section[i]; i++) parser.section[i] = tolower((unsigned char)parser.section[i]);
+      const ConfigSection keys = findConfigSection(parser.section);
+      parser.keysBegin = (uint16_t)(keys.begin - CONFIG_KEYS);
+      parser.keysEnd = (uint16_t)(keys.end - CONFIG_KEYS);
+    }
+    return true;
+  }
+  const char *eq = (const char *)memchr(line.p, '=', line.len);
+  if (!eq || eq == line.p) return true;
+  const ConfigSpan key = trimSpan(line.p, eq);
+  const ConfigSpan value = trimSpan(eq + 1, lineEnd);
+  if (key.len == 0) return true;
+  const ConfigKeyDesc *desc = findConfigKey({CONFIG_KEYS + parser.keysBegin, CONFIG_KEYS + parser.keysEnd}, key);
+  if (!desc) return failConfigStream(parser, key, "Unknown key");
+  if (!applyConfigValue(*parser.cfg, *desc, value)) return failConfigStream(parser, key, "Invalid value");
+  return true;
+}
+
+void configStreamBegin(ConfigStreamParser &parser, BoardConfig &cfg, bool strictMode) {
+  memset(&parser, 0, sizeof(parser));
+  parser.cfg = &cfg;
+  parser.strict = strictMode;
+  const ConfigSection keys = findConfigSection("");
+  parser.keysBegin = (uint16_t)(keys.begin - CONFIG_KEYS);
+  parser.keysEnd = (uint16_t)(keys.end - CONFIG_KEYS);
+}
+
+bool configStreamFeed(ConfigStreamParser &parser, const char *data, size_t len) {
+  if (parser.failed) return false;
+  const char *p = data;
+  const char *end = data + len;
+  while (p < end) {
+    const char *newline = (const char *)memchr(p, '\n', (size_t)(end - p));
+    const char *lineEnd = newline ? newline : end;
+    const size_t n = (size_t)(lineEnd - p);
+    if (parser.lineLen == 0 && newline) {
+      // Whole line inside this chunk: parse it where it is.
+      if (!parseConfigLine(parser, p, n, n)) return false;
+    } else {
+      // Line split across chunks: keep up to CONFIG_MAX_LINE bytes of it.
+      const size_t room = parser.lineLen < CONFIG_MAX_LINE ? CONFIG_MAX_LINE - parser.lineLen : 0;
+      memcpy(parser.line + parser.lineLen, p, n < room ? n : room);
+      parser.lineLen += n;
+      if (newline) {
+        const size_t kept = parser.lineLen < CONFIG_MAX_LINE ? parser.lineLen : CONFIG_MAX_LINE;
+        const size_t fullLen = parser.lineLen;
+        parser.lineLen = 0;
+        if (!parseConfigLine(parser, parser.line, kept, fullLen)) return false;
+      }
+    }
+    p = newline ? newline + 1 : end;
+  }
+  return true;
+}
+
+bool configStreamEnd(ConfigStreamParser &parser) {
+  if (parser.failed) return false;
+  if (parser.lineLen == 0) return true;
+  const size_t kept = parser.lineLen < CONFIG_MAX_LINE ? parser.lineLen : CONFIG_MAX_LINE;
+  const size_t fullLen = parser.lineLen;
+  parser.lineLen = 0;
+  return parseConfigLine(parser, parser.line, kept, fullLen);
+}
+
 bool parseConfigContentDetailed(const char *content,
                                 BoardConfig &cfg,
                                 bool strictMode,
@@ -467,62 +503,13 @@ bool parseConfigContentDetailed(const char *content,
                                 size_t errKeyLen,
                                 char *errMessage,
                                 size_t errMessageLen) {
-  const char *p = content;
-  char section[32] = "";
-  while (*p) {
-    const char *lineStart = p;
-    while (*p && *p != '\n') p++;
-    String line(lineStart, p - lineStart);
-    line.trim();
-    if (line.length() == 0 || line.startsWith("#")) {
-      if (*p) p++;
-      continue;
-    }
-    if (line.startsWith("[")) {
-      int end = line.indexOf(']');
-      if (end > 1) {
-        line.substring(1, end).toCharArray(section, sizeof(section));
-        for (size_t i = 0; section[i]; i++) section[i] = tolower((unsigned char)section[i]);
-      }
-      if (*p) p++;
-      continue;
-    }
-    int eq = line.indexOf('=');
-    if (eq <= 0) {
-      if (*p) p++;
-      continue;
-    }
-    String key = line.substring(0, eq);
-    key.trim();
-    String val = line.substring(eq + 1);
-    val.trim();
-    if (key.length() == 0) {
-      if (*p) p++;
-      continue;
-    }
-    char secCopy[32];
-    strncpy(secCopy, section, sizeof(secCopy) - 1);
-    secCopy[sizeof(secCopy) - 1] = '\0';
-    ConfigKeyResult result = setConfigKey(cfg, secCopy, key.c_str(), val.c_str());
-    if (strictMode) {
-      if (result == ConfigKeyResult::UNKNOWN) {
-        setError(errSection, errSectionLen, secCopy);
-        setError(errKey, errKeyLen, key.c_str());
-        setError(errMessage, errMessageLen, "Unknown key");
-        return false;
-      }
-      if (result == ConfigKeyResult::INVALID) {
-        setError(errSection, errSectionLen, secCopy);
-        setError(errKey, errKeyLen, key.c_str());
-        setError(errMessage, errMessageLen, "Invalid value");
-        return false;
-      }
-    } else if (result == ConfigKeyResult::UNKNOWN) {
-      // ignore unknown keys in non-strict mode
-    }
-    if (*p) p++;
-  }
-  return true;
+  ConfigStreamParser parser;
+  configStreamBegin(parser, cfg, strictMode);
+  if (configStreamFeed(parser, content, strlen(content)) && configStreamEnd(parser)) return true;
+  setError(errSection, errSectionLen, parser.section);
+  setError(errKey, errKeyLen, parser.errKey);
+  setError(errMessage, errMessageLen, parser.errMessage);
+  return false;
 }
 
 bool parseConfigContent(const char *content, BoardConfig &cfg, bool strictMode) {
@@ -530,37 +517,36 @@ bool parseConfigContent(const char *content, BoardConfig &cfg, bool strictMode)
 }
 
 bool writeDefaultBoardConfigToFile(const char *path) {
-  File f = LittleFS.open(path, "w");
+  File f = halFs().open(path, "w");
   if (!f) {
     Serial.println("Failed to create board.cfg");
     return false;
   }
-  size_t len = strlen_P(DEFAULT_BOARD_CFG);
-  for (size_t i = 0; i < len; i++) f.write((char)pgm_read_byte(DEFAULT_BOARD_CFG + i));
+  printDefaultBoardConfig(f);
   f.close();
   return true;
 }
 
 void ensureConfigExists() {
-  if (LittleFS.exists(BOARD_CFG_PATH)) return;
+  if (halFs().exists(BOARD_CFG_PATH)) return;
   if (writeDefaultBoardConfigToFile(BOARD_CFG_PATH)) {
     Serial.println("Created default board.cfg");
   }
 }
 
-bool loadBoardConfig(BoardConfig &cfg) {
+static void loadBoardConfigFile(BoardConfig &cfg) {
   setBoardConfigDefaults(cfg);
-  if (!LittleFS.exists(BOARD_CFG_PATH)) {
+  if (!halFs().exists(BOARD_CFG_PATH)) {
     ensureConfigExists();
-    return true;
+    return;
   }
-  File f = LittleFS.open(BOARD_CFG_PATH, "r");
+  File f = halFs().open(BOARD_CFG_PATH, "r");
   if (!f) {
     Serial.println("Config file read failed, using defaults");
     if (writeDefaultBoardConfigToFile(BOARD_CFG_PATH)) {
       Serial.println("Repaired board.cfg with defaults");
     }
-    return true;
+    return;
   }
   String content = f.readString();
   f.close();
@@ -570,7 +556,16 @@ bool loadBoardConfig(BoardConfig &cfg) {
     if (writeDefaultBoardConfigToFile(BOARD_CFG_PATH)) {
       Serial.println("Repaired board.cfg with defaults");
     }
-    return true;
   }
+}
+
+bool loadBoardConfig(BoardConfig &cfg) {
+  if (!s_queuedMutex) s_queuedMutex = halCreateMutex();
+  loadBoardConfigFile(cfg);
+  halLock(s_queuedMutex);
+  s_fileConfig = cfg;
+  s_bootConfig = cfg;
+  s_haveQueuedConfig = false;
+  halUnlock(s_queuedMutex);
   return true;
 }
@@ -1,15 +1,25 @@
 #pragma once
 
+#include "esc/EscProtocol.h"
 #include <Arduino.h>
 
+// Where ESC voltage/current come from: pulse widths on ESC_TELEM_PIN, or KISS serial frames
+// received on ESC_TELEM_PIN.
+enum class EscTelemSource : uint8_t { PWM, KISS };
+
 struct BoardConfig {
-  int hx711_dout_pin, hx711_sck_pin, esc_pin, esc_telem_pin;
+  int hx711_dout_pin, hx711_sck_pin, hx711_rate_pin, esc_pin, esc_telem_pin;
+  EscProtocol esc_protocol;
+  bool dshot_bidir;
+  int motor_poles;
   int esc_pwm_channel, pwm_freq, pwm_resolution, min_pulse_width, max_pulse_width;
   float abnormal_thrust_drop;
   unsigned long safety_check_interval;
   int safety_pwm_threshold;
   float scale_factor_default;
   char scale_factor_file[48];
+  unsigned long sample_gap_ms;
+  int hx711_rate;
   char wifi_credentials_file[48];
   char wifi_ap_name[32];
   char wifi_ap_password[64];
@@ -17,6 +27,12 @@ struct BoardConfig {
   size_t max_test_samples;
   int pre_test_tare_pwm;
   unsigned long pre_test_tare_spinup_ms, pre_test_tare_settle_ms, esc_arming_delay_ms;
+  unsigned long telemetry_interval_ms;
+  float thrust_pid_kp, thrust_pid_ki, thrust_pid_kd, thrust_pid_slew;
+  unsigned long thrust_pid_max_hold_ms;
+  EscTelemSource esc_telem_source;
+  uint32_t esc_telem_baud;
+  int esc_telem_request_hz;
   int telem_voltage_min, telem_voltage_max, telem_current_min, telem_current_max;
   float telem_scale;
   char auth_token[48];
@@ -30,10 +46,38 @@ struct BoardConfig {
 };
 
 const char *getBoardConfigPath();
-const char *getDefaultBoardConfigPgm();
-size_t getDefaultBoardConfigLen();
+// Writes the default board.cfg (every key with its comment and default) to out.
+size_t printDefaultBoardConfig(Print &out);
 
 void setBoardConfigDefaults(BoardConfig &cfg);
+// Longest key/section line accepted; longer comment lines are skipped whole.
+static const size_t CONFIG_MAX_LINE = 160;
+
+// Incremental board.cfg parser for bodies that arrive in chunks. Complete lines are parsed
+// where they sit in the chunk; only a line split across chunks is copied into line[]. Plain
+// data, so it can live in per-request scratch memory.
+struct ConfigStreamParser {
+  BoardConfig *cfg;
+  bool strict;
+  bool failed;
+  char section[32];
+  uint16_t keysBegin; // current section's rows in the key table
+  uint16_t keysEnd;
+  char line[CONFIG_MAX_LINE];
+  size_t lineLen; // bytes of the split line seen so far, may exceed CONFIG_MAX_LINE
+  char errKey[32];
+  const char *errMessage;
+};
+
+void configStreamBegin(ConfigStreamParser &parser, BoardConfig &cfg, bool strictMode);
+// False once the content has been rejected (strict mode only); section, errKey and
+// errMessage then say where and why.
+bool configStreamFeed(ConfigStreamParser &parser, const char *data, size_t len);
+// Parses a last line that has no newline.
+bool configStreamEnd(ConfigStreamParser &parser);
+
+// Parses board.cfg text in place: no heap allocation, so it is cheap enough to validate
+// uploads inside the web server task.
 bool parseConfigContent(const char *content, BoardConfig &cfg, bool strictMode);
 bool parseConfigContentDetailed(const char *content,
                                 BoardConfig &cfg,
@@ -44,6 +88,20 @@ bool parseConfigContentDetailed(const char *content,
                                 size_t errKeyLen,
                                 char *errMessage,
                                 size_t errMessageLen);
+// Keys whose value differs between running and next, in file order. live is false for keys
+// that only take effect after a reboot (pins, ESC output, WiFi, ...). Returns the count.
+typedef void (*ConfigChangeFn)(const char *section, const char *key, bool live, void *arg);
+size_t forEachChangedConfigKey(const BoardConfig &running, const BoardConfig &next, ConfigChangeFn fn, void *arg);
+// Copies the live keys of next into cfg; reboot-only keys keep their running values.
+size_t applyLiveConfigKeys(BoardConfig &cfg, const BoardConfig &next);
+// Hands a saved config from the web task to loop(), which applies it between ticks.
+// A newer save replaces one not taken yet. Needs loadBoardConfig() to have run.
+// Reports the keys of next that differ from the file they replace, like
+// forEachChangedConfigKey: live keys against the last file loaded or saved, reboot-only
+// keys against the file loaded at boot. Never reads the running config.
+size_t queueLiveBoardConfig(const BoardConfig &next, ConfigChangeFn fn, void *arg);
+bool takeQueuedBoardConfig(BoardConfig &out);
+
 void ensureConfigExists();
 bool loadBoardConfig(BoardConfig &cfg);
 bool writeDefaultBoardConfigToFile(const char *path);
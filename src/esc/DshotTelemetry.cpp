@@ -0,0 +1,55 @@
+#include "DshotTelemetry.h"
+
+// 5-bit GCR symbol -> nibble; 0xFF marks symbols the encoder never produces.
+static const uint8_t GCR_DECODE[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x09, 0x0A, 0x0B, 0xFF, 0x0D, 0x0E, 0x0F,
+    0xFF, 0xFF, 0x02, 0x03, 0xFF, 0x05, 0x06, 0x07, 0xFF, 0x00, 0x08, 0x01, 0xFF, 0x04, 0x0C, 0xFF,
+};
+
+bool dshotTelemetryStream(const uint16_t *runTicks, size_t count, uint32_t tickNs, uint32_t bitNs, uint32_t &stream) {
+  if (!runTicks || count == 0 || bitNs == 0) return false;
+  uint32_t value = 0;
+  size_t bits = 0;
+  bool level = true; // the start bit; polarity drops out of the GCR step
+  for (size_t i = 0; i <= count && bits < DSHOT_TELEMETRY_BITS; i++) {
+    size_t len;
+    if (i < count) {
+      len = (size_t)(((uint64_t)runTicks[i] * tickNs + bitNs / 2) / bitNs);
+      if (len == 0 || bits + len > DSHOT_TELEMETRY_BITS) return false;
+    } else {
+      len = DSHOT_TELEMETRY_BITS - bits;
+    }
+    value = (value << len) | (level ? (1UL << len) - 1 : 0);
+    bits += len;
+    level = !level;
+  }
+  stream = value;
+  return true;
+}
+
+bool dshotTelemetryValue(uint32_t stream, uint16_t &value) {
+  // The ESC toggles the line for every 1 bit, so the edges are the GCR bits.
+  const uint32_t gcr = stream ^ (stream >> 1);
+  uint32_t word = 0;
+  for (int shift = 15; shift >= 0; shift -= 5) {
+    const uint8_t nibble = GCR_DECODE[(gcr >> shift) & 0x1F];
+    if (nibble == 0xFF) return false;
+    word = (word << 4) | nibble;
+  }
+  uint32_t sum = word ^ (word >> 8);
+  sum ^= sum >> 4;
+  if ((sum & 0x0F) != 0x0F) return false;
+  value = (uint16_t)(word >> 4);
+  return true;
+}
+
+uint32_t dshotTelemetryErpm(uint16_t value) {
+  if (value == DSHOT_TELEMETRY_STOPPED) return 0;
+  const uint32_t periodUs = (uint32_t)(value & 0x01FF) << (value >> 9);
+  return periodUs ? 60000000UL / periodUs : 0;
+}
+
+uint32_t dshotErpmToRpm(uint32_t erpm, int motorPoles) {
+  if (motorPoles < 2) return erpm;
+  return (uint32_t)((uint64_t)erpm * 2 / (uint32_t)motorPoles);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bidirectional DShot telemetry decoding. With DSHOT_BIDIR the line idles high, frames
+// carry an inverted checksum and the ESC answers each frame ~30 us later on the same pin
+// with 21 bits at 5/4 of the frame bit rate. Run lengths between edges give the line
+// levels, levels ^ (levels >> 1) gives four 5-bit GCR symbols, and those decode to a
+// 16-bit word of eeem mmmm mmmm cccc (eRPM period in us = m << e).
+//
+// Everything here is pure so captured bit patterns can be checked on the host.
+
+static const size_t DSHOT_TELEMETRY_BITS = 21;
+// Period word the ESC sends while the motor is stopped.
+static const uint16_t DSHOT_TELEMETRY_STOPPED = 0x0FFF;
+
+// Turns level run lengths (in capture ticks, starting with the start bit) into the 21
+// line levels. Runs are rounded to whole bits and the line idling after the last edge
+// fills the remaining bits. False if a run is shorter than half a bit or overruns.
+bool dshotTelemetryStream(const uint16_t *runTicks, size_t count, uint32_t tickNs, uint32_t bitNs, uint32_t &stream);
+// GCR-decodes the stream and checks the checksum; value is the 12-bit period word.
+bool dshotTelemetryValue(uint32_t stream, uint16_t &value);
+// Electrical RPM for a period word, 0 when stopped.
+uint32_t dshotTelemetryErpm(uint16_t value);
+// Mechanical RPM; motorPoles is the magnet count (pole pairs * 2).
+uint32_t dshotErpmToRpm(uint32_t erpm, int motorPoles);
+// Response bit length for a DShot bit rate: 4/5 of the frame bit.
+inline uint32_t dshotTelemetryBitNs(uint32_t frameBitRate) { return (uint32_t)(800000000ULL / frameBitRate); }
@@ -0,0 +1,189 @@
+#include "EscOutput.h"
+
+#include "esc/DshotTelemetry.h"
+#include "util/Log.h"
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+
+// Analog pulses keep at least this share of the period low.
+static const uint32_t ESC_MIN_LOW_PERMILLE = 50;
+// DShot frames are resent by a periodic timer; faster than this only burns CPU.
+static const int ESC_MAX_FRAME_RATE_HZ = 8000;
+static const uint32_t DSHOT_FRAME_GAP_NS = 5000;
+// Bidirectional ESCs start their reply this long after the end of a frame.
+static const uint32_t DSHOT_REPLY_DELAY_NS = 30000;
+
+static const char *const ESC_PROTOCOL_NAMES[] = {"PWM", "ONESHOT125", "MULTISHOT", "DSHOT150", "DSHOT300", "DSHOT600"};
+
+const char *escProtocolName(EscProtocol protocol) {
+  const size_t index = (size_t)protocol;
+  return index < sizeof(ESC_PROTOCOL_NAMES) / sizeof(ESC_PROTOCOL_NAMES[0]) ? ESC_PROTOCOL_NAMES[index] : "?";
+}
+
+bool parseEscProtocol(const char *name, EscProtocol &out) {
+  if (!name) return false;
+  for (size_t i = 0; i < sizeof(ESC_PROTOCOL_NAMES) / sizeof(ESC_PROTOCOL_NAMES[0]); i++) {
+    if (strcasecmp(name, ESC_PROTOCOL_NAMES[i]) == 0) {
+      out = (EscProtocol)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static uint32_t dshotBitRate(EscProtocol protocol) {
+  switch (protocol) {
+    case EscProtocol::DSHOT150:
+      return 150000;
+    case EscProtocol::DSHOT300:
+      return 300000;
+    default:
+      return 600000;
+  }
+}
+
+static uint16_t nsToTicks(double ns) { return (uint16_t)lround(ns / ESC_FRAME_TICK_NS); }
+
+static void planDshot(const BoardConfig &cfg, EscOutputPlan &plan) {
+  const double bitNs = 1e9 / dshotBitRate(plan.protocol);
+  plan.bidirectional = cfg.dshot_bidir;
+  plan.telemetryBitNs = dshotTelemetryBitNs(dshotBitRate(plan.protocol));
+  double frameNs = DSHOT_FRAME_BITS * bitNs + DSHOT_FRAME_GAP_NS;
+  // The reply has to fit before the next frame goes out.
+  if (plan.bidirectional) frameNs += DSHOT_REPLY_DELAY_NS + DSHOT_TELEMETRY_BITS * (double)plan.telemetryBitNs;
+  const int maxRate = (int)(1e9 / frameNs);
+  const int limit = maxRate < ESC_MAX_FRAME_RATE_HZ ? maxRate : ESC_MAX_FRAME_RATE_HZ;
+  plan.rateHz = cfg.pwm_freq;
+  if (plan.rateHz > limit) {
+    logWarn("PWM_FREQ %d Hz is too fast for %s frames; using %d Hz", cfg.pwm_freq, escProtocolName(plan.protocol),
+            limit);
+    plan.rateHz = limit;
+  }
+  const int span = plan.maxThrottleUs > plan.minThrottleUs ? plan.maxThrottleUs - plan.minThrottleUs : 1;
+  plan.dshotSlopeQ16 = (int64_t)llround((double)(DSHOT_THROTTLE_MAX - DSHOT_THROTTLE_MIN) * 65536.0 / span);
+  // A 1 is high for 3/4 of the bit, a 0 for 3/8.
+  const uint16_t bitTicks = nsToTicks(bitNs);
+  plan.bit1.highTicks = nsToTicks(bitNs * 0.75);
+  plan.bit1.lowTicks = bitTicks - plan.bit1.highTicks;
+  plan.bit0.highTicks = nsToTicks(bitNs * 0.375);
+  plan.bit0.lowTicks = bitTicks - plan.bit0.highTicks;
+}
+
+static void planAnalog(const BoardConfig &cfg, EscOutputPlan &plan) {
+  double minNs = plan.minThrottleUs * 1000.0;
+  double maxNs = plan.maxThrottleUs * 1000.0;
+  if (plan.protocol == EscProtocol::ONESHOT125) {
+    minNs = 125000.0;
+    maxNs = 250000.0;
+  } else if (plan.protocol == EscProtocol::MULTISHOT) {
+    minNs = 5000.0;
+    maxNs = 25000.0;
+  }
+  const int maxRate = (int)(1e9 / (maxNs * (1000 + ESC_MIN_LOW_PERMILLE) / 1000.0));
+  plan.rateHz = cfg.pwm_freq;
+  if (plan.rateHz > maxRate) {
+    logWarn("PWM_FREQ %d Hz leaves no room for %s pulses; using %d Hz", cfg.pwm_freq,
+            escProtocolName(plan.protocol), maxRate);
+    plan.rateHz = maxRate;
+  }
+  plan.resolutionBits = cfg.pwm_resolution;
+  while (plan.resolutionBits > 1 && (1UL << plan.resolutionBits) > ESC_LEDC_CLOCK_HZ / (uint32_t)plan.rateHz) {
+    plan.resolutionBits--;
+  }
+  if (plan.resolutionBits != cfg.pwm_resolution) {
+    logWarn("PWM_RESOLUTION reduced to %d bits at %d Hz", plan.resolutionBits, plan.rateHz);
+  }
+  const double maxDuty = (double)((1UL << plan.resolutionBits) - 1UL);
+  const double periodNs = 1e9 / plan.rateHz;
+  const int span = plan.maxThrottleUs > plan.minThrottleUs ? plan.maxThrottleUs - plan.minThrottleUs : 1;
+  const double slope = maxDuty * (maxNs - minNs) / (periodNs * span);
+  const double offset = maxDuty * minNs / periodNs - slope * plan.minThrottleUs;
+  plan.dutySlopeQ16 = (int64_t)llround(slope * 65536.0);
+  // The extra half LSB makes the final shift round to nearest.
+  plan.dutyOffsetQ16 = (int64_t)llround(offset * 65536.0) + 32768;
+}
+
+void planEscOutput(const BoardConfig &cfg, EscOutputPlan &plan) {
+  memset(&plan, 0, sizeof(plan));
+  plan.protocol = cfg.esc_protocol;
+  plan.minThrottleUs = cfg.min_pulse_width;
+  plan.maxThrottleUs = cfg.max_pulse_width;
+  if (escProtocolIsDshot(plan.protocol)) {
+    planDshot(cfg, plan);
+  } else {
+    planAnalog(cfg, plan);
+  }
+}
+
+uint32_t escAnalogDuty(const EscOutputPlan &plan, int throttleUs) {
+  const int64_t duty = (plan.dutyOffsetQ16 + (int64_t)throttleUs * plan.dutySlopeQ16) >> 16;
+  return duty > 0 ? (uint32_t)duty : 0;
+}
+
+uint16_t escDshotThrottle(const EscOutputPlan &plan, int throttleUs) {
+  if (throttleUs <= plan.minThrottleUs) return 0;
+  const int64_t value = DSHOT_THROTTLE_MIN + (((int64_t)(throttleUs - plan.minThrottleUs) * plan.dshotSlopeQ16 + 32768) >> 16);
+  return value < DSHOT_THROTTLE_MAX ? (uint16_t)value : DSHOT_THROTTLE_MAX;
+}
+
+uint16_t escDshotFrame(uint16_t value, bool telemetryRequest, bool bidirectional) {
+  const uint16_t packet = (uint16_t)(((value & 0x07FF) << 1) | (telemetryRequest ? 1 : 0));
+  uint16_t crc = packet ^ (packet >> 4) ^ (packet >> 8);
+  if (bidirectional) crc = ~crc;
+  crc &= 0x0F;
+  return (uint16_t)((packet << 4) | crc);
+}
+
+void escDshotPulses(const EscOutputPlan &plan, uint16_t frame, HalPulse out[DSHOT_FRAME_BITS]) {
+  for (size_t i = 0; i < DSHOT_FRAME_BITS; i++) {
+    out[i] = (frame & (0x8000 >> i)) ? plan.bit1 : plan.bit0;
+  }
+}
+
+static EscOutputPlan s_plan;
+static int s_pwmChannel = 0;
+static bool s_started = false;
+static int s_throttleUs = 0;
+
+void initEscOutput(const BoardConfig &cfg) {
+  planEscOutput(cfg, s_plan);
+  s_pwmChannel = cfg.esc_pwm_channel;
+  if (escProtocolIsDshot(s_plan.protocol)) {
+    s_started = halFrameOutputBegin(cfg.esc_pin, ESC_FRAME_TICK_NS, 1000000UL / (uint32_t)s_plan.rateHz,
+                                    s_plan.bidirectional);
+  } else {
+    if (cfg.dshot_bidir) logWarn("DSHOT_BIDIR ignored: %s has no telemetry reply", escProtocolName(s_plan.protocol));
+    halPwmBegin(cfg.esc_pwm_channel, s_plan.rateHz, s_plan.resolutionBits, cfg.esc_pin);
+    s_started = true;
+  }
+  if (!s_started) {
+    logError("Failed to start %s output on GPIO %d", escProtocolName(s_plan.protocol), cfg.esc_pin);
+    return;
+  }
+  logInfo("ESC output: %s at %d Hz%s", escProtocolName(s_plan.protocol), s_plan.rateHz,
+          s_plan.bidirectional ? ", bidirectional" : "");
+  writeEscOutput(cfg.min_pulse_width);
+}
+
+void writeEscOutput(int throttleUs) {
+  if (!s_started) return;
+  s_throttleUs = throttleUs;
+  if (escProtocolIsDshot(s_plan.protocol)) {
+    HalPulse pulses[DSHOT_FRAME_BITS];
+    escDshotPulses(s_plan, escDshotFrame(escDshotThrottle(s_plan, throttleUs), false, s_plan.bidirectional), pulses);
+    halFrameOutputWrite(pulses, DSHOT_FRAME_BITS);
+  } else {
+    halPwmWrite(s_pwmChannel, escAnalogDuty(s_plan, throttleUs));
+  }
+}
+
+bool requestEscTelemetry() {
+  if (!s_started || !escProtocolIsDshot(s_plan.protocol)) return false;
+  HalPulse pulses[DSHOT_FRAME_BITS];
+  escDshotPulses(s_plan, escDshotFrame(escDshotThrottle(s_plan, s_throttleUs), true, s_plan.bidirectional), pulses);
+  halFrameOutputWriteOnce(pulses, DSHOT_FRAME_BITS);
+  return true;
+}
+
+const EscOutputPlan &escOutputPlan() { return s_plan; }
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "config/BoardConfig.h"
+#include "esc/EscProtocol.h"
+#include "hal/Hal.h"
+
+// ESC output layer. Throttle is always expressed in the stand's pulse-width units
+// (MIN_PULSE_WIDTH..MAX_PULSE_WIDTH us); planEscOutput() turns the [esc] settings into an
+// EscOutputPlan once, so writing a throttle value costs one multiply-add plus, for DShot,
+// a 16-bit frame encode. The encoders are pure and run on the host.
+
+// LEDC counter clock; bounds the PWM resolution available at a given frequency.
+static const uint32_t ESC_LEDC_CLOCK_HZ = 80000000;
+// RMT tick used for DShot frames.
+static const uint32_t ESC_FRAME_TICK_NS = 25;
+static const uint16_t DSHOT_THROTTLE_MIN = 48;
+static const uint16_t DSHOT_THROTTLE_MAX = 2047;
+static const size_t DSHOT_FRAME_BITS = 16;
+
+struct EscOutputPlan {
+  EscProtocol protocol;
+  int minThrottleUs;
+  int maxThrottleUs;
+  int rateHz;         // PWM frequency, or DShot frame rate, after clamping to what the protocol allows
+  int resolutionBits; // analog only
+  // Analog: duty = (dutyOffsetQ16 + throttleUs * dutySlopeQ16) >> 16.
+  int64_t dutyOffsetQ16;
+  int64_t dutySlopeQ16;
+  // DShot: value = DSHOT_THROTTLE_MIN + (((throttleUs - minThrottleUs) * dshotSlopeQ16 + 0x8000) >> 16).
+  int64_t dshotSlopeQ16;
+  HalPulse bit0; // DShot bit timings in ESC_FRAME_TICK_NS ticks
+  HalPulse bit1;
+  bool bidirectional;      // DShot with DSHOT_BIDIR: inverted line and checksum, eRPM replies
+  uint32_t telemetryBitNs; // reply bit length when bidirectional
+};
+
+// Derives the plan from cfg; unsupported rates/resolutions are clamped with a warning.
+void planEscOutput(const BoardConfig &cfg, EscOutputPlan &plan);
+uint32_t escAnalogDuty(const EscOutputPlan &plan, int throttleUs);
+// 0 (motor stop) at or below minThrottleUs, otherwise DSHOT_THROTTLE_MIN..DSHOT_THROTTLE_MAX.
+uint16_t escDshotThrottle(const EscOutputPlan &plan, int throttleUs);
+// 11-bit value, telemetry request bit and 4-bit checksum, MSB first on the wire. Bidirectional
+// frames carry the checksum inverted, which is what tells the ESC to answer with eRPM.
+uint16_t escDshotFrame(uint16_t value, bool telemetryRequest, bool bidirectional = false);
+void escDshotPulses(const EscOutputPlan &plan, uint16_t frame, HalPulse out[DSHOT_FRAME_BITS]);
+
+// Hardware side: starts LEDC or the DShot frame output for cfg and writes throttle values.
+void initEscOutput(const BoardConfig &cfg);
+void writeEscOutput(int throttleUs);
+// Sends the current throttle once with the DShot telemetry request bit set; false if the
+// protocol has no way to ask (analog outputs).
+bool requestEscTelemetry();
+const EscOutputPlan &escOutputPlan();
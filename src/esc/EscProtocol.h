@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+
+// ESC signal protocols, selected with [esc] ESC_PROTOCOL. The analog ones are LEDC pulses
+// whose width maps linearly from MIN_PULSE_WIDTH..MAX_PULSE_WIDTH; the DShot ones are
+// digital frames sent through the RMT peripheral.
+enum class EscProtocol : uint8_t { PWM, ONESHOT125, MULTISHOT, DSHOT150, DSHOT300, DSHOT600 };
+
+const char *escProtocolName(EscProtocol protocol);
+bool parseEscProtocol(const char *name, EscProtocol &out);
+inline bool escProtocolIsDshot(EscProtocol protocol) { return protocol >= EscProtocol::DSHOT150; }
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "FS.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Thin hardware abstraction layer.
+//
+// Everything the state machine, parsers, simulator and storage need from the platform goes
+// through here, so they build both for the board (hal/esp32) and for the host
+// (hal/native, PlatformIO env:native). The load cell is abstracted one level up by
+// scale/LoadCellManager.h, which has an HX711 implementation and a simulated host one.
+
+// Clock
+unsigned long halMillis();
+uint32_t halMicros();
+// Microseconds since boot without wrap-around; halMillis() == halMicros64() / 1000.
+uint64_t halMicros64();
+// Real elapsed time in microseconds, unaffected by the virtual clock.
+uint64_t halWallMicros();
+
+// CPU cycle counter for short interval timing (wraps; only differences are meaningful).
+uint32_t halCycleCount();
+uint32_t halCyclesPerMicrosecond();
+
+// Virtual clock. While enabled, halMillis()/halMicros() stop following real time and only
+// move through halAdvanceClock(), so sim/SimRunner can run whole sequences as fast as the
+// CPU allows. Enabling starts the virtual clock at the current time.
+void halSetVirtualClock(bool enabled);
+bool halVirtualClockEnabled();
+void halAdvanceClock(uint32_t us);
+
+// ESC PWM output
+void halPwmBegin(int channel, int freqHz, int resolutionBits, int pin);
+void halPwmWrite(int channel, uint32_t duty);
+
+// ESC frame output (DShot): a pulse train that is resent every periodUs until replaced.
+// inverted idles the line high with open-drain output, so the ESC can answer on the same pin.
+struct HalPulse {
+  uint16_t highTicks;
+  uint16_t lowTicks;
+};
+static const size_t HAL_MAX_FRAME_PULSES = 16;
+bool halFrameOutputBegin(int pin, uint32_t tickNs, uint32_t periodUs, bool inverted);
+void halFrameOutputWrite(const HalPulse *pulses, size_t count);
+// Sends this train in place of the next resend only, e.g. a frame carrying a telemetry request.
+void halFrameOutputWriteOnce(const HalPulse *pulses, size_t count);
+
+// ESC frame capture (bidirectional DShot): each burst of edges on the frame output pin is
+// handed to fn as level run lengths in tickNs ticks once the line has been idle for
+// idleTicks. Our own frames are captured too; the decoder rejects them. fn runs on a driver
+// task and must not block. Call after halFrameOutputBegin() on the same pin, which capture
+// shares: the receiver setup re-routes the pin and the output routing is restored after it.
+typedef void (*HalCaptureFn)(const uint16_t *runTicks, size_t count, void *arg);
+static const size_t HAL_MAX_CAPTURE_RUNS = 48;
+bool halFrameCaptureBegin(int pin, uint32_t tickNs, uint32_t idleTicks, HalCaptureFn fn, void *arg);
+
+// Serial input (ESC telemetry UART). Received bytes are handed to fn from a driver task as
+// they arrive, with firstByteUs estimated from the delivery time and the baud rate so
+// gaps between frames stay visible. fn must not block.
+typedef void (*HalSerialFn)(const uint8_t *data, size_t len, uint64_t firstByteUs, void *arg);
+bool halSerialInputBegin(int rxPin, uint32_t baud, HalSerialFn fn, void *arg);
+
+// Filesystem holding board.cfg, web assets and run history
+fs::FS &halFs();
+size_t halFsFreeBytes();
+size_t halFreeHeap();
+
+// Background tasks. A task waits for notifications from other tasks with a timeout.
+typedef void *HalTask;
+typedef void (*HalTaskFn)(void *arg);
+HalTask halStartTask(HalTaskFn fn, const char *name, uint32_t stackBytes, unsigned priority, int core, void *arg);
+void halNotifyTask(HalTask task);
+// Blocks the calling task until notified or timeoutMs elapses; pending notifications are consumed.
+void halWaitNotify(uint32_t timeoutMs);
+
+typedef void *HalMutex;
+HalMutex halCreateMutex();
+void halLock(HalMutex mutex);
+void halUnlock(HalMutex mutex);
@@ -0,0 +1,32 @@
+#include "hal/VirtualClock.h"
+
+#include "hal/Hal.h"
+#include <atomic>
+
+// Advanced only by the thread driving the simulation; read from any task (e.g. the journal
+// writer). One 64-bit microsecond count, so millis, micros and micros64 always agree and
+// never run backwards; millis and micros wrap like the Arduino counters.
+static std::atomic<bool> s_enabled(false);
+static std::atomic<uint64_t> s_virtualUs(0);
+
+void halSetVirtualClock(bool enabled) {
+  if (enabled == s_enabled.load(std::memory_order_acquire)) return;
+  if (enabled) {
+    // Read before switching over, while halMicros64() still reports real time.
+    s_virtualUs.store(halMicros64(), std::memory_order_relaxed);
+  }
+  s_enabled.store(enabled, std::memory_order_release);
+}
+
+bool halVirtualClockEnabled() { return s_enabled.load(std::memory_order_acquire); }
+
+void halAdvanceClock(uint32_t us) {
+  if (!s_enabled.load(std::memory_order_relaxed)) return;
+  s_virtualUs.fetch_add(us, std::memory_order_release);
+}
+
+unsigned long virtualClockMillis() { return (unsigned long)(virtualClockMicros64() / 1000); }
+
+uint32_t virtualClockMicros() { return (uint32_t)virtualClockMicros64(); }
+
+uint64_t virtualClockMicros64() { return s_virtualUs.load(std::memory_order_acquire); }
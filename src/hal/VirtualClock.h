@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+
+// Shared by the platform HALs: the simulated time reported while the virtual clock is on.
+unsigned long virtualClockMillis();
+uint32_t virtualClockMicros();
+uint64_t virtualClockMicros64();
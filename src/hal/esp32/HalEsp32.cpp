@@ -0,0 +1,247 @@
+#include "hal/Hal.h"
+
+#include "LittleFS.h"
+#include "driver/gpio.h"
+#include "driver/uart.h"
+#include "esp32-hal-rmt.h"
+#include "esp_rom_gpio.h"
+#include "esp_timer.h"
+#include "soc/gpio_struct.h"
+#include "hal/VirtualClock.h"
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+unsigned long halMillis() { return halVirtualClockEnabled() ? virtualClockMillis() : millis(); }
+
+uint32_t halMicros() { return halVirtualClockEnabled() ? virtualClockMicros() : micros(); }
+
+uint64_t halMicros64() { return halVirtualClockEnabled() ? virtualClockMicros64() : (uint64_t)esp_timer_get_time(); }
+
+uint64_t halWallMicros() { return (uint64_t)esp_timer_get_time(); }
+
+uint32_t halCycleCount() { return ESP.getCycleCount(); }
+
+uint32_t halCyclesPerMicrosecond() { return ESP.getCpuFreqMHz(); }
+
+void halPwmBegin(int channel, int freqHz, int resolutionBits, int pin) {
+  ledcSetup(channel, freqHz, resolutionBits);
+  ledcAttachPin(pin, channel);
+}
+
+void halPwmWrite(int channel, uint32_t duty) { ledcWrite(channel, duty); }
+
+static rmt_obj_t *s_frameRmt = nullptr;
+static esp_timer_handle_t s_frameTimer = nullptr;
+// GPIO matrix routing of the frame output, so frame capture can restore it on the shared pin.
+static int s_framePin = -1;
+static uint32_t s_frameOutSignal = 0;
+static bool s_frameInverted = false;
+static portMUX_TYPE s_frameMux = portMUX_INITIALIZER_UNLOCKED;
+static rmt_data_t s_frameItems[HAL_MAX_FRAME_PULSES];
+static size_t s_frameCount = 0;
+static rmt_data_t s_onceItems[HAL_MAX_FRAME_PULSES];
+static size_t s_onceCount = 0;
+
+// Runs on the esp_timer task; the copy keeps a concurrent halFrameOutputWrite() from
+// tearing the frame being sent.
+static void frameTimerCallback(void *arg) {
+  (void)arg;
+  rmt_data_t items[HAL_MAX_FRAME_PULSES];
+  portENTER_CRITICAL(&s_frameMux);
+  size_t count = s_frameCount;
+  if (s_onceCount > 0) {
+    count = s_onceCount;
+    memcpy(items, s_onceItems, count * sizeof(rmt_data_t));
+    s_onceCount = 0;
+  } else {
+    memcpy(items, s_frameItems, count * sizeof(rmt_data_t));
+  }
+  portEXIT_CRITICAL(&s_frameMux);
+  if (count > 0) rmtWrite(s_frameRmt, items, count);
+}
+
+static void toRmtItems(const HalPulse *pulses, size_t count, rmt_data_t *items) {
+  for (size_t i = 0; i < count; i++) {
+    items[i].level0 = 1;
+    items[i].duration0 = pulses[i].highTicks;
+    items[i].level1 = 0;
+    items[i].duration1 = pulses[i].lowTicks;
+  }
+}
+
+bool halFrameOutputBegin(int pin, uint32_t tickNs, uint32_t periodUs, bool inverted) {
+  if (s_frameTimer) return false;
+  s_frameRmt = rmtInit(pin, RMT_TX_MODE, RMT_MEM_64);
+  if (!s_frameRmt) return false;
+  rmtSetTick(s_frameRmt, (float)tickNs);
+  if (inverted) {
+    // The RMT idles low; inverting in the GPIO matrix turns that into the idle-high line
+    // bidirectional DShot wants, and open drain lets the ESC pull it low to answer.
+    GPIO.func_out_sel_cfg[pin].inv_sel = 1;
+    gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_pullup_en((gpio_num_t)pin);
+  }
+  s_framePin = pin;
+  s_frameOutSignal = GPIO.func_out_sel_cfg[pin].func_sel;
+  s_frameInverted = inverted;
+  esp_timer_create_args_t args = {};
+  args.callback = frameTimerCallback;
+  args.name = "esc_frame";
+  if (esp_timer_create(&args, &s_frameTimer) != ESP_OK) {
+    s_frameTimer = nullptr;
+  } else if (esp_timer_start_periodic(s_frameTimer, periodUs) != ESP_OK) {
+    esp_timer_delete(s_frameTimer);
+    s_frameTimer = nullptr;
+  }
+  if (s_frameTimer) return true;
+  rmtDeinit(s_frameRmt);
+  s_frameRmt = nullptr;
+  s_framePin = -1;
+  return false;
+}
+
+void halFrameOutputWrite(const HalPulse *pulses, size_t count) {
+  if (count > HAL_MAX_FRAME_PULSES) count = HAL_MAX_FRAME_PULSES;
+  portENTER_CRITICAL(&s_frameMux);
+  toRmtItems(pulses, count, s_frameItems);
+  s_frameCount = count;
+  portEXIT_CRITICAL(&s_frameMux);
+}
+
+void halFrameOutputWriteOnce(const HalPulse *pulses, size_t count) {
+  if (count > HAL_MAX_FRAME_PULSES) count = HAL_MAX_FRAME_PULSES;
+  portENTER_CRITICAL(&s_frameMux);
+  toRmtItems(pulses, count, s_onceItems);
+  s_onceCount = count;
+  portEXIT_CRITICAL(&s_frameMux);
+}
+
+static rmt_obj_t *s_captureRmt = nullptr;
+static HalCaptureFn s_captureFn = nullptr;
+static void *s_captureArg = nullptr;
+
+static void frameCaptureCallback(uint32_t *data, size_t len, void *arg) {
+  (void)arg;
+  const rmt_data_t *items = reinterpret_cast<const rmt_data_t *>(data);
+  uint16_t runs[HAL_MAX_CAPTURE_RUNS];
+  size_t count = 0;
+  for (size_t i = 0; i < len && count + 2 <= HAL_MAX_CAPTURE_RUNS; i++) {
+    // A zero duration marks the idle period that ended the capture.
+    if (items[i].duration0 == 0) break;
+    runs[count++] = items[i].duration0;
+    if (items[i].duration1 == 0) break;
+    runs[count++] = items[i].duration1;
+  }
+  if (count > 0 && s_captureFn) s_captureFn(runs, count, s_captureArg);
+}
+
+bool halFrameCaptureBegin(int pin, uint32_t tickNs, uint32_t idleTicks, HalCaptureFn fn, void *arg) {
+  if (s_captureRmt || !fn) return false;
+  s_captureRmt = rmtInit(pin, RMT_RX_MODE, RMT_MEM_64);
+  if (!s_captureRmt) return false;
+  rmtSetTick(s_captureRmt, (float)tickNs);
+  rmtSetRxThreshold(s_captureRmt, idleTicks);
+  // Setting up the receiver reconfigures the pin as a plain input and drops its output
+  // routing, inversion included. Hand the pin back to the frame output's RMT channel as an
+  // inverted open-drain line; this is why capture must start after halFrameOutputBegin().
+  gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_pullup_en((gpio_num_t)pin);
+  if (pin == s_framePin) esp_rom_gpio_connect_out_signal(pin, s_frameOutSignal, s_frameInverted, false);
+  s_captureFn = fn;
+  s_captureArg = arg;
+  return rmtRead(s_captureRmt, frameCaptureCallback, nullptr);
+}
+
+// UART2 is free on every supported board (UART0 is the console).
+static const uart_port_t SERIAL_INPUT_PORT = UART_NUM_2;
+static const int SERIAL_INPUT_RX_BUFFER = 512;
+// Idle symbols after the last byte before the driver reports data; short, so a frame is
+// delivered right after it ends rather than when the FIFO threshold fills.
+static const uint8_t SERIAL_INPUT_RX_TIMEOUT_SYMBOLS = 2;
+static const uint32_t SERIAL_INPUT_TASK_STACK = 3072;
+static const unsigned SERIAL_INPUT_TASK_PRIORITY = 3;
+static const int SERIAL_INPUT_TASK_CORE = 0;
+
+static QueueHandle_t s_serialQueue = nullptr;
+static HalSerialFn s_serialFn = nullptr;
+static void *s_serialArg = nullptr;
+static uint32_t s_serialByteUs = 0;
+
+static void serialInputTask(void *arg) {
+  (void)arg;
+  uint8_t data[64];
+  uart_event_t event;
+  for (;;) {
+    if (xQueueReceive(s_serialQueue, &event, portMAX_DELAY) != pdTRUE) continue;
+    if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+      uart_flush_input(SERIAL_INPUT_PORT);
+      xQueueReset(s_serialQueue);
+      continue;
+    }
+    if (event.type != UART_DATA) continue;
+    // The event fires after the last byte plus the RX timeout; walk back to the first byte.
+    uint64_t atUs = halWallMicros() - (uint64_t)(event.size + SERIAL_INPUT_RX_TIMEOUT_SYMBOLS) * s_serialByteUs;
+    size_t remaining = event.size;
+    while (remaining > 0) {
+      const int n = uart_read_bytes(SERIAL_INPUT_PORT, data, remaining < sizeof(data) ? remaining : sizeof(data), 0);
+      if (n <= 0) break;
+      s_serialFn(data, (size_t)n, atUs, s_serialArg);
+      atUs += (uint64_t)n * s_serialByteUs;
+      remaining -= (size_t)n;
+    }
+  }
+}
+
+bool halSerialInputBegin(int rxPin, uint32_t baud, HalSerialFn fn, void *arg) {
+  if (s_serialQueue || !fn || baud == 0) return false;
+  uart_config_t config = {};
+  config.baud_rate = (int)baud;
+  config.data_bits = UART_DATA_8_BITS;
+  config.parity = UART_PARITY_DISABLE;
+  config.stop_bits = UART_STOP_BITS_1;
+  config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+  config.source_clk = UART_SCLK_APB;
+  if (uart_driver_install(SERIAL_INPUT_PORT, SERIAL_INPUT_RX_BUFFER, 0, 16, &s_serialQueue, 0) != ESP_OK) {
+    s_serialQueue = nullptr;
+    return false;
+  }
+  uart_param_config(SERIAL_INPUT_PORT, &config);
+  uart_set_pin(SERIAL_INPUT_PORT, UART_PIN_NO_CHANGE, rxPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+  uart_set_rx_timeout(SERIAL_INPUT_PORT, SERIAL_INPUT_RX_TIMEOUT_SYMBOLS);
+  s_serialByteUs = (10000000UL + baud / 2) / baud; // 8N1: 10 bits per byte
+  s_serialFn = fn;
+  s_serialArg = arg;
+  return halStartTask(serialInputTask, "esc_uart", SERIAL_INPUT_TASK_STACK, SERIAL_INPUT_TASK_PRIORITY,
+                      SERIAL_INPUT_TASK_CORE, nullptr) != nullptr;
+}
+
+fs::FS &halFs() { return LittleFS; }
+
+size_t halFsFreeBytes() { return LittleFS.totalBytes() - LittleFS.usedBytes(); }
+
+size_t halFreeHeap() { return ESP.getFreeHeap(); }
+
+HalTask halStartTask(HalTaskFn fn, const char *name, uint32_t stackBytes, unsigned priority, int core, void *arg) {
+  TaskHandle_t handle = nullptr;
+  BaseType_t ok = xTaskCreatePinnedToCore(fn, name, stackBytes, arg, priority, &handle, core);
+  return ok == pdPASS ? handle : nullptr;
+}
+
+void halNotifyTask(HalTask task) {
+  if (task) xTaskNotifyGive(static_cast<TaskHandle_t>(task));
+}
+
+void halWaitNotify(uint32_t timeoutMs) { ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs)); }
+
+HalMutex halCreateMutex() { return xSemaphoreCreateMutex(); }
+
+void halLock(HalMutex mutex) {
+  if (mutex) xSemaphoreTake(static_cast<SemaphoreHandle_t>(mutex), portMAX_DELAY);
+}
+
+void halUnlock(HalMutex mutex) {
+  if (mutex) xSemaphoreGive(static_cast<SemaphoreHandle_t>(mutex));
+}
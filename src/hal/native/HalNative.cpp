@@ -0,0 +1,177 @@
+#include "hal/Hal.h"
+
+#include "hal/VirtualClock.h"
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <thread>
+
+// Heap figure reported to code that sizes buffers from ESP.getFreeHeap() on the board.
+static const size_t NATIVE_FREE_HEAP = 160 * 1024;
+
+static const std::chrono::steady_clock::time_point s_clockStart = std::chrono::steady_clock::now();
+
+unsigned long halMillis() {
+  if (halVirtualClockEnabled()) return virtualClockMillis();
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                             s_clockStart)
+      .count();
+}
+
+uint32_t halMicros() {
+  if (halVirtualClockEnabled()) return virtualClockMicros();
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                        s_clockStart)
+      .count();
+}
+
+uint64_t halMicros64() {
+  if (halVirtualClockEnabled()) return virtualClockMicros64();
+  return halWallMicros();
+}
+
+uint64_t halWallMicros() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                        s_clockStart)
+      .count();
+}
+
+// Nanoseconds stand in for cycles on the host.
+uint32_t halCycleCount() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                       s_clockStart)
+      .count();
+}
+
+uint32_t halCyclesPerMicrosecond() { return 1000; }
+
+static std::map<int, uint32_t> s_pwmDuty;
+
+void halPwmBegin(int channel, int freqHz, int resolutionBits, int pin) {
+  (void)freqHz;
+  (void)resolutionBits;
+  (void)pin;
+  s_pwmDuty[channel] = 0;
+}
+
+void halPwmWrite(int channel, uint32_t duty) { s_pwmDuty[channel] = duty; }
+
+bool halFrameOutputBegin(int pin, uint32_t tickNs, uint32_t periodUs, bool inverted) {
+  (void)pin;
+  (void)tickNs;
+  (void)periodUs;
+  (void)inverted;
+  return true;
+}
+
+void halFrameOutputWrite(const HalPulse *pulses, size_t count) {
+  (void)pulses;
+  (void)count;
+}
+
+void halFrameOutputWriteOnce(const HalPulse *pulses, size_t count) {
+  (void)pulses;
+  (void)count;
+}
+
+// Nothing answers on the host; tests feed the decoder captured runs directly.
+bool halFrameCaptureBegin(int pin, uint32_t tickNs, uint32_t idleTicks, HalCaptureFn fn, void *arg) {
+  (void)pin;
+  (void)tickNs;
+  (void)idleTicks;
+  (void)fn;
+  (void)arg;
+  return false;
+}
+
+// No UART on the host; tests feed the parsers directly.
+bool halSerialInputBegin(int rxPin, uint32_t baud, HalSerialFn fn, void *arg) {
+  (void)rxPin;
+  (void)baud;
+  (void)fn;
+  (void)arg;
+  return false;
+}
+
+static std::string nativeFsRoot() {
+  const char *env = getenv("STM_NATIVE_FS_ROOT");
+  std::string root = (env && *env) ? env : ".pio/native_fs";
+  // Create each path component; existing ones are fine.
+  for (size_t i = 1; i <= root.size(); i++) {
+    if (i == root.size() || root[i] == '/') ::mkdir(root.substr(0, i).c_str(), 0755);
+  }
+  return root;
+}
+
+fs::FS &halFs() {
+  static fs::FS s_fs(nativeFsRoot());
+  return s_fs;
+}
+
+size_t halFsFreeBytes() {
+  struct statvfs st;
+  if (statvfs(halFs().root().c_str(), &st) != 0) return 0;
+  return (size_t)st.f_bavail * st.f_frsize;
+}
+
+size_t halFreeHeap() { return NATIVE_FREE_HEAP; }
+
+struct NativeTask {
+  HalTaskFn fn;
+  void *arg;
+  std::mutex mutex;
+  std::condition_variable cv;
+  unsigned pending = 0;
+};
+
+static thread_local NativeTask *t_currentTask = nullptr;
+
+HalTask halStartTask(HalTaskFn fn, const char *name, uint32_t stackBytes, unsigned priority, int core, void *arg) {
+  (void)name;
+  (void)stackBytes;
+  (void)priority;
+  (void)core;
+  NativeTask *task = new NativeTask();
+  task->fn = fn;
+  task->arg = arg;
+  std::thread([task]() {
+    t_currentTask = task;
+    task->fn(task->arg);
+  }).detach();
+  return task;
+}
+
+void halNotifyTask(HalTask handle) {
+  NativeTask *task = static_cast<NativeTask *>(handle);
+  if (!task) return;
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->pending++;
+  }
+  task->cv.notify_one();
+}
+
+void halWaitNotify(uint32_t timeoutMs) {
+  NativeTask *task = t_currentTask;
+  if (!task) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+    return;
+  }
+  std::unique_lock<std::mutex> lock(task->mutex);
+  task->cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [task]() { return task->pending > 0; });
+  task->pending = 0;
+}
+
+HalMutex halCreateMutex() { return new std::mutex(); }
+
+void halLock(HalMutex mutex) {
+  if (mutex) static_cast<std::mutex *>(mutex)->lock();
+}
+
+void halUnlock(HalMutex mutex) {
+  if (mutex) static_cast<std::mutex *>(mutex)->unlock();
+}
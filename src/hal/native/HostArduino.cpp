@@ -0,0 +1,206 @@
+// Host implementations of the Arduino core, FS and web-socket stand-ins in
+// hal/native/include (env:native only).
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <FS.h>
+
+#include <algorithm>
+#include <chrono>
+#include <sys/stat.h>
+#include <thread>
+
+HardwareSerial Serial;
+
+void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) srand((unsigned)seed);
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return howsmall + (long)(rand() % (howbig - howsmall));
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  if (inMax == inMin) return outMin;
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+void String::trim() {
+  size_t start = 0;
+  while (start < s_.size() && isspace((unsigned char)s_[start])) start++;
+  size_t end = s_.size();
+  while (end > start && isspace((unsigned char)s_[end - 1])) end--;
+  s_ = s_.substr(start, end - start);
+}
+
+int String::indexOf(char c) const {
+  const size_t pos = s_.find(c);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from) const { return substring(from, length()); }
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (to > length()) to = length();
+  if (from >= to) return String();
+  return String(s_.substr(from, to - from));
+}
+
+void String::toCharArray(char *buf, unsigned int bufsize) const {
+  if (!buf || bufsize == 0) return;
+  const size_t n = std::min<size_t>(s_.size(), bufsize - 1);
+  memcpy(buf, s_.data(), n);
+  buf[n] = '\0';
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (n < size && write(buffer[n])) n++;
+  return n;
+}
+
+size_t Print::print(int v) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%d", v);
+  return write(buf);
+}
+
+size_t Print::println(const char *s) { return print(s) + write("\n"); }
+
+size_t Print::println(int v) { return print(v) + write("\n"); }
+
+size_t Print::printf(const char *fmt, ...) {
+  char stackBuf[256];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(stackBuf, sizeof(stackBuf), fmt, args);
+  va_end(args);
+  if (n < 0) return 0;
+  if ((size_t)n < sizeof(stackBuf)) return write(reinterpret_cast<const uint8_t *>(stackBuf), (size_t)n);
+  std::string heapBuf((size_t)n + 1, '\0');
+  va_start(args, fmt);
+  vsnprintf(&heapBuf[0], heapBuf.size(), fmt, args);
+  va_end(args);
+  return write(reinterpret_cast<const uint8_t *>(heapBuf.data()), (size_t)n);
+}
+
+size_t HardwareSerial::write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+
+namespace fs {
+
+File::File(FILE *fp, const std::string &path) : fp_(fp, fclose), path_(path) {}
+
+size_t File::write(uint8_t c) { return fp_ && fputc(c, fp_.get()) != EOF ? 1 : 0; }
+
+size_t File::write(const uint8_t *buffer, size_t size) { return fp_ ? fwrite(buffer, 1, size, fp_.get()) : 0; }
+
+size_t File::read(uint8_t *buffer, size_t size) { return fp_ ? fread(buffer, 1, size, fp_.get()) : 0; }
+
+int File::read() { return fp_ ? fgetc(fp_.get()) : -1; }
+
+int File::available() {
+  if (!fp_) return 0;
+  const size_t total = size();
+  const size_t pos = position();
+  return pos < total ? (int)(total - pos) : 0;
+}
+
+bool File::seek(uint32_t pos) { return fp_ && fseek(fp_.get(), (long)pos, SEEK_SET) == 0; }
+
+size_t File::position() const { return fp_ ? (size_t)ftell(fp_.get()) : 0; }
+
+size_t File::size() const {
+  if (!fp_) return 0;
+  struct stat st;
+  fflush(fp_.get());
+  return fstat(fileno(fp_.get()), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::flush() {
+  if (fp_) fflush(fp_.get());
+}
+
+void File::close() { fp_.reset(); }
+
+String File::readString() {
+  std::string out;
+  char buf[256];
+  size_t n;
+  while (fp_ && (n = fread(buf, 1, sizeof(buf), fp_.get())) > 0) out.append(buf, n);
+  return String(out);
+}
+
+std::string FS::hostPath(const char *path) const { return root_ + (path && path[0] == '/' ? "" : "/") + path; }
+
+File FS::open(const char *path, const char *mode) {
+  // Arduino modes map onto stdio; binary so offsets match the board exactly.
+  std::string stdioMode = mode ? mode : "r";
+  stdioMode.insert(1, "b");
+  const std::string host = hostPath(path);
+  FILE *fp = fopen(host.c_str(), stdioMode.c_str());
+  return fp ? File(fp, path) : File();
+}
+
+bool FS::exists(const char *path) {
+  struct stat st;
+  return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path) { return ::remove(hostPath(path).c_str()) == 0; }
+
+bool FS::rename(const char *from, const char *to) { return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0; }
+
+bool FS::mkdir(const char *path) { return ::mkdir(hostPath(path).c_str(), 0755) == 0; }
+
+} // namespace fs
+
+AsyncWebHeader *AsyncWebServerRequest::getHeader(const char *name) const {
+  auto it = headers_.find(name);
+  return it == headers_.end() ? nullptr : it->second.get();
+}
+
+AsyncWebParameter *AsyncWebServerRequest::getParam(const char *name, bool post) const {
+  (void)post;
+  auto it = params_.find(name);
+  return it == params_.end() ? nullptr : it->second.get();
+}
+
+AsyncWebSocketClient *AsyncWebSocket::addClient() {
+  clients_.emplace_back(new AsyncWebSocketClient(nextId_++));
+  return clients_.back().get();
+}
+
+void AsyncWebSocket::removeClient(AsyncWebSocketClient *client) {
+  clients_.erase(std::remove_if(clients_.begin(), clients_.end(),
+                                [client](const std::unique_ptr<AsyncWebSocketClient> &c) { return c.get() == client; }),
+                 clients_.end());
+}
+
+std::vector<AsyncWebSocketClient *> AsyncWebSocket::getClients() const {
+  std::vector<AsyncWebSocketClient *> out;
+  for (const auto &client : clients_) out.push_back(client.get());
+  return out;
+}
+
+AsyncWebSocketMessageBuffer *AsyncWebSocket::makeBuffer(uint8_t *data, size_t len) {
+  return new AsyncWebSocketMessageBuffer(data, len);
+}
+
+void AsyncWebSocket::textAll(AsyncWebSocketMessageBuffer *buffer) {
+  if (!buffer) return;
+  for (const auto &client : clients_) client->text(reinterpret_cast<const char *>(buffer->get()), buffer->length());
+  sharedBuffers++;
+  delete buffer;
+}
+
+void AsyncWebSocket::binaryAll(AsyncWebSocketMessageBuffer *buffer) {
+  if (!buffer) return;
+  for (const auto &client : clients_) client->binary(buffer->get(), buffer->length());
+  sharedBuffers++;
+  delete buffer;
+}
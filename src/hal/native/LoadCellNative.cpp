@@ -0,0 +1,78 @@
+// Host implementation of scale/LoadCellManager.h: there is no HX711, so every reading
+// comes from the simulator state (env:native only).
+
+#include "scale/LoadCellManager.h"
+
+#include "hal/Hal.h"
+#include <Arduino.h>
+
+void initLoadCell(bool simEnabled, HX711_ADC *loadCell, const BoardConfig &cfg, AppState &state) {
+  (void)simEnabled;
+  (void)loadCell;
+  state.scaleFactor = loadScaleFactor(cfg);
+}
+
+bool startLoadCellSampler(HX711_ADC *loadCell, const BoardConfig &cfg) {
+  (void)loadCell;
+  (void)cfg;
+  return false;
+}
+
+bool readThrustSample(bool simEnabled, AppState &state, ThrustSample *out) {
+  (void)simEnabled;
+  if (out == nullptr) return false;
+  out->timestampUs = halMicros64();
+  out->timestampMs = (unsigned long)(out->timestampUs / 1000);
+  out->thrust = state.simThrust;
+  return true;
+}
+
+bool readThrust(bool simEnabled, HX711_ADC *loadCell, AppState &state, float *out) {
+  (void)loadCell;
+  ThrustSample sample;
+  if (out == nullptr || !readThrustSample(simEnabled, state, &sample)) return false;
+  *out = sample.thrust;
+  return true;
+}
+
+LoadCellSamplerStats getLoadCellSamplerStats() { return LoadCellSamplerStats{0, 0, 0, 0, 0}; }
+
+void resetLoadCellSamplerStats() {}
+
+void tareScale(bool simEnabled, HX711_ADC *loadCell, AppState &state) {
+  (void)simEnabled;
+  (void)loadCell;
+  state.simThrust = 0.0f;
+}
+
+void setScaleFactor(HX711_ADC *loadCell, AppState &state, const BoardConfig &cfg, float value) {
+  (void)loadCell;
+  state.scaleFactor = value;
+  saveScaleFactor(cfg, value);
+}
+
+float getScaleFactor(const AppState &state) { return state.scaleFactor; }
+
+void saveScaleFactor(const BoardConfig &cfg, float value) {
+  File file = halFs().open(cfg.scale_factor_file, "w");
+  if (file) {
+    file.printf("%.6f", value);
+    file.close();
+  }
+}
+
+float loadScaleFactor(const BoardConfig &cfg) {
+  if (!halFs().exists(cfg.scale_factor_file)) return cfg.scale_factor_default;
+  File file = halFs().open(cfg.scale_factor_file, "r");
+  if (!file) return cfg.scale_factor_default;
+  float loaded = file.readString().toFloat();
+  file.close();
+  return loaded;
+}
+
+long readRawReading(bool simEnabled, HX711_ADC *loadCell, AppState &state, float *weightOut) {
+  (void)simEnabled;
+  (void)loadCell;
+  if (weightOut) *weightOut = state.simThrust;
+  return (long)(state.simThrust * state.scaleFactor);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+// Host stand-in for the subset of the Arduino core used by the portable sources
+// (env:native only). Timing comes from the HAL clock.
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+// From hal/Hal.h, which cannot be included here because it pulls in FS.h.
+unsigned long halMillis();
+uint32_t halMicros();
+
+#define PROGMEM
+#define strlen_P strlen
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+
+inline unsigned long millis() { return halMillis(); }
+inline unsigned long micros() { return halMicros(); }
+void delay(unsigned long ms);
+void randomSeed(unsigned long seed);
+long random(long howsmall, long howbig);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+class String {
+ public:
+  String() = default;
+  String(const char *s) : s_(s ? s : "") {}
+  String(const char *s, size_t n) : s_(s, n) {}
+  String(const std::string &s) : s_(s) {}
+  explicit String(int v) : s_(std::to_string(v)) {}
+  explicit String(unsigned v) : s_(std::to_string(v)) {}
+  explicit String(long v) : s_(std::to_string(v)) {}
+  explicit String(unsigned long v) : s_(std::to_string(v)) {}
+
+  const char *c_str() const { return s_.c_str(); }
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  bool reserve(unsigned int size) {
+    s_.reserve(size);
+    return true;
+  }
+  void trim();
+  bool startsWith(const String &prefix) const { return s_.compare(0, prefix.s_.size(), prefix.s_) == 0; }
+  int indexOf(char c) const;
+  String substring(unsigned int from) const;
+  String substring(unsigned int from, unsigned int to) const;
+  void toCharArray(char *buf, unsigned int bufsize) const;
+  long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(s_.c_str(), nullptr); }
+
+  String &operator+=(const String &o) {
+    s_ += o.s_;
+    return *this;
+  }
+  String &operator+=(const char *o) {
+    s_ += o ? o : "";
+    return *this;
+  }
+  String &operator+=(char c) {
+    s_ += c;
+    return *this;
+  }
+  friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+  bool operator==(const String &o) const { return s_ == o.s_; }
+  bool operator==(const char *o) const { return o && s_ == o; }
+  bool operator!=(const char *o) const { return !(*this == o); }
+
+ private:
+  std::string s_;
+};
+
+class Print {
+ public:
+  virtual ~Print() = default;
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) { return str ? write(reinterpret_cast<const uint8_t *>(str), strlen(str)) : 0; }
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v);
+  size_t println(const char *s = "");
+  size_t println(const String &s) { return println(s.c_str()); }
+  size_t println(int v);
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class HardwareSerial : public Print {
+ public:
+  void begin(unsigned long baud) { (void)baud; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
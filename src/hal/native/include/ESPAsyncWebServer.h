@@ -0,0 +1,113 @@
+#pragma once
+
+// Host stand-in for the ESPAsyncWebServer types the portable sources touch (env:native
+// only). Sockets are in-memory: every frame a client is sent is kept for inspection, which
+// is what the socket-broadcast half of the HAL needs on the host.
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class AsyncWebHeader {
+ public:
+  explicit AsyncWebHeader(const String &value) : value_(value) {}
+  const String &value() const { return value_; }
+
+ private:
+  String value_;
+};
+
+class AsyncWebParameter {
+ public:
+  explicit AsyncWebParameter(const String &value) : value_(value) {}
+  const String &value() const { return value_; }
+
+ private:
+  String value_;
+};
+
+class AsyncWebServerRequest {
+ public:
+  AsyncWebServerRequest() = default;
+  AsyncWebServerRequest(const AsyncWebServerRequest &) = delete;
+  AsyncWebServerRequest &operator=(const AsyncWebServerRequest &) = delete;
+  // Like the library, a request frees its _tempObject when it goes away.
+  ~AsyncWebServerRequest() { free(_tempObject); }
+
+  void *_tempObject = nullptr;
+
+  void setHeader(const char *name, const char *value) { headers_[name] = std::make_shared<AsyncWebHeader>(value); }
+  void setParam(const char *name, const char *value) { params_[name] = std::make_shared<AsyncWebParameter>(value); }
+  bool hasHeader(const char *name) const { return headers_.count(name) != 0; }
+  AsyncWebHeader *getHeader(const char *name) const;
+  bool hasParam(const char *name, bool post = false) const {
+    (void)post;
+    return params_.count(name) != 0;
+  }
+  AsyncWebParameter *getParam(const char *name, bool post = false) const;
+
+ private:
+  std::map<std::string, std::shared_ptr<AsyncWebHeader>> headers_;
+  std::map<std::string, std::shared_ptr<AsyncWebParameter>> params_;
+};
+
+enum AwsClientStatus { WS_DISCONNECTED, WS_CONNECTED, WS_DISCONNECTING };
+
+// Payload shared by several clients' queues (AsyncWebSocket::makeBuffer).
+class AsyncWebSocketMessageBuffer {
+ public:
+  AsyncWebSocketMessageBuffer(const uint8_t *data, size_t len) : data_(reinterpret_cast<const char *>(data), len) {}
+  uint8_t *get() { return reinterpret_cast<uint8_t *>(&data_[0]); }
+  size_t length() const { return data_.size(); }
+
+ private:
+  std::string data_;
+};
+
+class AsyncWebSocketClient {
+ public:
+  explicit AsyncWebSocketClient(uint32_t id) : id_(id) {}
+
+  void *_tempObject = nullptr;
+  uint32_t id() const { return id_; }
+  void text(const char *message) { text(message, strlen(message)); }
+  // Like the library, a message sent to a full queue is discarded.
+  void text(const char *message, size_t len) {
+    if (!queueFull) textFrames.emplace_back(message, len);
+  }
+  void text(const String &message) { text(message.c_str()); }
+  void binary(const uint8_t *data, size_t len) {
+    if (!queueFull) binaryFrames.emplace_back(reinterpret_cast<const char *>(data), len);
+  }
+  bool queueIsFull() const { return queueFull; }
+  AwsClientStatus status() const { return WS_CONNECTED; }
+
+  std::vector<std::string> textFrames;
+  std::vector<std::string> binaryFrames;
+  bool queueFull = false;
+
+ private:
+  uint32_t id_;
+};
+
+class AsyncWebSocket {
+ public:
+  explicit AsyncWebSocket(const String &url) : url_(url) {}
+
+  AsyncWebSocketClient *addClient();
+  void removeClient(AsyncWebSocketClient *client);
+  std::vector<AsyncWebSocketClient *> getClients() const;
+  size_t count() const { return clients_.size(); }
+  AsyncWebSocketMessageBuffer *makeBuffer(uint8_t *data, size_t len);
+  // Queue the buffer on every connected client with room and release it; sharedBuffers counts them.
+  void textAll(AsyncWebSocketMessageBuffer *buffer);
+  void binaryAll(AsyncWebSocketMessageBuffer *buffer);
+  uint32_t sharedBuffers = 0;
+
+ private:
+  String url_;
+  uint32_t nextId_ = 1;
+  std::vector<std::unique_ptr<AsyncWebSocketClient>> clients_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+// Host stand-in for the Arduino fs::FS / fs::File API, backed by stdio under a root
+// directory (env:native only). See halFs() in hal/native/HalNative.cpp.
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+
+namespace fs {
+
+class File : public Print {
+ public:
+  File() = default;
+  File(FILE *fp, const std::string &path);
+
+  explicit operator bool() const { return (bool)fp_; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  size_t read(uint8_t *buffer, size_t size);
+  int read();
+  int available();
+  bool seek(uint32_t pos);
+  size_t position() const;
+  size_t size() const;
+  void flush();
+  void close();
+  String readString();
+  const char *path() const { return path_.c_str(); }
+
+ private:
+  std::shared_ptr<FILE> fp_;
+  std::string path_;
+};
+
+class FS {
+ public:
+  explicit FS(const std::string &root) : root_(root) {}
+  File open(const char *path, const char *mode = "r");
+  File open(const String &path, const char *mode = "r") { return open(path.c_str(), mode); }
+  bool exists(const char *path);
+  bool exists(const String &path) { return exists(path.c_str()); }
+  bool remove(const char *path);
+  bool rename(const char *from, const char *to);
+  bool mkdir(const char *path);
+  const std::string &root() const { return root_; }
+
+ private:
+  std::string hostPath(const char *path) const;
+  std::string root_;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
@@ -1,14 +1,20 @@
 #include "AppState.h"
 #include "config/BoardConfig.h"
+#include "esc/EscOutput.h"
+#include "hal/Hal.h"
 #include "net/ApiRoutes.h"
+#include "net/LiveTelemetry.h"
 #include "net/WebSocketHandler.h"
 #include "net/WebSocketUtils.h"
 #include "net/WiFiManager.h"
 #include "scale/LoadCellManager.h"
 #include "sim/Simulator.h"
+#include "storage/ResultJournal.h"
+#include "storage/RunHistory.h"
 #include "telemetry/EscTelemetry.h"
 #include "test/TestRunner.h"
 #include "util/Log.h"
+#include "util/Perf.h"
 
 #include "HX711_ADC.h"
 #include "LittleFS.h"
@@ -37,7 +43,8 @@ static void initLittleFS() {
 }
 
 static void clampMaxTestSamples(BoardConfig &cfg) {
-  const size_t sampleBytes = sizeof(DataPoint);
+  size_t sampleBytes = SAMPLE_STORE_BYTES_PER_SAMPLE + SAMPLE_STORE_ELECTRICAL_BYTES_PER_SAMPLE;
+  if (cfg.dshot_bidir) sampleBytes += SAMPLE_STORE_RPM_BYTES_PER_SAMPLE;
   const size_t freeHeap = ESP.getFreeHeap();
   const size_t budget = freeHeap / 4; // keep 75% free for everything else
   size_t maxByHeap = (sampleBytes > 0) ? (budget / sampleBytes) : cfg.max_test_samples;
@@ -51,6 +58,18 @@ static void clampMaxTestSamples(BoardConfig &cfg) {
   }
 }
 
+// Live keys of a config saved through /api/config, applied between loop ticks. A run in
+// progress keeps the values it started with; the update waits until it ends.
+static void applyQueuedBoardConfig() {
+  if (testHoldsConfig(appState.currentState)) return;
+  BoardConfig next;
+  if (!takeQueuedBoardConfig(next)) return;
+  const size_t applied = applyLiveConfigKeys(boardConfig, next);
+  if (applied == 0) return;
+  clampMaxTestSamples(boardConfig);
+  logInfo("Applied %u config keys without reboot", (unsigned)applied);
+}
+
 void setup() {
   Serial.begin(115200);
   logInfo("Reset reason code: %d", (int)esp_reset_reason());
@@ -59,6 +78,9 @@ void setup() {
   ensureConfigExists();
   loadBoardConfig(boardConfig);
   clampMaxTestSamples(boardConfig);
+  initRunHistory();
+  recoverResultJournal();
+  initResultJournal();
 
   if (!simEnabled(boardConfig)) {
     loadCell = new (loadCellStorage) HX711_ADC(boardConfig.hx711_dout_pin, boardConfig.hx711_sck_pin);
@@ -70,10 +92,12 @@ void setup() {
 
   initWiFi(appState, boardConfig);
   initLoadCell(simEnabled(boardConfig), loadCellInitialized ? loadCell : nullptr, boardConfig, appState);
+  if (loadCellInitialized) {
+    startLoadCellSampler(loadCell, boardConfig);
+  }
 
   if (!simEnabled(boardConfig)) {
-    ledcSetup(boardConfig.esc_pwm_channel, boardConfig.pwm_freq, boardConfig.pwm_resolution);
-    ledcAttachPin(boardConfig.esc_pin, boardConfig.esc_pwm_channel);
+    initEscOutput(boardConfig);
   } else {
     if (boardConfig.sim_seed != 0) {
       randomSeed(boardConfig.sim_seed);
@@ -84,9 +108,8 @@ void setup() {
   appState.currentState = State::ARMING;
 
   if (!simEnabled(boardConfig)) {
-    pinMode(boardConfig.esc_telem_pin, INPUT_PULLDOWN);
     initEscTelemetry(boardConfig);
-    attachInterrupt(digitalPinToInterrupt(boardConfig.esc_telem_pin), handleTelemInterrupt, CHANGE);
+    initEscRpmTelemetry(boardConfig);
   }
 
   configureWebSocket(ws, appState, boardConfig, loadCellInitialized ? loadCell : nullptr);
@@ -97,13 +120,25 @@ void setup() {
 }
 
 void loop() {
+  const uint32_t loopStart = perfNow();
   ws.cleanupClients();
-  readEscTelemetry(simEnabled(boardConfig),
-                   boardConfig,
-                   appState.escVoltage,
-                   appState.escCurrent,
-                   appState.escTelemStale,
-                   appState.escTelemAgeMs);
+  reapWsClientSessions();
+  applyQueuedBoardConfig();
+  {
+    PERF_SCOPE(ESC_TELEMETRY);
+    readEscTelemetry(simEnabled(boardConfig),
+                     boardConfig,
+                     appState.escVoltage,
+                     appState.escCurrent,
+                     appState.escTelemStale,
+                     appState.escTelemAgeMs);
+    readEscRpm(simEnabled(boardConfig), boardConfig, appState.escRpm, appState.escRpmStale);
+    KissTelemetryFrame serial;
+    if (!simEnabled(boardConfig) && readEscSerialTelemetry(serial)) {
+      appState.escTemperatureC = serial.temperatureC;
+      appState.escConsumedMah = serial.consumptionMah;
+    }
+  }
 
   if (appState.escTelemStale != appState.lastEscTelemStaleNotified) {
     appState.lastEscTelemStaleNotified = appState.escTelemStale;
@@ -115,7 +150,7 @@ void loop() {
       char statusOut[192];
       size_t statusLen = serializeJson(statusDoc, statusOut, sizeof(statusOut));
       if (statusLen > 0) {
-        notifyClients(ws, boardConfig, appState.wifiProvisioningMode, statusOut);
+        notifyChannel(ws, boardConfig, appState.wifiProvisioningMode, WS_CHANNEL_LIVE_DATA, statusOut);
       }
     }
   }
@@ -127,42 +162,44 @@ void loop() {
   }
 #endif
 
-  tickWiFiProvisioning(appState, boardConfig);
+  {
+    PERF_SCOPE(WIFI_PROVISIONING);
+    tickWiFiProvisioning(appState, boardConfig);
+  }
 
   if (appState.rebootAtMs != 0 && (long)(millis() - appState.rebootAtMs) >= 0) {
     ESP.restart();
   }
 
-  if (appState.currentState != State::RUNNING_SEQUENCE && (millis() - appState.lastTelemetryMs >= TELEMETRY_INTERVAL_MS)) {
+  if (appState.currentState != State::RUNNING_SEQUENCE && (millis() - appState.lastTelemetryMs >= boardConfig.telemetry_interval_ms)) {
+    PERF_SCOPE(LIVE_TELEMETRY);
     appState.lastTelemetryMs = millis();
     if (simEnabled(boardConfig)) {
       updateSimTelemetry(appState, boardConfig);
     }
 
-    if (hasWsClients(ws)) {
-      StaticJsonDocument<200> telemDoc;
-      telemDoc["type"] = "live_data";
-      telemDoc["time"] = millis();
-      float thrust = 0.0f;
-      if (readThrust(simEnabled(boardConfig), loadCellInitialized ? loadCell : nullptr, appState, &thrust)) {
-        telemDoc["thrust"] = thrust;
-      } else {
-        telemDoc["thrust"] = 0.0;
-      }
-      telemDoc["pwm"] = appState.currentPwm;
-      telemDoc["voltage"] = appState.escVoltage;
-      telemDoc["current"] = appState.escCurrent;
-      telemDoc["esc_telem_stale"] = appState.escTelemStale;
-      telemDoc["esc_telem_age_ms"] = appState.escTelemAgeMs;
-      char telemOutput[256];
-      size_t len = serializeJson(telemDoc, telemOutput, sizeof(telemOutput));
-      if (len > 0) {
-        notifyClients(ws, boardConfig, appState.wifiProvisioningMode, telemOutput);
-      }
+    // Always drain the sampler ring, even with nobody listening, so it never overflows while idle.
+    float thrust = 0.0f;
+    const bool haveThrust = readThrust(simEnabled(boardConfig), loadCellInitialized ? loadCell : nullptr, appState, &thrust);
+
+    if (wsChannelHasClients(ws, boardConfig, appState.wifiProvisioningMode, WS_CHANNEL_LIVE_DATA)) {
+      LiveDataFrame frame;
+      frame.timeMs = millis();
+      frame.thrust = haveThrust ? thrust : 0.0f;
+      frame.pwm = appState.currentPwm;
+      frame.voltage = appState.escVoltage;
+      frame.current = appState.escCurrent;
+      frame.escTelemStale = appState.escTelemStale;
+      frame.escTelemAgeMs = appState.escTelemAgeMs;
+      publishLiveData(ws, boardConfig, appState.wifiProvisioningMode, frame);
     }
   }
 
-  tickTestRunner(appState, boardConfig, simEnabled(boardConfig), loadCellInitialized ? loadCell : nullptr, ws);
+  {
+    PERF_SCOPE(TEST_RUNNER);
+    tickTestRunner(appState, boardConfig, simEnabled(boardConfig), loadCellInitialized ? loadCell : nullptr, ws);
+  }
 
+  perfEnd(PerfStage::LOOP, loopStart);
   delay(1);
 }
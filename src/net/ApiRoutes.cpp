@@ -4,22 +4,270 @@
 #include "LittleFS.h"
 #include "ArduinoJson.h"
 #include "Auth.h"
+#include "RequestBody.h"
+#include "StaticAssets.h"
 #include "config/BoardConfig.h"
+#include "hal/Hal.h"
+#include "net/WebSocketUtils.h"
 #include "net/WiFiManager.h"
+#include "scale/LoadCellManager.h"
+#include "storage/ResultJournal.h"
+#include "storage/ResultQuery.h"
+#include "storage/RunHistory.h"
+#include "telemetry/EscTelemetry.h"
 #include "test/TestRunner.h"
+#include "util/Perf.h"
 #include <Arduino.h>
 #include <WiFi.h>
+#include <memory>
+
+// format=bin layout (little-endian): u32 magic, u16 version, u16 record size, u32 journal
+// flags, u32 journal sample count, then one record per point: a JournalRpmSample when the
+// flags include JOURNAL_FLAG_RPM, else a JournalPowerSample when they include
+// JOURNAL_FLAG_ELECTRICAL, else a JournalSample.
+static const uint32_t RESULTS_BIN_MAGIC = 0x31525453; // "STR1"
+// 2: JournalSample.subMsUs is filled in. 3: electrical runs use 16-byte records.
+// 4: RPM runs use 20-byte records.
+static const uint16_t RESULTS_BIN_VERSION = 4;
+
+// Serializes a journal query one record at a time into the chunked response buffer.
+struct ResultDownloadStream {
+  ResultQueryStream query;
+  bool binary = false;
+  bool electrical = false;
+  bool rpm = false;
+  uint8_t record[96];
+  size_t recordLen = 0;
+  size_t recordPos = 0;
+  uint32_t pinnedRunId = 0;
+
+  ~ResultDownloadStream() {
+    // Close before unpinning: the unpin may remove the file of a run evicted meanwhile.
+    query.reader.file.close();
+    if (pinnedRunId != 0) unpinRunHistoryEntry(pinnedRunId);
+  }
+};
+
+static size_t encodeResultRecord(const ResultDownloadStream &stream, const DataPoint &point, uint8_t *out,
+                                 size_t outLen) {
+  if (stream.binary) {
+    JournalRpmSample record;
+    JournalSample &sample = record.power.sample;
+    sample.timestamp = (uint32_t)point.timestamp;
+    sample.thrust = point.thrust;
+    sample.pwm = (int16_t)point.pwm;
+    sample.subMsUs = point.subMsUs;
+    if (!stream.electrical && !stream.rpm) {
+      memcpy(out, &sample, sizeof(sample));
+      return sizeof(sample);
+    }
+    record.power.voltageCenti = (uint16_t)lroundf(point.voltage * 100.0f);
+    record.power.currentCenti = (uint16_t)lroundf(point.current * 100.0f);
+    record.rpm = point.rpm;
+    const size_t len = stream.rpm ? sizeof(record) : sizeof(record.power);
+    memcpy(out, &record, len);
+    return len;
+  }
+  char *text = reinterpret_cast<char *>(out);
+  int n = snprintf(text, outLen, "%lu.%03u,%.3f,%d", point.timestamp, (unsigned)point.subMsUs, point.thrust,
+                   point.pwm);
+  if (n < 0 || (size_t)n >= outLen) return 0;
+  size_t pos = (size_t)n;
+  if (stream.electrical) {
+    n = snprintf(text + pos, outLen - pos, ",%.2f,%.2f,%.2f", point.voltage, point.current, dataPointPower(point));
+    if (n < 0 || (size_t)n >= outLen - pos) return 0;
+    pos += (size_t)n;
+  }
+  n = stream.rpm ? snprintf(text + pos, outLen - pos, ",%lu\n", (unsigned long)point.rpm)
+                 : snprintf(text + pos, outLen - pos, "\n");
+  return (n > 0 && (size_t)n < outLen - pos) ? pos + (size_t)n : 0;
+}
+
+static size_t fillResultDownload(ResultDownloadStream &stream, uint8_t *buffer, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (stream.recordPos >= stream.recordLen) {
+      DataPoint point;
+      if (!nextResultQueryPoint(stream.query, point)) break;
+      stream.recordLen = encodeResultRecord(stream, point, stream.record, sizeof(stream.record));
+      stream.recordPos = 0;
+      continue;
+    }
+    size_t n = stream.recordLen - stream.recordPos;
+    if (n > maxLen - written) n = maxLen - written;
+    memcpy(buffer + written, stream.record + stream.recordPos, n);
+    stream.recordPos += n;
+    written += n;
+  }
+  return written;
+}
+
+static uint32_t uintParam(AsyncWebServerRequest *request, const char *name, uint32_t fallback) {
+  if (!request->hasParam(name)) return fallback;
+  const char *text = request->getParam(name)->value().c_str();
+  char *end = nullptr;
+  unsigned long v = strtoul(text, &end, 10);
+  return (end && end != text && *end == '\0') ? (uint32_t)v : fallback;
+}
+
+// Streams one stored run (0 = newest), honouring from/to/max_points/format query parameters.
+static void sendRunResults(AsyncWebServerRequest *request, uint32_t runId) {
+  ResultQuery query;
+  query.fromMs = uintParam(request, "from", 0);
+  query.toMs = uintParam(request, "to", UINT32_MAX);
+  query.maxPoints = uintParam(request, "max_points", 0);
+  std::shared_ptr<ResultDownloadStream> stream = std::make_shared<ResultDownloadStream>();
+  stream->binary = request->hasParam("format") && request->getParam("format")->value() == "bin";
+  // Pinned for as long as the response holds the stream, so DELETE or eviction cannot
+  // remove the file mid-download.
+  stream->pinnedRunId = pinRunHistoryEntry(runId);
+  char path[RUN_PATH_LEN];
+  if (stream->pinnedRunId == 0 && runHistoryPath(runId, path, sizeof(path))) {
+    request->send(409, "text/plain", "Run busy");
+    return;
+  }
+  if (stream->pinnedRunId == 0 || !openResultQuery(stream->query, query, stream->pinnedRunId)) {
+    request->send(404, "text/plain", "No saved results");
+    return;
+  }
+  const JournalFileHeader &header = stream->query.reader.header;
+  if (!(header.flags & JOURNAL_FLAG_CLOSED)) {
+    request->send(409, "text/plain", "Run in progress");
+    return;
+  }
+  stream->electrical = (header.flags & JOURNAL_FLAG_ELECTRICAL) != 0;
+  stream->rpm = (header.flags & JOURNAL_FLAG_RPM) != 0;
+  if (stream->binary) {
+    uint8_t *p = stream->record;
+    memcpy(p, &RESULTS_BIN_MAGIC, 4);
+    memcpy(p + 4, &RESULTS_BIN_VERSION, 2);
+    const uint16_t recordSize = stream->rpm          ? sizeof(JournalRpmSample)
+                                : stream->electrical ? sizeof(JournalPowerSample)
+                                                     : sizeof(JournalSample);
+    memcpy(p + 6, &recordSize, 2);
+    memcpy(p + 8, &header.flags, 4);
+    memcpy(p + 12, &header.sampleCount, 4);
+    stream->recordLen = 16;
+  } else {
+    const int n = snprintf(reinterpret_cast<char *>(stream->record), sizeof(stream->record),
+                           "timestamp_ms,thrust_g,pwm_us%s%s\n", stream->electrical ? ",voltage_v,current_a,power_w" : "",
+                           stream->rpm ? ",rpm" : "");
+    stream->recordLen = n > 0 ? (size_t)n : 0;
+  }
+  AsyncWebServerResponse *response = request->beginChunkedResponse(
+      stream->binary ? "application/octet-stream" : "text/csv",
+      [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        (void)index;
+        return fillResultDownload(*stream, buffer, maxLen);
+      });
+  response->addHeader("X-Run-Samples", String(header.sampleCount));
+  if (header.rate.intervals > 0) {
+    char rate[96];
+    snprintf(rate, sizeof(rate), "sps=%.2f;mean_us=%lu;jitter_us=%lu;max_us=%lu;gaps=%lu", header.rate.sps,
+             (unsigned long)header.rate.meanUs, (unsigned long)header.rate.stddevUs,
+             (unsigned long)header.rate.maxUs, (unsigned long)header.rate.gaps);
+    response->addHeader("X-Run-Sample-Rate", rate);
+  }
+  if (header.flags & JOURNAL_FLAG_ABORTED) {
+    response->addHeader("X-Run-Aborted", "1");
+  }
+  request->send(response);
+}
+
+struct ConfigChangeLists {
+  JsonArray live;
+  JsonArray reboot;
+};
+
+static void addConfigChange(const char *section, const char *key, bool live, void *arg) {
+  (void)section;
+  ConfigChangeLists *lists = static_cast<ConfigChangeLists *>(arg);
+  (live ? lists->live : lists->reboot).add(key); // keys are unique across sections
+}
+
+static const size_t CONFIG_BODY_MAX = 8192;
+
+// Request scratch of a config upload: the config being built and the parser filling it.
+struct ConfigUpload {
+  BoardConfig next;
+  ConfigStreamParser parser;
+};
+
+// Validates each body chunk as it arrives. Returns the upload once the whole body parsed;
+// nullptr while more is coming or after an error response (the scratch is freed then).
+static ConfigUpload *feedConfigUpload(AsyncWebServerRequest *request,
+                                      const uint8_t *data,
+                                      size_t len,
+                                      size_t index,
+                                      size_t total,
+                                      bool keepBody) {
+  const RequestBodyResult body =
+      collectRequestBody(request, data, len, index, total, CONFIG_BODY_MAX, sizeof(ConfigUpload), keepBody);
+  if (body == RequestBodyResult::TOO_LARGE) {
+    request->send(400, "application/json", "{\"error\":\"Config too large\"}");
+    return nullptr;
+  }
+  if (body == RequestBodyResult::NO_MEMORY) {
+    request->send(500, "application/json", "{\"error\":\"Out of memory\"}");
+    return nullptr;
+  }
+  if (body == RequestBodyResult::DROPPED) return nullptr;
+  ConfigUpload *upload = static_cast<ConfigUpload *>(requestBodyState(request));
+  if (index == 0) {
+    setBoardConfigDefaults(upload->next);
+    configStreamBegin(upload->parser, upload->next, true);
+  }
+  const bool complete = body == RequestBodyResult::COMPLETE;
+  if (configStreamFeed(upload->parser, reinterpret_cast<const char *>(data), len) &&
+      (!complete || configStreamEnd(upload->parser))) {
+    if (!complete) return nullptr;
+    if (total > 0) return upload;
+    releaseRequestBody(request);
+    request->send(400, "application/json", "{\"error\":\"Empty config\"}");
+    return nullptr;
+  }
+  StaticJsonDocument<192> errDoc;
+  errDoc["error"] = "Invalid config";
+  errDoc["section"] = upload->parser.section;
+  errDoc["key"] = upload->parser.errKey;
+  errDoc["message"] = upload->parser.errMessage;
+  String out;
+  serializeJson(errDoc, out);
+  releaseRequestBody(request);
+  request->send(400, "application/json", out);
+  return nullptr;
+}
+
+// UI pages: gzip'd when the build produced a .gz, always revalidated through the ETag.
+static void sendStaticAsset(AsyncWebServerRequest *request, const char *path) {
+  const StaticAsset *asset = findStaticAsset(path);
+  if (!asset) {
+    request->send(404, "text/plain", "Not found");
+    return;
+  }
+  AsyncWebServerResponse *response;
+  AsyncWebHeader *ifNoneMatch = request->getHeader("If-None-Match");
+  if (ifNoneMatch && etagMatches(ifNoneMatch->value().c_str(), asset->etag)) {
+    response = request->beginResponse(304);
+  } else {
+    response = request->beginResponse(LittleFS, asset->filePath, asset->contentType);
+    if (asset->gzip) response->addHeader("Content-Encoding", "gzip");
+  }
+  response->addHeader("ETag", asset->etag);
+  response->addHeader("Cache-Control", "no-cache"); // keep a copy, but check the ETag on every load
+  request->send(response);
+}
 
 void setupApiRoutes(AsyncWebServer &server, AsyncWebSocket &ws, AppState &state, BoardConfig &cfg, HX711_ADC *loadCell) {
   (void)loadCell;
+  initStaticAssets(LittleFS);
 
   server.on("/", HTTP_GET, [&cfg, &state](AsyncWebServerRequest *request) {
     if (!isAuthorizedRequest(cfg, state.wifiProvisioningMode, request)) {
       request->send(401, "text/plain", "Unauthorized");
       return;
     }
-    if (state.wifiProvisioningMode) request->send(LittleFS, "/wifi_setup.html", "text/html");
-    else request->send(LittleFS, "/index.html", "text/html");
+    sendStaticAsset(request, state.wifiProvisioningMode ? "/wifi_setup.html" : "/index.html");
   });
 
   server.on("/api/scan", HTTP_GET, [&cfg, &state](AsyncWebServerRequest *request) {
@@ -57,16 +305,21 @@ void setupApiRoutes(AsyncWebServer &server, AsyncWebSocket &ws, AppState &state,
             [&cfg, &state](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
               if (!isAuthorizedRequest(cfg, state.wifiProvisioningMode, request)) return;
               if (state.pendingWifiRequest) return;
-              static String body;
-              if (index == 0) body = "";
-              if (total > 512) {
+              const RequestBodyResult body = collectRequestBody(request, data, len, index, total, 512, 0, true);
+              if (body == RequestBodyResult::TOO_LARGE) {
                 request->send(413, "application/json", "{\"error\":\"Body too large\"}");
                 return;
               }
-              for (size_t i = 0; i < len; i++) body += (char)data[i];
-              if (index + len != total) return;
+              if (body == RequestBodyResult::NO_MEMORY) {
+                request->send(500, "application/json", "{\"error\":\"Out of memory\"}");
+                return;
+              }
+              if (body != RequestBodyResult::COMPLETE) return;
+              size_t bodyLen = 0;
+              const char *bodyText = requestBodyText(request, bodyLen);
               StaticJsonDocument<512> doc;
-              DeserializationError err = deserializeJson(doc, body);
+              DeserializationError err = deserializeJson(doc, bodyText, bodyLen);
+              releaseRequestBody(request);
               if (err || !doc["ssid"].is<const char *>() || !doc["password"].is<const char *>()) {
                 request->send(400, "application/json", "{\"error\":\"Invalid JSON or missing ssid/password\"}");
                 return;
@@ -106,12 +359,83 @@ void setupApiRoutes(AsyncWebServer &server, AsyncWebSocket &ws, AppState &state,
       request->send(401, "text/plain", "Unauthorized");
       return;
     }
-    const char *resultsPath = getLastResultsPath();
-    if (!LittleFS.exists(resultsPath)) {
-      request->send(404, "text/plain", "No saved results");
+    sendRunResults(request, 0);
+  });
+
+  // Registered before /api/runs: handlers also match sub-paths of their URI.
+  server.on("/api/runs/data", HTTP_GET, [&cfg, &state](AsyncWebServerRequest *request) {
+    if (!isAuthorizedRequest(cfg, state.wifiProvisioningMode, request)) {
+      request->send(401, "text/plain", "Unauthorized");
+      return;
+    }
+    const uint32_t runId = uintParam(request, "id", 0);
+    if (runId == 0) {
+      request->send(400, "text/plain", "Missing id");
+      return;
+    }
+    sendRunResults(request, runId);
+  });
+
+  server.on("/api/runs/steps", HTTP_GET, [&cfg, &state](AsyncWebServerRequest *request) {
+    if (!isAuthorizedRequest(cfg, state.wifiProvisioningMode, request)) {
+      request->send(401, "text/plain", "Unauthorized");
+      return;
+    }
+    char path[RUN_PATH_LEN];
+    if (!runHistoryStepsPath(uintParam(request, "id", 0), path, sizeof(path)) || !LittleFS.exists(path)) {
+      request->send(404, "text/plain", "No step summary");
+      return;
+    }
+    request->send(LittleFS, path, "text/csv");
+  });
+
+  server.on("/api/runs", HTTP_GET, [&cfg, &state](AsyncWebServerRequest *request) {
+    if (!isAuthorizedRequest(cfg, state.wifiProvisioningMode, request)) {
+      request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+      return;
+    }
+    RunManifestEntry entries[RUN_HISTORY_SLOTS];
+    const size_t count = listRunHistory(entries, RUN_HISTORY_SLOTS);
+    DynamicJsonDocument doc(256 + RUN_HISTORY_SLOTS * 320);
+    doc["capacity"] = (uint32_t)RUN_HISTORY_SLOTS;
+    JsonArray runs = doc.createNestedArray("runs");
+    for (size_t i = 0; i < count; i++) {
+      const RunManifestEntry &entry = entries[i];
+      JsonObject run = runs.createNestedObject();
+      run["id"] = entry.runId;
+      run["start_epoch"] = entry.startEpoch;
+      run["start_ms"] = entry.startMs;
+      run["steps"] = entry.stepCount;
+      run["samples"] = entry.sampleCount;
+      run["peak_thrust"] = entry.peakThrust;
+      run["recording"] = !(entry.flags & JOURNAL_FLAG_CLOSED);
+      run["aborted"] = (bool)(entry.flags & JOURNAL_FLAG_ABORTED);
+      run["recovered"] = (bool)(entry.flags & JOURNAL_FLAG_RECOVERED);
+      run["electrical"] = (bool)(entry.flags & JOURNAL_FLAG_ELECTRICAL);
+      run["rpm"] = (bool)(entry.flags & JOURNAL_FLAG_RPM);
+      run["sequence"] = (const char *)entry.sequence;
+    }
+    String out;
+    serializeJson(doc, out);
+    request->send(200, "application/json", out);
+  });
+
+  server.on("/api/runs", HTTP_DELETE, [&cfg, &state](AsyncWebServerRequest *request) {
+    if (!isAuthorizedRequest(cfg, state.wifiProvisioningMode, request)) {
+      request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+      return;
+    }
+    const uint32_t runId = uintParam(request, "id", 0);
+    const RunDeleteResult result = deleteRunHistoryEntry(runId);
+    if (result == RunDeleteResult::IN_USE) {
+      request->send(409, "application/json", "{\"error\":\"Run is being downloaded\"}");
       return;
     }
-    request->send(LittleFS, resultsPath, "text/csv");
+    if (result != RunDeleteResult::DELETED) {
+      request->send(404, "application/json", "{\"error\":\"No such completed run\"}");
+      return;
+    }
+    request->send(200, "application/json", "{\"ok\":true}");
   });
 
   server.on("/api/telemetry/status", HTTP_GET, [&cfg, &state](AsyncWebServerRequest *request) {
@@ -119,13 +443,125 @@ void setupApiRoutes(AsyncWebServer &server, AsyncWebSocket &ws, AppState &state,
       request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
       return;
     }
-    StaticJsonDocument<256> doc;
+    StaticJsonDocument<896> doc;
     doc["esc_voltage"] = state.escVoltage;
     doc["esc_current"] = state.escCurrent;
     doc["esc_telem_stale"] = state.escTelemStale;
     doc["esc_telem_age_ms"] = state.escTelemAgeMs;
+    const EscRpmStats rpmStats = getEscRpmStats();
+    JsonObject rpmObj = doc.createNestedObject("rpm");
+    rpmObj["rpm"] = state.escRpm;
+    rpmObj["stale"] = state.escRpmStale;
+    rpmObj["replies"] = rpmStats.replies;
+    rpmObj["errors"] = rpmStats.errors;
+    if (cfg.esc_telem_source == EscTelemSource::KISS) {
+      const EscSerialStats serialStats = getEscSerialStats();
+      JsonObject serialObj = doc.createNestedObject("kiss");
+      serialObj["temperature_c"] = state.escTemperatureC;
+      serialObj["consumed_mah"] = state.escConsumedMah;
+      serialObj["frames"] = serialStats.frames;
+      serialObj["crc_errors"] = serialStats.crcErrors;
+      serialObj["dropped"] = serialStats.dropped;
+    }
     doc["pwm"] = state.currentPwm;
     doc["state"] = (int)state.currentState;
+    LoadCellSamplerStats sampler = getLoadCellSamplerStats();
+    JsonObject samplerObj = doc.createNestedObject("sampler");
+    samplerObj["samples"] = sampler.samples;
+    samplerObj["dropped"] = sampler.dropped;
+    samplerObj["max_latency_us"] = sampler.maxLatencyUs;
+    samplerObj["pending"] = sampler.pending;
+    samplerObj["polled"] = sampler.polled;
+    ResultJournalStats journal = getResultJournalStats();
+    JsonObject journalObj = doc.createNestedObject("journal");
+    journalObj["run_id"] = journal.runId;
+    journalObj["samples"] = journal.samples;
+    journalObj["blocks_written"] = journal.blocksWritten;
+    journalObj["dropped_blocks"] = journal.droppedBlocks;
+    journalObj["full"] = journal.full;
+    journalObj["busy"] = journal.busy;
+    const SampleRateSummary rate = state.runRate.summary();
+    JsonObject rateObj = doc.createNestedObject("sample_rate");
+    rateObj["sps"] = rate.sps;
+    rateObj["mean_us"] = rate.meanUs;
+    rateObj["jitter_us"] = rate.stddevUs;
+    rateObj["max_us"] = rate.maxUs;
+    rateObj["gaps"] = rate.gaps;
+    String out;
+    serializeJson(doc, out);
+    request->send(200, "application/json", out);
+  });
+
+  // Registered before /api/perf, which would otherwise match it as a prefix.
+  server.on("/api/perf/reset", HTTP_POST, [&cfg, &state](AsyncWebServerRequest *request) {
+    if (!isAuthorizedRequest(cfg, state.wifiProvisioningMode, request)) {
+      request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+      return;
+    }
+    resetPerfStats();
+    request->send(200, "application/json", "{\"ok\":true}");
+  });
+
+  server.on("/api/perf", HTTP_GET, [&cfg, &state](AsyncWebServerRequest *request) {
+    if (!isAuthorizedRequest(cfg, state.wifiProvisioningMode, request)) {
+      request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+      return;
+    }
+    DynamicJsonDocument doc(256 + (size_t)PerfStage::COUNT * (128 + PERF_HISTOGRAM_BUCKETS * 16));
+    doc["enabled"] = (bool)ENABLE_PERF_STATS;
+    doc["window_ms"] = perfSinceResetMs();
+    doc["cpu_mhz"] = halCyclesPerMicrosecond();
+    JsonObject stages = doc.createNestedObject("stages");
+    for (size_t i = 0; i < (size_t)PerfStage::COUNT; i++) {
+      PerfStageStats stats;
+      getPerfStageStats((PerfStage)i, stats);
+      JsonObject stage = stages.createNestedObject(perfStageName((PerfStage)i));
+      stage["count"] = stats.count;
+      stage["min_us"] = stats.minUs;
+      stage["avg_us"] = stats.count ? (uint32_t)(stats.totalUs / stats.count) : 0;
+      stage["max_us"] = stats.maxUs;
+      // log2 buckets: [0] < 1 us, [i] in [2^(i-1), 2^i) us
+      JsonArray histogram = stage.createNestedArray("hist_log2_us");
+      for (size_t b = 0; b < PERF_HISTOGRAM_BUCKETS; b++) histogram.add(stats.histogram[b]);
+    }
+    String out;
+    serializeJson(doc, out);
+    request->send(200, "application/json", out);
+  });
+
+  // Send-queue health per WebSocket client, for sizing live rates to the link.
+  server.on("/api/ws", HTTP_GET, [&cfg, &state, &ws](AsyncWebServerRequest *request) {
+    if (!isAuthorizedRequest(cfg, state.wifiProvisioningMode, request)) {
+      request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+      return;
+    }
+    WsBroadcastStats totals;
+    getWsBroadcastStats(totals);
+    DynamicJsonDocument doc(384 + ws.count() * 384);
+    JsonObject total = doc.createNestedObject("totals");
+    total["payloads"] = totals.payloads;
+    total["shared"] = totals.shared;
+    total["queued"] = totals.queued;
+    total["live_dropped"] = totals.liveDropped;
+    total["dropped"] = totals.dropped;
+    JsonArray clients = doc.createNestedArray("clients");
+    auto wsClients = ws.getClients();
+    lockWsClientSessions();
+    for (auto clientPtr : wsClients) {
+      AsyncWebSocketClient *client = clientPtr;
+      WsClientSession *session = wsClientSession(client);
+      if (!session) continue;
+      JsonObject entry = clients.createNestedObject();
+      entry["id"] = client->id();
+      entry["binary"] = session->binaryLive;
+      entry["live_rate_hz"] = wsLiveRateHz(*session);
+      addWsChannelNames(entry.createNestedArray("channels"), session->channels);
+      entry["queue_full"] = client->queueIsFull();
+      entry["queued"] = session->stats.queued;
+      entry["live_dropped"] = session->stats.liveDropped;
+      entry["dropped"] = session->stats.dropped;
+    }
+    unlockWsClientSessions();
     String out;
     serializeJson(doc, out);
     request->send(200, "application/json", out);
@@ -136,12 +572,9 @@ void setupApiRoutes(AsyncWebServer &server, AsyncWebSocket &ws, AppState &state,
       request->send(401, "text/plain", "Unauthorized");
       return;
     }
-    String content;
-    size_t len = getDefaultBoardConfigLen();
-    content.reserve(len);
-    const char *pgm = getDefaultBoardConfigPgm();
-    for (size_t i = 0; i < len; i++) content += (char)pgm_read_byte(pgm + i);
-    request->send(200, "text/plain", content);
+    AsyncResponseStream *response = request->beginResponseStream("text/plain");
+    printDefaultBoardConfig(*response);
+    request->send(response);
   });
 
   server.on("/api/config/validate", HTTP_POST,
@@ -154,36 +587,8 @@ void setupApiRoutes(AsyncWebServer &server, AsyncWebSocket &ws, AppState &state,
             nullptr,
             [&cfg, &state](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
               if (!isAuthorizedRequest(cfg, state.wifiProvisioningMode, request)) return;
-              static String body;
-              if (index == 0) body = "";
-              if (total > 8192) {
-                request->send(400, "application/json", "{\"error\":\"Config too large\"}");
-                return;
-              }
-              for (size_t i = 0; i < len; i++) body += (char)data[i];
-              if (index + len != total) return;
-              if (body.length() == 0) {
-                request->send(400, "application/json", "{\"error\":\"Empty config\"}");
-                return;
-              }
-              BoardConfig backup = cfg;
-              setBoardConfigDefaults(cfg);
-              char errSection[32] = "";
-              char errKey[32] = "";
-              char errMessage[64] = "";
-              if (!parseConfigContentDetailed(body.c_str(), cfg, true, errSection, sizeof(errSection), errKey, sizeof(errKey), errMessage, sizeof(errMessage))) {
-                cfg = backup;
-                StaticJsonDocument<192> errDoc;
-                errDoc["error"] = "Invalid config";
-                errDoc["section"] = errSection;
-                errDoc["key"] = errKey;
-                errDoc["message"] = errMessage;
-                String out;
-                serializeJson(errDoc, out);
-                request->send(400, "application/json", out);
-                return;
-              }
-              cfg = backup;
+              if (!feedConfigUpload(request, data, len, index, total, false)) return;
+              releaseRequestBody(request);
               request->send(200, "application/json", "{\"status\":\"ok\"}");
             });
 
@@ -196,45 +601,32 @@ void setupApiRoutes(AsyncWebServer &server, AsyncWebSocket &ws, AppState &state,
             nullptr,
             [&cfg, &state](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
               if (!isAuthorizedRequest(cfg, state.wifiProvisioningMode, request)) return;
-              static String body;
-              if (index == 0) body = "";
-              if (total > 8192) {
-                request->send(400, "application/json", "{\"error\":\"Config too large\"}");
-                return;
-              }
-              for (size_t i = 0; i < len; i++) body += (char)data[i];
-              if (index + len != total) return;
-              if (body.length() == 0) {
-                request->send(400, "application/json", "{\"error\":\"Empty config\"}");
-                return;
-              }
-              BoardConfig backup = cfg;
-              setBoardConfigDefaults(cfg);
-              char errSection[32] = "";
-              char errKey[32] = "";
-              char errMessage[64] = "";
-              if (!parseConfigContentDetailed(body.c_str(), cfg, true, errSection, sizeof(errSection), errKey, sizeof(errKey), errMessage, sizeof(errMessage))) {
-                cfg = backup;
-                StaticJsonDocument<192> errDoc;
-                errDoc["error"] = "Invalid config";
-                errDoc["section"] = errSection;
-                errDoc["key"] = errKey;
-                errDoc["message"] = errMessage;
-                String out;
-                serializeJson(errDoc, out);
-                request->send(400, "application/json", out);
-                return;
-              }
+              ConfigUpload *upload = feedConfigUpload(request, data, len, index, total, true);
+              if (!upload) return;
               const char *cfgPath = getBoardConfigPath();
               File f = LittleFS.open(cfgPath, "w");
               if (!f) {
-                cfg = backup;
+                releaseRequestBody(request);
                 request->send(500, "application/json", "{\"error\":\"Failed to write config\"}");
                 return;
               }
-              f.print(body);
+              size_t bodyLen = 0;
+              const char *bodyText = requestBodyText(request, bodyLen);
+              f.write(reinterpret_cast<const uint8_t *>(bodyText), bodyLen);
               f.close();
-              request->send(200, "application/json", "{\"status\":\"saved\"}");
+              // loop() applies the live keys between ticks, or once the active run ends; the rest
+              // wait for a reboot.
+              DynamicJsonDocument doc(2048);
+              doc["status"] = "saved";
+              const bool deferred = testHoldsConfig(state.currentState);
+              ConfigChangeLists changes = {doc.createNestedArray(deferred ? "pending_live" : "applied_live"),
+                                           doc.createNestedArray("needs_reboot")};
+              queueLiveBoardConfig(upload->next, addConfigChange, &changes);
+              doc["reboot_required"] = changes.reboot.size() > 0;
+              releaseRequestBody(request);
+              String out;
+              serializeJson(doc, out);
+              request->send(200, "application/json", out);
             });
 
   server.on("/api/reboot", HTTP_POST, [&cfg, &state](AsyncWebServerRequest *request) {
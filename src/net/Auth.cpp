@@ -1,5 +1,7 @@
 #include "Auth.h"
 
+#include "net/WebSocketUtils.h"
+
 bool authEnabled(const BoardConfig &cfg, bool wifiProvisioningMode) {
   if (wifiProvisioningMode) return false;
   if (cfg.auth_token[0] == '\0') return false;
@@ -37,6 +39,6 @@ bool isAuthorizedRequest(const BoardConfig &cfg, bool wifiProvisioningMode, Asyn
 
 bool isAuthorizedWsClient(const BoardConfig &cfg, bool wifiProvisioningMode, AsyncWebSocketClient *client) {
   if (!authEnabled(cfg, wifiProvisioningMode)) return true;
-  if (client == nullptr) return false;
-  return client->_tempObject == (void *)1;
+  WsClientSession *session = wsClientSession(client);
+  return session != nullptr && session->authorized;
 }
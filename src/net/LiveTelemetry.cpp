@@ -0,0 +1,206 @@
+#include "LiveTelemetry.h"
+
+#include "ArduinoJson.h"
+#include "Auth.h"
+#include "net/WebSocketUtils.h"
+#include "util/Log.h"
+#include "util/Perf.h"
+
+// Worst case per JSON sample is "[4294967295,-99999999.99,65535]," (33 chars).
+static_assert(192 + LIVE_BATCH_MAX_SAMPLES * 33 <= WS_SCRATCH_SIZE, "live batch JSON must fit the WS scratch buffer");
+static const size_t LIVE_BATCH_BIN_BUF_SIZE = LIVE_BATCH_HEADER_SIZE + LIVE_BATCH_MAX_SAMPLES * LIVE_BATCH_SAMPLE_SIZE;
+// Only touched from loop(); shared by every batch instead of living on the stack.
+static uint8_t s_batchBinary[LIVE_BATCH_BIN_BUF_SIZE];
+
+static void putU16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v & 0xFF);
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void putU32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v & 0xFF);
+  p[1] = (uint8_t)((v >> 8) & 0xFF);
+  p[2] = (uint8_t)((v >> 16) & 0xFF);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static void putF32(uint8_t *p, float v) {
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  putU32(p, bits);
+}
+
+static uint16_t clampPwmU16(int pwm) {
+  if (pwm < 0) return 0;
+  if (pwm > 0xFFFF) return 0xFFFF;
+  return (uint16_t)pwm;
+}
+
+size_t encodeLiveDataBinary(const LiveDataFrame &frame, uint8_t *out, size_t outLen) {
+  if (!out || outLen < LIVE_FRAME_SIZE) return 0;
+  uint16_t flags = 0;
+  if (frame.escTelemStale) flags |= LIVE_FRAME_FLAG_TELEM_STALE;
+  out[0] = LIVE_FRAME_TYPE_DATA;
+  out[1] = LIVE_FRAME_VERSION;
+  putU16(out + 2, flags);
+  putU32(out + 4, (uint32_t)frame.timeMs);
+  putF32(out + 8, frame.thrust);
+  putU16(out + 12, clampPwmU16(frame.pwm));
+  putU16(out + 14, 0);
+  putF32(out + 16, frame.voltage);
+  putF32(out + 20, frame.current);
+  putU32(out + 24, (uint32_t)frame.escTelemAgeMs);
+  return LIVE_FRAME_SIZE;
+}
+
+size_t encodeLiveDataJson(const LiveDataFrame &frame, char *out, size_t outLen) {
+  PERF_SCOPE(JSON_ENCODE);
+  StaticJsonDocument<200> doc;
+  doc["type"] = "live_data";
+  doc["time"] = frame.timeMs;
+  doc["thrust"] = frame.thrust;
+  doc["pwm"] = frame.pwm;
+  doc["voltage"] = frame.voltage;
+  doc["current"] = frame.current;
+  doc["esc_telem_stale"] = frame.escTelemStale;
+  doc["esc_telem_age_ms"] = frame.escTelemAgeMs;
+  return serializeJson(doc, out, outLen);
+}
+
+// Live recipients are grouped by what they are sent, so each encoding is produced at most
+// once per publish and only when some client in its group is due one.
+struct LiveClientGroup {
+  bool binary;
+  bool decimated;
+  bool anyRate;
+};
+
+static bool isInLiveGroup(AsyncWebSocketClient *client, void *arg) {
+  const LiveClientGroup *group = static_cast<const LiveClientGroup *>(arg);
+  WsClientSession *session = wsClientSession(client);
+  const bool binary = session && session->binaryLive;
+  const bool decimated = session && session->liveIntervalMs > 0;
+  return binary == group->binary && (group->anyRate || decimated == group->decimated);
+}
+
+static WsBroadcastSpec liveSpec(LiveClientGroup &group) {
+  WsBroadcastSpec spec;
+  spec.channel = WS_CHANNEL_LIVE_DATA;
+  spec.live = true;
+  spec.filter = isInLiveGroup;
+  spec.arg = &group;
+  return spec;
+}
+
+static void broadcastLiveData(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode,
+                              LiveClientGroup &group, const LiveDataFrame &frame) {
+  const WsBroadcastSpec spec = liveSpec(group);
+  if (wsBroadcastTargets(ws, cfg, wifiProvisioningMode, spec) == 0) return;
+  if (group.binary) {
+    uint8_t binary[LIVE_FRAME_SIZE];
+    const size_t len = encodeLiveDataBinary(frame, binary, sizeof(binary));
+    wsBroadcast(ws, cfg, wifiProvisioningMode, spec, binary, len, true);
+  } else {
+    char json[256];
+    const size_t len = encodeLiveDataJson(frame, json, sizeof(json));
+    wsBroadcast(ws, cfg, wifiProvisioningMode, spec, reinterpret_cast<const uint8_t *>(json), len, false);
+  }
+}
+
+void publishLiveData(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, const LiveDataFrame &frame) {
+  PERF_SCOPE(WS_SEND);
+  LiveClientGroup jsonClients = {false, false, true};
+  LiveClientGroup binaryClients = {true, false, true};
+  broadcastLiveData(ws, cfg, wifiProvisioningMode, jsonClients, frame);
+  broadcastLiveData(ws, cfg, wifiProvisioningMode, binaryClients, frame);
+}
+
+size_t encodeLiveBatchBinary(const LiveBatch &batch, uint8_t *out, size_t outLen) {
+  if (!out || !batch.samples || batch.count == 0 || batch.count > 0xFFFF) return 0;
+  const size_t needed = LIVE_BATCH_HEADER_SIZE + batch.count * LIVE_BATCH_SAMPLE_SIZE;
+  if (outLen < needed) return 0;
+  uint16_t flags = 0;
+  if (batch.escTelemStale) flags |= LIVE_FRAME_FLAG_TELEM_STALE;
+  out[0] = LIVE_FRAME_TYPE_BATCH;
+  out[1] = LIVE_FRAME_VERSION;
+  putU16(out + 2, flags);
+  putU32(out + 4, batch.firstIndex);
+  putU16(out + 8, (uint16_t)batch.count);
+  putU16(out + 10, 0);
+  putF32(out + 12, batch.voltage);
+  putF32(out + 16, batch.current);
+  putU32(out + 20, (uint32_t)batch.escTelemAgeMs);
+  uint8_t *p = out + LIVE_BATCH_HEADER_SIZE;
+  for (size_t i = 0; i < batch.count; i++) {
+    const DataPoint &point = batch.samples[i];
+    putU32(p, (uint32_t)point.timestamp);
+    putF32(p + 4, point.thrust);
+    putU16(p + 8, clampPwmU16(point.pwm));
+    p += LIVE_BATCH_SAMPLE_SIZE;
+  }
+  return needed;
+}
+
+size_t encodeLiveBatchJson(const LiveBatch &batch, char *out, size_t outLen) {
+  PERF_SCOPE(JSON_ENCODE);
+  if (!out || outLen == 0 || !batch.samples || batch.count == 0) return 0;
+  // Hand-formatted: an ArduinoJson document for a full batch would need several KB.
+  int n = snprintf(out, outLen,
+                   "{\"type\":\"live_batch\",\"index\":%u,\"voltage\":%.2f,\"current\":%.2f,"
+                   "\"esc_telem_stale\":%s,\"esc_telem_age_ms\":%lu,\"samples\":[",
+                   (unsigned)batch.firstIndex,
+                   batch.voltage,
+                   batch.current,
+                   batch.escTelemStale ? "true" : "false",
+                   batch.escTelemAgeMs);
+  if (n < 0 || (size_t)n >= outLen) return 0;
+  size_t pos = (size_t)n;
+  for (size_t i = 0; i < batch.count; i++) {
+    const DataPoint &point = batch.samples[i];
+    n = snprintf(out + pos, outLen - pos, "%s[%lu,%.2f,%d]", i == 0 ? "" : ",", point.timestamp, point.thrust,
+                 point.pwm);
+    if (n < 0 || (size_t)n >= outLen - pos) return 0;
+    pos += (size_t)n;
+  }
+  if (outLen - pos < 3) return 0;
+  out[pos++] = ']';
+  out[pos++] = '}';
+  out[pos] = '\0';
+  return pos;
+}
+
+void publishLiveBatch(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, const LiveBatch &batch) {
+  PERF_SCOPE(WS_SEND);
+  if (!batch.samples || batch.count == 0) return;
+
+  LiveClientGroup binaryBatch = {true, false, false};
+  const WsBroadcastSpec binarySpec = liveSpec(binaryBatch);
+  if (wsBroadcastTargets(ws, cfg, wifiProvisioningMode, binarySpec) > 0) {
+    const size_t len = encodeLiveBatchBinary(batch, s_batchBinary, sizeof(s_batchBinary));
+    if (len == 0) logWarn("Live batch too large for binary buffer (%u samples)", (unsigned)batch.count);
+    wsBroadcast(ws, cfg, wifiProvisioningMode, binarySpec, s_batchBinary, len, true);
+  }
+  LiveClientGroup jsonBatch = {false, false, false};
+  const WsBroadcastSpec jsonSpec = liveSpec(jsonBatch);
+  if (wsBroadcastTargets(ws, cfg, wifiProvisioningMode, jsonSpec) > 0) {
+    const size_t len = encodeLiveBatchJson(batch, wsScratchBuffer(), WS_SCRATCH_SIZE);
+    if (len == 0) logWarn("Live batch too large for JSON buffer (%u samples)", (unsigned)batch.count);
+    wsBroadcast(ws, cfg, wifiProvisioningMode, jsonSpec, reinterpret_cast<const uint8_t *>(wsScratchBuffer()), len,
+                false);
+  }
+
+  // Clients on a reduced live rate get the batch's newest sample as a plain live_data frame.
+  const DataPoint &latest = batch.samples[batch.count - 1];
+  LiveDataFrame latestFrame;
+  latestFrame.timeMs = latest.timestamp;
+  latestFrame.thrust = latest.thrust;
+  latestFrame.pwm = latest.pwm;
+  latestFrame.voltage = batch.voltage;
+  latestFrame.current = batch.current;
+  latestFrame.escTelemStale = batch.escTelemStale;
+  latestFrame.escTelemAgeMs = batch.escTelemAgeMs;
+  LiveClientGroup binaryDecimated = {true, true, false};
+  LiveClientGroup jsonDecimated = {false, true, false};
+  broadcastLiveData(ws, cfg, wifiProvisioningMode, binaryDecimated, latestFrame);
+  broadcastLiveData(ws, cfg, wifiProvisioningMode, jsonDecimated, latestFrame);
+}
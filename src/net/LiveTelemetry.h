@@ -0,0 +1,65 @@
+#pragma once
+
+#include "AppState.h"
+#include "config/BoardConfig.h"
+#include <ESPAsyncWebServer.h>
+
+// Binary live_data frame (little-endian, LIVE_FRAME_SIZE bytes):
+//   0  u8   frame type (LIVE_FRAME_TYPE_DATA)
+//   1  u8   version (LIVE_FRAME_VERSION)
+//   2  u16  flags (bit 0: ESC telemetry stale)
+//   4  u32  time (ms)
+//   8  f32  thrust (g)
+//   12 u16  pwm (us)
+//   14 u16  reserved
+//   16 f32  voltage (V)
+//   20 f32  current (A)
+//   24 u32  ESC telemetry age (ms)
+static const uint8_t LIVE_FRAME_TYPE_DATA = 0x01;
+static const uint8_t LIVE_FRAME_VERSION = 1;
+static const uint16_t LIVE_FRAME_FLAG_TELEM_STALE = 0x0001;
+static const size_t LIVE_FRAME_SIZE = 28;
+
+// Binary live_batch frame (little-endian): LIVE_BATCH_HEADER_SIZE header followed by
+// count * LIVE_BATCH_SAMPLE_SIZE samples.
+//   0  u8   frame type (LIVE_FRAME_TYPE_BATCH)
+//   1  u8   version (LIVE_FRAME_VERSION)
+//   2  u16  flags (bit 0: ESC telemetry stale)
+//   4  u32  index of the first sample in the run
+//   8  u16  sample count
+//   10 u16  reserved
+//   12 f32  voltage (V)
+//   16 f32  current (A)
+//   20 u32  ESC telemetry age (ms)
+//   per sample: u32 time (ms), f32 thrust (g), u16 pwm (us)
+static const uint8_t LIVE_FRAME_TYPE_BATCH = 0x02;
+static const size_t LIVE_BATCH_HEADER_SIZE = 24;
+static const size_t LIVE_BATCH_SAMPLE_SIZE = 10;
+static const size_t LIVE_BATCH_MAX_SAMPLES = 48;
+
+struct LiveDataFrame {
+  unsigned long timeMs;
+  float thrust;
+  int pwm;
+  float voltage;
+  float current;
+  bool escTelemStale;
+  unsigned long escTelemAgeMs;
+};
+
+struct LiveBatch {
+  const DataPoint *samples;
+  size_t count;
+  uint32_t firstIndex;
+  float voltage;
+  float current;
+  bool escTelemStale;
+  unsigned long escTelemAgeMs;
+};
+
+size_t encodeLiveDataBinary(const LiveDataFrame &frame, uint8_t *out, size_t outLen);
+size_t encodeLiveDataJson(const LiveDataFrame &frame, char *out, size_t outLen);
+void publishLiveData(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, const LiveDataFrame &frame);
+size_t encodeLiveBatchBinary(const LiveBatch &batch, uint8_t *out, size_t outLen);
+size_t encodeLiveBatchJson(const LiveBatch &batch, char *out, size_t outLen);
+void publishLiveBatch(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, const LiveBatch &batch);
@@ -0,0 +1,68 @@
+#include "RequestBody.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct RequestBodyHeader {
+  size_t stateBytes;
+  size_t capacity; // body bytes kept, 0 without keepBody
+  size_t received;
+};
+
+// State and body start on pointer alignment after the header.
+static size_t alignUp(size_t n) { return (n + sizeof(void *) - 1) & ~(sizeof(void *) - 1); }
+
+static RequestBodyHeader *header(AsyncWebServerRequest *request) {
+  return request ? static_cast<RequestBodyHeader *>(request->_tempObject) : nullptr;
+}
+
+static uint8_t *stateOf(RequestBodyHeader *h) { return reinterpret_cast<uint8_t *>(h) + alignUp(sizeof(*h)); }
+
+static char *bodyOf(RequestBodyHeader *h) { return reinterpret_cast<char *>(stateOf(h) + alignUp(h->stateBytes)); }
+
+RequestBodyResult collectRequestBody(AsyncWebServerRequest *request,
+                                     const uint8_t *data,
+                                     size_t len,
+                                     size_t index,
+                                     size_t total,
+                                     size_t maxBytes,
+                                     size_t stateBytes,
+                                     bool keepBody) {
+  if (!request) return RequestBodyResult::DROPPED;
+  if (index == 0) {
+    releaseRequestBody(request);
+    if (total > maxBytes) return RequestBodyResult::TOO_LARGE;
+    const size_t capacity = keepBody ? total : 0;
+    const size_t bytes = alignUp(sizeof(RequestBodyHeader)) + alignUp(stateBytes) + capacity + 1;
+    RequestBodyHeader *h = static_cast<RequestBodyHeader *>(calloc(1, bytes));
+    if (!h) return RequestBodyResult::NO_MEMORY;
+    h->stateBytes = stateBytes;
+    h->capacity = capacity;
+    request->_tempObject = h;
+  }
+  RequestBodyHeader *h = header(request);
+  if (!h || index != h->received || index + len > total) return RequestBodyResult::DROPPED;
+  if (h->capacity > 0) {
+    if (index + len > h->capacity) return RequestBodyResult::DROPPED;
+    memcpy(bodyOf(h) + index, data, len);
+  }
+  h->received += len;
+  return h->received == total ? RequestBodyResult::COMPLETE : RequestBodyResult::PARTIAL;
+}
+
+void *requestBodyState(AsyncWebServerRequest *request) {
+  RequestBodyHeader *h = header(request);
+  return (h && h->stateBytes > 0) ? stateOf(h) : nullptr;
+}
+
+const char *requestBodyText(AsyncWebServerRequest *request, size_t &len) {
+  RequestBodyHeader *h = header(request);
+  len = h ? (h->capacity > 0 ? h->received : 0) : 0;
+  return h ? bodyOf(h) : nullptr;
+}
+
+void releaseRequestBody(AsyncWebServerRequest *request) {
+  if (!request || !request->_tempObject) return;
+  free(request->_tempObject);
+  request->_tempObject = nullptr;
+}
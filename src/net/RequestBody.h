@@ -0,0 +1,33 @@
+#pragma once
+
+#include <ESPAsyncWebServer.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-request scratch for POST body handlers, owned through AsyncWebServerRequest::_tempObject:
+// stateBytes of zeroed handler state, then (with keepBody) room for the whole body. It is one
+// malloc sized from `total` on the first chunk, chunks are memcpy'd in, and the server frees
+// _tempObject with the request, on disconnect too. Concurrent requests never share it.
+
+enum class RequestBodyResult : uint8_t {
+  PARTIAL,   // chunk stored, more to come
+  COMPLETE,  // last chunk stored
+  TOO_LARGE, // total over maxBytes; nothing allocated
+  NO_MEMORY,
+  DROPPED    // an earlier chunk was rejected or the body was released; ignore this one
+};
+
+RequestBodyResult collectRequestBody(AsyncWebServerRequest *request,
+                                     const uint8_t *data,
+                                     size_t len,
+                                     size_t index,
+                                     size_t total,
+                                     size_t maxBytes,
+                                     size_t stateBytes,
+                                     bool keepBody);
+// Handler state of the current request, nullptr before the first chunk or after release.
+void *requestBodyState(AsyncWebServerRequest *request);
+// NUL-terminated body (keepBody only); valid until released.
+const char *requestBodyText(AsyncWebServerRequest *request, size_t &len);
+// Frees the scratch early, e.g. once the body was rejected; later chunks come back DROPPED.
+void releaseRequestBody(AsyncWebServerRequest *request);
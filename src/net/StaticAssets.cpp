@@ -0,0 +1,70 @@
+#include "StaticAssets.h"
+
+#include "util/Log.h"
+#include <stdio.h>
+#include <string.h>
+
+static StaticAsset s_assets[] = {
+    {"/index.html", "text/html", "", false, false, 0, ""},
+    {"/wifi_setup.html", "text/html", "", false, false, 0, ""},
+};
+
+static const size_t ASSET_COUNT = sizeof(s_assets) / sizeof(s_assets[0]);
+
+// FNV-1a 64 over the file bytes; only needs to change when the file does.
+static bool hashFile(fs::FS &fs, const char *path, uint64_t &hash, size_t &size) {
+  File f = fs.open(path, "r");
+  if (!f) return false;
+  hash = 0xcbf29ce484222325ULL;
+  size = 0;
+  uint8_t buf[256];
+  size_t n;
+  while ((n = f.read(buf, sizeof(buf))) > 0) {
+    for (size_t i = 0; i < n; i++) hash = (hash ^ buf[i]) * 0x100000001b3ULL;
+    size += n;
+  }
+  f.close();
+  return true;
+}
+
+void initStaticAssets(fs::FS &fs) {
+  for (size_t i = 0; i < ASSET_COUNT; i++) {
+    StaticAsset &asset = s_assets[i];
+    snprintf(asset.filePath, sizeof(asset.filePath), "%s.gz", asset.path);
+    asset.gzip = fs.exists(asset.filePath);
+    if (!asset.gzip) snprintf(asset.filePath, sizeof(asset.filePath), "%s", asset.path);
+    uint64_t hash = 0;
+    asset.found = hashFile(fs, asset.filePath, hash, asset.size);
+    if (!asset.found) {
+      logWarn("Web asset %s missing from LittleFS", asset.path);
+      continue;
+    }
+    snprintf(asset.etag, sizeof(asset.etag), "\"%08lx%08lx\"", (unsigned long)(hash >> 32), (unsigned long)(hash & 0xFFFFFFFFUL));
+    logInfo("Web asset %s: %u bytes%s", asset.filePath, (unsigned)asset.size, asset.gzip ? " (gzip)" : "");
+  }
+}
+
+const StaticAsset *findStaticAsset(const char *path) {
+  for (size_t i = 0; i < ASSET_COUNT; i++) {
+    if (strcmp(s_assets[i].path, path) == 0) return s_assets[i].found ? &s_assets[i] : nullptr;
+  }
+  return nullptr;
+}
+
+bool etagMatches(const char *ifNoneMatch, const char *etag) {
+  if (!ifNoneMatch || !etag || !etag[0]) return false;
+  const size_t etagLen = strlen(etag);
+  const char *p = ifNoneMatch;
+  while (*p) {
+    while (*p == ' ' || *p == '\t' || *p == ',') p++;
+    if (*p == '*') return true;
+    if (p[0] == 'W' && p[1] == '/') p += 2; // If-None-Match uses weak comparison
+    const char *end = p;
+    while (*end && *end != ',') end++;
+    const char *tagEnd = end;
+    while (tagEnd > p && (tagEnd[-1] == ' ' || tagEnd[-1] == '\t')) tagEnd--;
+    if ((size_t)(tagEnd - p) == etagLen && strncmp(p, etag, etagLen) == 0) return true;
+    p = end;
+  }
+  return false;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <FS.h>
+#include <stddef.h>
+
+// Web UI pages in LittleFS. The filesystem build (extra_upload_fs.py) stores them gzip'd;
+// a plain copy is still served when no .gz is present. Each page gets a strong ETag from
+// the bytes of the file actually served, computed once at boot, so a reload that sends
+// If-None-Match is answered with a 304 and no body.
+
+struct StaticAsset {
+  const char *path;        // request path, e.g. "/index.html"
+  const char *contentType;
+  char filePath[32];       // file served: path + ".gz" when the gzip'd copy exists
+  bool gzip;
+  bool found;
+  size_t size;
+  char etag[20];           // quoted, e.g. "\"0123456789abcdef\""
+};
+
+void initStaticAssets(fs::FS &fs);
+// nullptr for paths that are not UI pages or were not found at boot.
+const StaticAsset *findStaticAsset(const char *path);
+// True if an If-None-Match value (a list of tags, possibly weak, or "*") names etag.
+bool etagMatches(const char *ifNoneMatch, const char *etag);
@@ -2,6 +2,7 @@
 
 #include "ArduinoJson.h"
 #include "Auth.h"
+#include "net/LiveTelemetry.h"
 #include "net/WebSocketUtils.h"
 #include "scale/LoadCellManager.h"
 #include "sim/Simulator.h"
@@ -19,6 +20,7 @@ static void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client,
 
   if (type == WS_EVT_CONNECT) {
     if (client) client->_tempObject = nullptr;
+    attachWsClientSession(client);
     if (client) client->keepAlivePeriod(10);
     Serial.printf("WebSocket client #%u connected\n", client->id());
     if (simEnabled(*s_cfg) && client) {
@@ -33,6 +35,7 @@ static void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client,
     }
   } else if (type == WS_EVT_DISCONNECT) {
     Serial.printf("WebSocket client #%u disconnected\n", client->id());
+    releaseWsClientSession(client);
   } else if (type == WS_EVT_DATA) {
     AwsFrameInfo *info = (AwsFrameInfo *)arg;
     if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
@@ -44,14 +47,20 @@ static void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client,
 
       const char *command = doc["command"];
 
-      if (authEnabled(*s_cfg, s_state->wifiProvisioningMode) && !isAuthorizedWsClient(*s_cfg, s_state->wifiProvisioningMode, client)) {
+      lockWsClientSessions();
+      const bool authorized = isAuthorizedWsClient(*s_cfg, s_state->wifiProvisioningMode, client);
+      unlockWsClientSessions();
+      if (authEnabled(*s_cfg, s_state->wifiProvisioningMode) && !authorized) {
         const char *token = doc["token"];
         if (!tokenMatches(*s_cfg, s_state->wifiProvisioningMode, token)) {
           logWarn("WebSocket unauthorized message");
           if (client) client->close();
           return;
         }
-        if (client) client->_tempObject = (void *)1;
+        lockWsClientSessions();
+        WsClientSession *session = wsClientSession(client);
+        if (session) session->authorized = true;
+        unlockWsClientSessions();
         if (command && strcmp(command, "auth") == 0) return;
       }
 
@@ -66,6 +75,55 @@ static void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client,
         return;
       }
 
+      if (strcmp(command, "set_live_format") == 0) {
+        const char *format = doc["format"] | "json";
+        lockWsClientSessions();
+        WsClientSession *session = wsClientSession(client);
+        if (session) session->binaryLive = (strcmp(format, "binary") == 0);
+        const bool binaryLive = session && session->binaryLive;
+        unlockWsClientSessions();
+        StaticJsonDocument<96> resp;
+        resp["type"] = "live_format";
+        resp["format"] = binaryLive ? "binary" : "json";
+        resp["version"] = LIVE_FRAME_VERSION;
+        char out[128];
+        size_t outLen = serializeJson(resp, out, sizeof(out));
+        if (client && outLen > 0) client->text(out);
+        return;
+      }
+
+      if (strcmp(command, "subscribe") == 0) {
+        // {"command":"subscribe","channels":["live_data","logs"],"live_rate_hz":10}
+        // Omitted fields keep their current value; live_rate_hz 0 means every frame.
+        JsonArray channels = doc["channels"];
+        uint8_t mask = 0;
+        if (!channels.isNull()) {
+          for (JsonVariant name : channels) mask |= wsChannelFromName(name.as<const char *>());
+        }
+        lockWsClientSessions();
+        WsClientSession *session = wsClientSession(client);
+        if (!session) {
+          unlockWsClientSessions();
+          return;
+        }
+        if (!channels.isNull()) session->channels = mask;
+        if (doc.containsKey("live_rate_hz")) {
+          const long rateHz = doc["live_rate_hz"] | 0L;
+          setWsLiveRate(*session, rateHz <= 0 ? 0 : rateHz > WS_LIVE_RATE_MAX_HZ ? WS_LIVE_RATE_MAX_HZ : (uint16_t)rateHz);
+        }
+        const uint8_t subscribed = session->channels;
+        const uint16_t liveRateHz = wsLiveRateHz(*session);
+        unlockWsClientSessions();
+        StaticJsonDocument<192> resp;
+        resp["type"] = "subscribed";
+        addWsChannelNames(resp.createNestedArray("channels"), subscribed);
+        resp["live_rate_hz"] = liveRateHz;
+        char out[192];
+        size_t outLen = serializeJson(resp, out, sizeof(out));
+        if (client && outLen > 0) client->text(out);
+        return;
+      }
+
       if (strcmp(command, "start_test") == 0) {
         if (s_state->currentState == State::IDLE) {
           const char *sequence = doc["sequence"];
@@ -76,7 +134,7 @@ static void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client,
           }
           Serial.printf("Received test sequence: %s\n", sequence);
           if (parseAndStoreSequence(*s_state, *s_cfg, sequence)) {
-            deleteLastResultsFile();
+            s_state->testStartEpoch = doc["epoch"] | 0UL;
             Serial.println("Sequence parsed successfully. Starting pre-test tare.");
             startPreTestTare(*s_state, *s_cfg);
           } else {
@@ -90,10 +148,12 @@ static void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client,
       } else if (strcmp(command, "reset") == 0) {
         setEscThrottlePwm(*s_state, *s_cfg, simEnabled(*s_cfg), s_cfg->min_pulse_width);
         resetTest(*s_state);
-        notifyClients(*server, *s_cfg, s_state->wifiProvisioningMode, "{\"type\":\"status\", \"message\":\"System reset.\"}");
+        notifyClients(*server, *s_cfg, s_state->wifiProvisioningMode,
+                      "{\"type\":\"status\", \"message\":\"System reset.\"}");
       } else if (strcmp(command, "tare") == 0) {
         tareScale(simEnabled(*s_cfg), s_loadCell, *s_state);
-        notifyClients(*server, *s_cfg, s_state->wifiProvisioningMode, "{\"type\":\"status\", \"message\":\"Scale tared.\"}");
+        notifyClients(*server, *s_cfg, s_state->wifiProvisioningMode,
+                      "{\"type\":\"status\", \"message\":\"Scale tared.\"}");
       } else if (strcmp(command, "set_scale_factor") == 0) {
         if (doc.containsKey("value")) {
           float newFactor = doc["value"];
@@ -142,5 +202,6 @@ void configureWebSocket(AsyncWebSocket &ws, AppState &state, BoardConfig &cfg, H
   s_state = &state;
   s_cfg = &cfg;
   s_loadCell = loadCell;
+  initWsClientSessions();
   ws.onEvent(onWsEvent);
 }
@@ -1,26 +1,250 @@
 #include "WebSocketUtils.h"
 
 #include "Auth.h"
+#include "hal/Hal.h"
+#include "util/Perf.h"
+#include <new>
+#include <string.h>
 
-void notifyClients(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, const String &message) {
+static char s_wsScratch[WS_SCRATCH_SIZE];
+
+char *wsScratchBuffer() { return s_wsScratch; }
+
+static HalMutex s_sessionMutex = nullptr;
+// Sessions of disconnected clients, waiting for loop() to free them.
+static WsClientSession *s_retiredSessions = nullptr;
+
+void initWsClientSessions() {
+  if (!s_sessionMutex) s_sessionMutex = halCreateMutex();
+}
+
+void lockWsClientSessions() { halLock(s_sessionMutex); }
+
+void unlockWsClientSessions() { halUnlock(s_sessionMutex); }
+
+void attachWsClientSession(AsyncWebSocketClient *client) {
+  if (!client) return;
+  WsClientSession *session = new (std::nothrow) WsClientSession();
+  lockWsClientSessions();
+  client->_tempObject = session;
+  unlockWsClientSessions();
+}
+
+void releaseWsClientSession(AsyncWebSocketClient *client) {
+  if (!client) return;
+  lockWsClientSessions();
+  WsClientSession *session = static_cast<WsClientSession *>(client->_tempObject);
+  client->_tempObject = nullptr;
+  if (session) {
+    session->nextRetired = s_retiredSessions;
+    s_retiredSessions = session;
+  }
+  unlockWsClientSessions();
+}
+
+void reapWsClientSessions() {
+  lockWsClientSessions();
+  WsClientSession *session = s_retiredSessions;
+  s_retiredSessions = nullptr;
+  unlockWsClientSessions();
+  while (session) {
+    WsClientSession *next = session->nextRetired;
+    delete session;
+    session = next;
+  }
+}
+
+WsClientSession *wsClientSession(AsyncWebSocketClient *client) {
+  if (!client) return nullptr;
+  return static_cast<WsClientSession *>(client->_tempObject);
+}
+
+struct WsChannelName {
+  uint8_t channel;
+  const char *name;
+};
+
+static const WsChannelName WS_CHANNEL_NAMES[] = {
+    {WS_CHANNEL_LIVE_DATA, "live_data"},
+    {WS_CHANNEL_STEP_SUMMARY, "step_summary"},
+    {WS_CHANNEL_RESULTS, "results"},
+    {WS_CHANNEL_LOGS, "logs"},
+};
+
+uint8_t wsChannelFromName(const char *name) {
+  if (!name) return 0;
+  for (const WsChannelName &entry : WS_CHANNEL_NAMES) {
+    if (strcmp(entry.name, name) == 0) return entry.channel;
+  }
+  return 0;
+}
+
+const char *wsChannelName(uint8_t channel) {
+  for (const WsChannelName &entry : WS_CHANNEL_NAMES) {
+    if (entry.channel == channel) return entry.name;
+  }
+  return nullptr;
+}
+
+void addWsChannelNames(JsonArray out, uint8_t mask) {
+  for (const WsChannelName &entry : WS_CHANNEL_NAMES) {
+    if (mask & entry.channel) out.add(entry.name);
+  }
+}
+
+uint16_t setWsLiveRate(WsClientSession &session, uint16_t rateHz) {
+  if (rateHz > WS_LIVE_RATE_MAX_HZ) rateHz = WS_LIVE_RATE_MAX_HZ;
+  session.liveIntervalMs = rateHz == 0 ? 0 : (uint16_t)(1000 / rateHz);
+  session.liveSent = false;
+  return wsLiveRateHz(session);
+}
+
+uint16_t wsLiveRateHz(const WsClientSession &session) {
+  return session.liveIntervalMs == 0 ? 0 : (uint16_t)(1000 / session.liveIntervalMs);
+}
+
+bool wsClientWants(AsyncWebSocketClient *client, uint8_t channel) {
+  WsClientSession *session = wsClientSession(client);
+  // Clients without a session (allocation failed) keep the old receive-everything behaviour.
+  return !session || (session->channels & channel) != 0;
+}
+
+bool wsLiveFrameDue(AsyncWebSocketClient *client, unsigned long nowMs) {
+  WsClientSession *session = wsClientSession(client);
+  if (!session || session->liveIntervalMs == 0 || !session->liveSent) return true;
+  return nowMs - session->lastLiveMs >= session->liveIntervalMs;
+}
+
+void markWsLiveFrameSent(AsyncWebSocketClient *client, unsigned long nowMs) {
+  WsClientSession *session = wsClientSession(client);
+  if (!session) return;
+  session->lastLiveMs = nowMs;
+  session->liveSent = true;
+}
+
+// Clients past this index in the list are never broadcast to; the server keeps far fewer.
+static const size_t WS_MAX_BROADCAST_CLIENTS = 32;
+
+static WsBroadcastStats s_broadcastStats = {};
+
+static bool isBroadcastTarget(const BoardConfig &cfg, bool wifiProvisioningMode, const WsBroadcastSpec &spec,
+                              AsyncWebSocketClient *client, unsigned long nowMs) {
+  if (!client || client->status() != WS_CONNECTED) return false;
+  if (!isAuthorizedWsClient(cfg, wifiProvisioningMode, client)) return false;
+  if (spec.channel != 0 && !wsClientWants(client, spec.channel)) return false;
+  if (spec.filter && !spec.filter(client, spec.arg)) return false;
+  return !spec.live || wsLiveFrameDue(client, nowMs);
+}
+
+size_t wsBroadcastTargets(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode,
+                          const WsBroadcastSpec &spec) {
+  const unsigned long now = halMillis();
+  size_t targets = 0;
+  size_t index = 0;
   auto clients = ws.getClients();
+  lockWsClientSessions();
   for (auto clientPtr : clients) {
-    AsyncWebSocketClient *client = clientPtr;
-    if (isAuthorizedWsClient(cfg, wifiProvisioningMode, client)) {
-      client->text(message.c_str());
-    }
+    if (index++ >= WS_MAX_BROADCAST_CLIENTS) break;
+    if (isBroadcastTarget(cfg, wifiProvisioningMode, spec, clientPtr, now)) targets++;
   }
+  unlockWsClientSessions();
+  return targets;
 }
 
-void notifyClients(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, const char *message) {
-  if (!message) return;
+size_t wsBroadcast(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, const WsBroadcastSpec &spec,
+                   const uint8_t *data, size_t len, bool binary) {
+  if (!data || len == 0) return 0;
+  PERF_SCOPE(WS_SEND);
+  const unsigned long now = halMillis();
+
+  // Pick the targets and do the accounting first, so the payload can go out in one piece.
+  uint32_t targetMask = 0;
+  size_t targets = 0;
+  bool everyConnectedClient = true;
+  size_t connected = 0;
+  size_t index = 0;
   auto clients = ws.getClients();
+  lockWsClientSessions();
   for (auto clientPtr : clients) {
     AsyncWebSocketClient *client = clientPtr;
-    if (isAuthorizedWsClient(cfg, wifiProvisioningMode, client)) {
-      client->text(message);
+    const size_t i = index++;
+    if (client && client->status() == WS_CONNECTED) connected++;
+    bool target = i < WS_MAX_BROADCAST_CLIENTS && isBroadcastTarget(cfg, wifiProvisioningMode, spec, client, now);
+    WsClientSession *session = wsClientSession(client);
+    if (target && client->queueIsFull()) {
+      if (spec.live) {
+        if (session) session->stats.liveDropped++;
+        s_broadcastStats.liveDropped++;
+        everyConnectedClient = false;
+      } else {
+        // Lost either way; a shared buffer may still go to it, the library discards it there.
+        if (session) session->stats.dropped++;
+        s_broadcastStats.dropped++;
+      }
+      continue;
     }
+    if (!target) {
+      if (client && client->status() == WS_CONNECTED) everyConnectedClient = false;
+      continue;
+    }
+    targetMask |= 1UL << i;
+    targets++;
+    if (session) session->stats.queued++;
+    if (spec.live) markWsLiveFrameSent(client, now);
   }
+  unlockWsClientSessions();
+  if (targets == 0) return 0;
+  s_broadcastStats.payloads++;
+  s_broadcastStats.queued += targets;
+
+  // textAll() reaches every client connected when it runs, including one the async_tcp task
+  // accepted after the scan that has not authenticated or subscribed yet. With auth on, share
+  // only while the connected count still matches the scan; otherwise send per client.
+  if (everyConnectedClient && (!authEnabled(cfg, wifiProvisioningMode) || ws.count() == connected)) {
+    AsyncWebSocketMessageBuffer *buffer = ws.makeBuffer(const_cast<uint8_t *>(data), len);
+    if (buffer) {
+      if (binary) {
+        ws.binaryAll(buffer);
+      } else {
+        ws.textAll(buffer);
+      }
+      s_broadcastStats.shared++;
+      return targets;
+    }
+  }
+  index = 0;
+  for (auto clientPtr : clients) {
+    AsyncWebSocketClient *client = clientPtr;
+    const size_t i = index++;
+    if (i >= WS_MAX_BROADCAST_CLIENTS) break;
+    if (!(targetMask & (1UL << i))) continue;
+    if (binary) {
+      client->binary(data, len);
+    } else {
+      client->text(reinterpret_cast<const char *>(data), len);
+    }
+  }
+  return targets;
+}
+
+void getWsBroadcastStats(WsBroadcastStats &out) { out = s_broadcastStats; }
+
+void notifyClients(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, const String &message) {
+  notifyClients(ws, cfg, wifiProvisioningMode, message.c_str());
+}
+
+void notifyClients(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, const char *message) {
+  if (!message) return;
+  WsBroadcastSpec spec;
+  wsBroadcast(ws, cfg, wifiProvisioningMode, spec, reinterpret_cast<const uint8_t *>(message), strlen(message), false);
+}
+
+void notifyChannel(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, uint8_t channel,
+                   const char *message) {
+  if (!message) return;
+  WsBroadcastSpec spec;
+  spec.channel = channel;
+  wsBroadcast(ws, cfg, wifiProvisioningMode, spec, reinterpret_cast<const uint8_t *>(message), strlen(message), false);
 }
 
 bool hasWsClients(AsyncWebSocket &ws) {
@@ -30,3 +254,25 @@ bool hasWsClients(AsyncWebSocket &ws) {
   }
   return false;
 }
+
+bool wsChannelHasClients(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, uint8_t channel) {
+  WsBroadcastSpec spec;
+  spec.channel = channel;
+  return wsBroadcastTargets(ws, cfg, wifiProvisioningMode, spec) > 0;
+}
+
+bool wsClientsCanQueue(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, uint8_t channel) {
+  bool canQueue = true;
+  auto clients = ws.getClients();
+  lockWsClientSessions();
+  for (auto clientPtr : clients) {
+    AsyncWebSocketClient *client = clientPtr;
+    if (isAuthorizedWsClient(cfg, wifiProvisioningMode, client) && wsClientWants(client, channel) &&
+        client->queueIsFull()) {
+      canQueue = false;
+      break;
+    }
+  }
+  unlockWsClientSessions();
+  return canQueue;
+}
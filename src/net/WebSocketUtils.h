@@ -1,8 +1,117 @@
 #pragma once
 
+#include "ArduinoJson.h"
 #include "config/BoardConfig.h"
 #include <ESPAsyncWebServer.h>
 
+// Broadcast channels a client can subscribe to (bitmask). Command replies and safety
+// shutdowns go to every authorized client regardless of its subscription.
+//   live_data     live_data/live_batch frames, sample_rate, esc_telemetry
+//   step_summary  step_summary at the end of each step
+//   results       final_results_start/chunk/end
+//   logs          status and warning messages raised by the test runner
+static const uint8_t WS_CHANNEL_LIVE_DATA = 0x01;
+static const uint8_t WS_CHANNEL_STEP_SUMMARY = 0x02;
+static const uint8_t WS_CHANNEL_RESULTS = 0x04;
+static const uint8_t WS_CHANNEL_LOGS = 0x08;
+static const uint8_t WS_CHANNEL_ALL = 0x0F;
+// Fastest live rate a client can ask for; 0 Hz means every frame and batch.
+static const uint16_t WS_LIVE_RATE_MAX_HZ = 100;
+
+// Per-client send accounting, kept for as long as the connection lasts.
+struct WsClientStats {
+  uint32_t queued = 0;      // messages queued on this client
+  uint32_t liveDropped = 0; // live frames skipped because its send queue was full
+  uint32_t dropped = 0;     // other messages lost because its send queue was full
+};
+
+// Totals over every client since boot, including clients that have disconnected.
+struct WsBroadcastStats {
+  uint32_t payloads;    // broadcasts queued on at least one client
+  uint32_t shared;      // of those, queued as one buffer shared by every connected client
+  uint32_t queued;
+  uint32_t liveDropped;
+  uint32_t dropped;
+};
+
+// Per-connection state, owned through AsyncWebSocketClient::_tempObject. The async_tcp task
+// attaches and updates it while loop() broadcasts, so it is only touched with the sessions
+// locked, and only loop() frees it.
+struct WsClientSession {
+  bool authorized = false;
+  bool binaryLive = false;
+  uint8_t channels = WS_CHANNEL_ALL;
+  // Non-zero: live data is decimated to the latest sample at most once per interval.
+  uint16_t liveIntervalMs = 0;
+  unsigned long lastLiveMs = 0;
+  bool liveSent = false;
+  WsClientStats stats;
+  WsClientSession *nextRetired = nullptr;
+};
+
+// Extra recipient selection for a broadcast, e.g. by live format.
+typedef bool (*WsClientFilter)(AsyncWebSocketClient *client, void *arg);
+
+// Who a broadcast goes to: connected, authorized clients subscribed to channel (0: every
+// one of them) that pass filter. Live broadcasts follow each client's live rate and are
+// skipped for clients whose send queue is full. The library discards any message sent to a
+// full queue, so other broadcasts are lost for such clients too and counted as dropped;
+// senders that must not lose data (result chunks) wait on wsClientsCanQueue first.
+struct WsBroadcastSpec {
+  uint8_t channel = 0;
+  bool live = false;
+  WsClientFilter filter = nullptr;
+  void *arg = nullptr;
+};
+
+// Scratch buffer for hand-formatted text frames (live batches, result chunks).
+// Only valid for use from loop(); the contents are copied when a frame is queued.
+static const size_t WS_SCRATCH_SIZE = 2048;
+char *wsScratchBuffer();
+
+// Creates the session lock; call before the server starts accepting clients.
+void initWsClientSessions();
+void lockWsClientSessions();
+void unlockWsClientSessions();
+void attachWsClientSession(AsyncWebSocketClient *client);
+// Detaches the session on disconnect; reapWsClientSessions() frees it later from loop().
+void releaseWsClientSession(AsyncWebSocketClient *client);
+void reapWsClientSessions();
+// The session and the helpers below that take a client need the sessions locked; the
+// broadcast functions lock them themselves.
+WsClientSession *wsClientSession(AsyncWebSocketClient *client);
+
+// Channel bit for a subscription name, 0 if unknown.
+uint8_t wsChannelFromName(const char *name);
+const char *wsChannelName(uint8_t channel);
+// Appends the name of every channel in mask.
+void addWsChannelNames(JsonArray out, uint8_t mask);
+// Sets the decimated live rate; 0 restores every frame. Returns the rate actually applied.
+uint16_t setWsLiveRate(WsClientSession &session, uint16_t rateHz);
+uint16_t wsLiveRateHz(const WsClientSession &session);
+bool wsClientWants(AsyncWebSocketClient *client, uint8_t channel);
+// True when this client is due a decimated live frame at nowMs (always true at full rate).
+bool wsLiveFrameDue(AsyncWebSocketClient *client, unsigned long nowMs);
+void markWsLiveFrameSent(AsyncWebSocketClient *client, unsigned long nowMs);
+
+// Clients a broadcast would reach, ignoring full send queues; callers use it to skip
+// encoding payloads nobody wants.
+size_t wsBroadcastTargets(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode,
+                          const WsBroadcastSpec &spec);
+// Queues one payload on every target. When the targets are every connected client the
+// payload is copied once into a buffer their queues share, otherwise once per target.
+// Returns the number of clients it was queued on.
+size_t wsBroadcast(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, const WsBroadcastSpec &spec,
+                   const uint8_t *data, size_t len, bool binary);
+void getWsBroadcastStats(WsBroadcastStats &out);
+
 void notifyClients(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, const String &message);
 void notifyClients(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, const char *message);
+// Sends only to authorized clients subscribed to channel.
+void notifyChannel(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, uint8_t channel,
+                   const char *message);
 bool hasWsClients(AsyncWebSocket &ws);
+// True when some authorized client is subscribed to channel, so callers can skip encoding.
+bool wsChannelHasClients(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, uint8_t channel);
+// False while any authorized client subscribed to channel has a full send queue.
+bool wsClientsCanQueue(AsyncWebSocket &ws, const BoardConfig &cfg, bool wifiProvisioningMode, uint8_t channel);
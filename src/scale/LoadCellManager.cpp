@@ -1,8 +1,95 @@
 #include "LoadCellManager.h"
 
 #include "FS.h"
+#include "HX711_ADC.h"
 #include "LittleFS.h"
+#include "hal/Hal.h"
+#include "util/SpscRing.h"
 #include <Arduino.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+
+static const uint32_t SAMPLER_TASK_STACK = 3072;
+static const UBaseType_t SAMPLER_TASK_PRIORITY = 3; // above loopTask (1) on the same core
+static const BaseType_t SAMPLER_TASK_CORE = 1;
+// Fall back to polling DOUT after this many conversion periods without a data-ready edge.
+static const uint32_t DRDY_TIMEOUT_PERIODS = 3;
+
+static SpscRing<ThrustSample, 128> s_sampleRing;
+static SemaphoreHandle_t s_loadCellMutex = nullptr;
+static TaskHandle_t s_samplerTask = nullptr;
+static std::atomic<uint32_t> s_samplerSamples{0};
+static std::atomic<uint32_t> s_samplerDropped{0};
+static std::atomic<uint32_t> s_samplerMaxLatencyUs{0};
+static std::atomic<uint32_t> s_samplerPolled{0};
+static int s_doutPin = -1;
+static TickType_t s_drdyTimeoutTicks = portMAX_DELAY;
+// Written by the data-ready ISR; s_drdyUs is only read while s_drdyPending is set.
+static volatile bool s_drdyPending = false;
+static volatile int64_t s_drdyUs = 0;
+// Samples captured before the last tare finished are discarded by the consumer; 0 until
+// the first tare. Kept at 64 bits so the comparison never wraps.
+static std::atomic<uint64_t> s_tareDoneUs{0};
+
+static void lockLoadCell() {
+  if (s_loadCellMutex) xSemaphoreTake(s_loadCellMutex, portMAX_DELAY);
+}
+
+static void unlockLoadCell() {
+  if (s_loadCellMutex) xSemaphoreGive(s_loadCellMutex);
+}
+
+// DOUT falls when a conversion is ready. The ISR stamps that edge and wakes the sampler;
+// further edges while DOUT toggles during readout are ignored until the read is done.
+static void IRAM_ATTR hx711DataReadyIsr(void *arg) {
+  (void)arg;
+  if (s_drdyPending || !s_samplerTask) return;
+  s_drdyUs = esp_timer_get_time();
+  s_drdyPending = true;
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(s_samplerTask, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+static void loadCellSamplerTask(void *arg) {
+  HX711_ADC *loadCell = static_cast<HX711_ADC *>(arg);
+  for (;;) {
+    uint64_t stampUs;
+    bool polled = false;
+    if (ulTaskNotifyTake(pdTRUE, s_drdyTimeoutTicks) > 0) {
+      stampUs = (uint64_t)s_drdyUs;
+    } else {
+      // No edge for a few conversion periods: either it was missed or DOUT was already low
+      // when the interrupt was attached. HX711 holds DOUT low until read, so poll it once.
+      if (digitalRead(s_doutPin) != LOW) continue;
+      s_drdyPending = true;
+      stampUs = halMicros64();
+      polled = true;
+    }
+    bool ready = false;
+    ThrustSample sample;
+    lockLoadCell();
+    // A conversion already consumed by tare() leaves DOUT high and update() returns 0.
+    if (loadCell->update()) {
+      sample.timestampUs = stampUs;
+      sample.timestampMs = (unsigned long)(stampUs / 1000);
+      sample.thrust = loadCell->getData();
+      ready = true;
+    }
+    unlockLoadCell();
+    s_drdyPending = false;
+    if (!ready) continue;
+    if (polled) s_samplerPolled.fetch_add(1, std::memory_order_relaxed);
+    if (s_sampleRing.push(sample)) {
+      s_samplerSamples.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      s_samplerDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
 
 void saveScaleFactor(const BoardConfig &cfg, float value) {
   File file = LittleFS.open(cfg.scale_factor_file, "w");
@@ -33,6 +120,11 @@ float loadScaleFactor(const BoardConfig &cfg) {
 void initLoadCell(bool simEnabled, HX711_ADC *loadCell, const BoardConfig &cfg, AppState &state) {
   if (simEnabled) return;
   if (!loadCell) return;
+  if (cfg.hx711_rate_pin >= 0) {
+    // RATE high selects 80 SPS, low 10 SPS; it must settle before the first conversion.
+    pinMode(cfg.hx711_rate_pin, OUTPUT);
+    digitalWrite(cfg.hx711_rate_pin, cfg.hx711_rate == 80 ? HIGH : LOW);
+  }
   loadCell->begin();
   state.scaleFactor = loadScaleFactor(cfg);
   loadCell->setCalFactor(state.scaleFactor);
@@ -42,31 +134,99 @@ void initLoadCell(bool simEnabled, HX711_ADC *loadCell, const BoardConfig &cfg,
   Serial.println("Startup Tare Complete.");
 }
 
-bool readThrust(bool simEnabled, HX711_ADC *loadCell, AppState &state, float *out) {
+bool startLoadCellSampler(HX711_ADC *loadCell, const BoardConfig &cfg) {
+  if (!loadCell || s_samplerTask) return false;
+  s_doutPin = cfg.hx711_dout_pin;
+  const uint32_t periodMs = 1000 / (uint32_t)(cfg.hx711_rate > 0 ? cfg.hx711_rate : 10);
+  s_drdyTimeoutTicks = pdMS_TO_TICKS(periodMs * DRDY_TIMEOUT_PERIODS);
+  if (s_drdyTimeoutTicks == 0) s_drdyTimeoutTicks = 1;
+  s_loadCellMutex = xSemaphoreCreateMutex();
+  if (!s_loadCellMutex) {
+    Serial.println("Failed to create load cell mutex!");
+    return false;
+  }
+  BaseType_t ok = xTaskCreatePinnedToCore(loadCellSamplerTask, "hx711", SAMPLER_TASK_STACK, loadCell,
+                                          SAMPLER_TASK_PRIORITY, &s_samplerTask, SAMPLER_TASK_CORE);
+  if (ok != pdPASS) {
+    Serial.println("Failed to start load cell sampler task!");
+    s_samplerTask = nullptr;
+    return false;
+  }
+  attachInterruptArg(digitalPinToInterrupt(s_doutPin), hx711DataReadyIsr, nullptr, FALLING);
+  Serial.printf("Load cell sampler task started (%d SPS, data-ready on GPIO %d).\n", cfg.hx711_rate, s_doutPin);
+  return true;
+}
+
+bool readThrustSample(bool simEnabled, AppState &state, ThrustSample *out) {
   if (out == nullptr) return false;
   if (simEnabled) {
-    *out = state.simThrust;
+    out->timestampUs = halMicros64();
+    out->timestampMs = (unsigned long)(out->timestampUs / 1000);
+    out->thrust = state.simThrust;
     return true;
   }
-  if (loadCell && loadCell->update()) {
-    *out = loadCell->getData();
+  ThrustSample sample;
+  while (s_sampleRing.pop(sample)) {
+    if (sampleBeforeTare(sample.timestampUs, s_tareDoneUs.load(std::memory_order_acquire))) continue;
+    uint32_t latencyUs = (uint32_t)(halMicros64() - sample.timestampUs);
+    if (latencyUs > s_samplerMaxLatencyUs.load(std::memory_order_relaxed)) {
+      s_samplerMaxLatencyUs.store(latencyUs, std::memory_order_relaxed);
+    }
+    *out = sample;
     return true;
   }
-  *out = 0.0f;
   return false;
 }
 
+bool readThrust(bool simEnabled, HX711_ADC *loadCell, AppState &state, float *out) {
+  (void)loadCell;
+  if (out == nullptr) return false;
+  // Drain everything queued by the sampler and report the newest value.
+  ThrustSample sample;
+  bool haveSample = false;
+  while (readThrustSample(simEnabled, state, &sample)) {
+    haveSample = true;
+    if (simEnabled) break;
+  }
+  *out = haveSample ? sample.thrust : 0.0f;
+  return haveSample;
+}
+
+LoadCellSamplerStats getLoadCellSamplerStats() {
+  LoadCellSamplerStats stats;
+  stats.samples = s_samplerSamples.load(std::memory_order_relaxed);
+  stats.dropped = s_samplerDropped.load(std::memory_order_relaxed);
+  stats.maxLatencyUs = s_samplerMaxLatencyUs.load(std::memory_order_relaxed);
+  stats.pending = (uint32_t)s_sampleRing.size();
+  stats.polled = s_samplerPolled.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void resetLoadCellSamplerStats() {
+  s_samplerSamples.store(0, std::memory_order_relaxed);
+  s_samplerDropped.store(0, std::memory_order_relaxed);
+  s_samplerMaxLatencyUs.store(0, std::memory_order_relaxed);
+  s_samplerPolled.store(0, std::memory_order_relaxed);
+}
+
 void tareScale(bool simEnabled, HX711_ADC *loadCell, AppState &state) {
   if (simEnabled) {
     state.simThrust = 0.0f;
   } else if (loadCell) {
+    lockLoadCell();
     loadCell->tare();
+    s_tareDoneUs.store(halMicros64(), std::memory_order_release);
+    unlockLoadCell();
   }
 }
 
 void setScaleFactor(HX711_ADC *loadCell, AppState &state, const BoardConfig &cfg, float value) {
   state.scaleFactor = value;
-  if (loadCell) loadCell->setCalFactor(state.scaleFactor);
+  if (loadCell) {
+    lockLoadCell();
+    loadCell->setCalFactor(state.scaleFactor);
+    unlockLoadCell();
+  }
   saveScaleFactor(cfg, state.scaleFactor);
 }
 
@@ -78,10 +238,13 @@ long readRawReading(bool simEnabled, HX711_ADC *loadCell, AppState &state, float
   if (simEnabled) {
     weight = state.simThrust;
     raw = (long)(state.simThrust * state.scaleFactor);
-  } else {
-    if (loadCell) loadCell->update();
-    raw = loadCell ? loadCell->getData() : 0;
-    weight = loadCell ? loadCell->getData() : 0.0f;
+  } else if (loadCell) {
+    // The sampler task owns update(); just read its latest conversion.
+    lockLoadCell();
+    if (!s_samplerTask) loadCell->update();
+    weight = loadCell->getData();
+    unlockLoadCell();
+    raw = (long)weight;
   }
   if (weightOut) *weightOut = weight;
   return raw;
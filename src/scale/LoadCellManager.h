@@ -1,11 +1,38 @@
 #pragma once
 
 #include "AppState.h"
-#include "HX711_ADC.h"
 #include "config/BoardConfig.h"
 
+// Implemented for the HX711 in LoadCellManager.cpp and by the simulator in
+// hal/native/LoadCellNative.cpp for host builds.
+class HX711_ADC;
+
+// Timestamps are taken when the HX711 signals data-ready (DOUT falling), not when the
+// conversion is clocked out or consumed.
+struct ThrustSample {
+  unsigned long timestampMs; // timestampUs / 1000
+  uint64_t timestampUs;
+  float thrust;
+};
+
+// True for a sample whose conversion began before the tare that finished at tareDoneUs
+// (0 = no tare yet). Both are halMicros64() times, so there is no wrap to handle.
+inline bool sampleBeforeTare(uint64_t sampleUs, uint64_t tareDoneUs) { return sampleUs < tareDoneUs; }
+
+struct LoadCellSamplerStats {
+  uint32_t samples;
+  uint32_t dropped;
+  uint32_t maxLatencyUs;
+  uint32_t pending;
+  uint32_t polled; // conversions read after a missed data-ready edge
+};
+
 void initLoadCell(bool simEnabled, HX711_ADC *loadCell, const BoardConfig &cfg, AppState &state);
+bool startLoadCellSampler(HX711_ADC *loadCell, const BoardConfig &cfg);
+bool readThrustSample(bool simEnabled, AppState &state, ThrustSample *out);
 bool readThrust(bool simEnabled, HX711_ADC *loadCell, AppState &state, float *out);
+LoadCellSamplerStats getLoadCellSamplerStats();
+void resetLoadCellSamplerStats();
 void tareScale(bool simEnabled, HX711_ADC *loadCell, AppState &state);
 void setScaleFactor(HX711_ADC *loadCell, AppState &state, const BoardConfig &cfg, float value);
 float getScaleFactor(const AppState &state);
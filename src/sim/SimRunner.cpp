@@ -0,0 +1,93 @@
+#include "SimRunner.h"
+
+#include "hal/Hal.h"
+#include "sim/Simulator.h"
+#include "test/TestRunner.h"
+#include <Arduino.h>
+
+static const uint32_t SIM_RUN_MARGIN_MS = 10000;
+static const uint32_t FNV_OFFSET = 2166136261u;
+static const uint32_t FNV_PRIME = 16777619u;
+
+static uint32_t fnvMix(uint32_t hash, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    hash ^= (value >> (i * 8)) & 0xFF;
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+static uint32_t sequenceDurationMs(const AppState &state, const BoardConfig &cfg) {
+  uint32_t total = cfg.pre_test_tare_spinup_ms + cfg.pre_test_tare_settle_ms;
+  for (const TestStep &step : state.testSequence) total += step.spinup_ms + step.stable_ms;
+  return total;
+}
+
+// Folds the points recorded since the last call into the result. testResults is released
+// when the run finishes, so this runs after every tick.
+static void collectPoints(const AppState &state, size_t &cursor, const SimRunOptions &options, SimRunResult &result) {
+  const size_t total = state.testResults.size();
+  if (cursor >= total) return;
+  SampleStore::Reader reader = state.testResults.reader(cursor);
+  DataPoint point;
+  while (cursor < total && reader.next(point)) {
+    uint32_t thrustBits;
+    memcpy(&thrustBits, &point.thrust, sizeof(thrustBits));
+    result.digest = fnvMix(result.digest, (uint32_t)point.timestamp);
+    result.digest = fnvMix(result.digest, thrustBits);
+    result.digest = fnvMix(result.digest, (uint32_t)point.pwm);
+    if (options.points) options.points->push_back(point);
+    result.samples++;
+    cursor++;
+  }
+}
+
+bool runSimulatedSequence(AppState &state, const BoardConfig &cfg, AsyncWebSocket &ws, const char *sequence,
+                          const SimRunOptions &options, SimRunResult &result) {
+  result = SimRunResult{false, 0, 0, 0, 0, FNV_OFFSET, 0.0f};
+  if (state.currentState != State::IDLE || options.tickUs == 0) return false;
+  if (!parseAndStoreSequence(state, cfg, sequence)) return false;
+
+  if (cfg.sim_seed != 0) randomSeed(cfg.sim_seed);
+  const uint32_t limitMs = options.maxSimMs ? options.maxSimMs : sequenceDurationMs(state, cfg) + SIM_RUN_MARGIN_MS;
+
+  halSetVirtualClock(true);
+  const unsigned long startMs = halMillis();
+  const uint64_t wallStart = halWallMicros();
+  state.lastTelemetryMs = startMs;
+  startPreTestTare(state, cfg);
+
+  size_t cursor = 0;
+  bool started = false;
+  while (halMillis() - startMs < limitMs) {
+    // The part of loop() that matters with the simulator: idle telemetry keeps the
+    // simulated thrust moving outside a run (e.g. during pre-test tare).
+    if (state.currentState != State::RUNNING_SEQUENCE && halMillis() - state.lastTelemetryMs >= cfg.telemetry_interval_ms) {
+      state.lastTelemetryMs = halMillis();
+      updateSimTelemetry(state, cfg);
+    }
+    tickTestRunner(state, cfg, true, nullptr, ws);
+    result.ticks++;
+    if (state.currentState == State::RUNNING_SEQUENCE) started = true;
+    collectPoints(state, cursor, options, result);
+    halAdvanceClock(options.tickUs);
+
+    const bool stopped = state.currentState == State::IDLE || state.currentState == State::SAFETY_SHUTDOWN;
+    // One more tick after the run ends writes the step summaries.
+    if (started && stopped && !state.stepSummariesPending) {
+      result.completed = state.currentState == State::IDLE;
+      break;
+    }
+  }
+
+  result.simulatedMs = (uint32_t)(halMillis() - startMs);
+  result.wallUs = halWallMicros() - wallStart;
+  result.ticksPerSecond = result.wallUs > 0 ? (float)result.ticks * 1e6f / (float)result.wallUs : 0.0f;
+  halSetVirtualClock(false);
+
+  if (!result.completed && state.currentState != State::SAFETY_SHUTDOWN) {
+    setEscThrottlePwm(state, cfg, true, cfg.min_pulse_width);
+    resetTest(state);
+  }
+  return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "AppState.h"
+#include "config/BoardConfig.h"
+#include <ESPAsyncWebServer.h>
+#include <vector>
+
+// Runs a whole test sequence against the simulator on the HAL virtual clock: loop() is
+// replayed tick by tick and time only advances by tickUs per tick, so a 10 minute sequence
+// takes as long as the CPU needs. For a given SIM_SEED and tick period every run records
+// the same points.
+struct SimRunOptions {
+  uint32_t tickUs = 1000;                  // simulated time per loop() pass (loop() delays 1 ms)
+  uint32_t maxSimMs = 0;                   // 0 = sequence length plus tare and a 10 s margin
+  std::vector<DataPoint> *points = nullptr; // optional copy of every recorded point
+};
+
+struct SimRunResult {
+  bool completed;       // sequence ran to the end (no safety shutdown or timeout)
+  uint32_t ticks;
+  uint32_t simulatedMs;
+  uint64_t wallUs;
+  uint32_t samples;     // points recorded in testResults
+  uint32_t digest;      // FNV-1a over the recorded points, for comparing runs
+  float ticksPerSecond; // state-machine throughput in wall time
+};
+
+// The state must be IDLE. Returns false if the sequence does not parse. Leaves the virtual
+// clock off on return.
+bool runSimulatedSequence(AppState &state, const BoardConfig &cfg, AsyncWebSocket &ws, const char *sequence,
+                          const SimRunOptions &options, SimRunResult &result);
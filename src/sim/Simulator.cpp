@@ -1,5 +1,7 @@
 #include "Simulator.h"
 
+#include "hal/Hal.h"
+
 static float clampf(float v, float lo, float hi) {
   if (v < lo) return lo;
   if (v > hi) return hi;
@@ -10,7 +12,7 @@ bool simEnabled(const BoardConfig &cfg) { return cfg.sim_enabled; }
 
 void updateSimTelemetry(AppState &state, const BoardConfig &cfg) {
   if (!simEnabled(cfg)) return;
-  unsigned long now = millis();
+  unsigned long now = halMillis();
   if (state.lastSimUpdateMs == 0) {
     state.lastSimUpdateMs = now;
     return;
@@ -0,0 +1,470 @@
+#include "ResultJournal.h"
+
+#include "hal/Hal.h"
+#include "storage/RunHistory.h"
+#include "util/Log.h"
+#include "util/Perf.h"
+#include "util/SpscRing.h"
+#include <Arduino.h>
+#include <atomic>
+
+static const uint32_t JOURNAL_TASK_STACK = 4096;
+static const unsigned JOURNAL_TASK_PRIORITY = 1;
+static const int JOURNAL_TASK_CORE = 0;
+static const unsigned long JOURNAL_FLUSH_INTERVAL_MS = 1000;
+static const size_t JOURNAL_MIN_FREE_BYTES = 16 * 1024;
+static const uint32_t JOURNAL_FREE_CHECK_BLOCKS = 16;
+
+// Write-behind queue: 8 blocks = 200..336 samples of slack while flash is busy.
+static SpscRing<JournalBlock, 8> s_blockRing;
+static HalTask s_writerTask = nullptr;
+
+// Producer (loop) state.
+static JournalBlock s_fillBlock;
+static uint16_t s_fillCapacity = JOURNAL_SAMPLES_PER_BLOCK;
+static uint32_t s_fillFlags = 0; // layout flags of the run being filled
+static uint32_t s_fillSeq = 0;
+static bool s_producerActive = false;
+static std::atomic<uint32_t> s_appended{0};
+static std::atomic<uint32_t> s_droppedBlocks{0};
+static std::atomic<bool> s_endRequested{false};
+static std::atomic<bool> s_endAborted{false};
+// Written by the producer before it requests the close; read by the writer at close.
+static SampleRateSummary s_pendingRate;
+
+// Hand-off to the writer task.
+static JournalFileHeader s_pendingHeader;
+static uint32_t s_pendingEpoch = 0;
+static uint16_t s_pendingStepCount = 0;
+static std::atomic<bool> s_openPending{false};
+static std::atomic<bool> s_closePending{false};
+static std::atomic<bool> s_closeAborted{false};
+static std::atomic<bool> s_busy{false};
+
+// Writer task state.
+static File s_file;
+static JournalFileHeader s_header;
+static std::atomic<uint32_t> s_runId{0};
+static float s_peakThrust = 0.0f;
+static std::atomic<uint32_t> s_blocksWritten{0};
+static std::atomic<uint32_t> s_flushes{0};
+static std::atomic<bool> s_full{false};
+
+static size_t blockCapacity(uint32_t flags) {
+  if (flags & JOURNAL_FLAG_RPM) return JOURNAL_RPM_SAMPLES_PER_BLOCK;
+  return (flags & JOURNAL_FLAG_ELECTRICAL) ? JOURNAL_POWER_SAMPLES_PER_BLOCK : JOURNAL_SAMPLES_PER_BLOCK;
+}
+
+// Null for the plain JournalSample layout.
+static const JournalPowerSample *blockPowerSample(const JournalBlock &block, uint32_t flags, uint16_t index) {
+  if (flags & JOURNAL_FLAG_RPM) return &block.rpmSamples[index].power;
+  return (flags & JOURNAL_FLAG_ELECTRICAL) ? &block.powerSamples[index] : nullptr;
+}
+
+static const JournalSample &blockSample(const JournalBlock &block, uint32_t flags, uint16_t index) {
+  const JournalPowerSample *power = blockPowerSample(block, flags, index);
+  return power ? power->sample : block.samples[index];
+}
+
+static bool blockIsValid(const JournalBlock &block, uint32_t flags, uint32_t expectedSeq) {
+  return block.magic == JOURNAL_BLOCK_MAGIC && block.seq == expectedSeq && block.count > 0 &&
+         block.count <= blockCapacity(flags);
+}
+
+static uint16_t toCentiU16(float value) {
+  if (!(value > 0.0f)) return 0;
+  if (value >= 655.35f) return 0xFFFF;
+  return (uint16_t)lroundf(value * 100.0f);
+}
+
+// Never writes past headerSize, so recovering a version 1 file leaves its first block alone.
+static void writeHeader(File &file, const JournalFileHeader &header) {
+  file.seek(0);
+  const size_t len = header.headerSize < sizeof(header) ? header.headerSize : sizeof(header);
+  file.write(reinterpret_cast<const uint8_t *>(&header), len);
+}
+
+static bool readHeader(File &file, JournalFileHeader &header) {
+  memset(&header, 0, sizeof(header));
+  uint8_t *raw = reinterpret_cast<uint8_t *>(&header);
+  if (file.read(raw, JOURNAL_V1_HEADER_SIZE) != JOURNAL_V1_HEADER_SIZE) return false;
+  if (header.magic != JOURNAL_FILE_MAGIC || header.version == 0 || header.version > JOURNAL_VERSION ||
+      header.headerSize < JOURNAL_V1_HEADER_SIZE) {
+    return false;
+  }
+  const size_t len = header.headerSize < sizeof(header) ? header.headerSize : sizeof(header);
+  const size_t rest = len - JOURNAL_V1_HEADER_SIZE;
+  return rest == 0 || file.read(raw + JOURNAL_V1_HEADER_SIZE, rest) == rest;
+}
+
+static float blockPeak(const JournalBlock &block, uint32_t flags, float peak) {
+  for (uint16_t i = 0; i < block.count; i++) {
+    const float thrust = blockSample(block, flags, i).thrust;
+    if (thrust > peak) peak = thrust;
+  }
+  return peak;
+}
+
+static void writerOpen() {
+  if (s_file) s_file.close();
+  s_header = s_pendingHeader;
+  s_peakThrust = 0.0f;
+  s_blocksWritten.store(0, std::memory_order_relaxed);
+  s_full.store(false, std::memory_order_relaxed);
+  // Creating the entry may evict the oldest run, so it happens here rather than in loop().
+  const uint32_t runId =
+      createRunHistoryEntry(s_pendingEpoch, s_header.startMs, s_pendingStepCount, s_header.sequence);
+  s_runId.store(runId, std::memory_order_relaxed);
+  char path[RUN_PATH_LEN];
+  if (!runHistoryPath(runId, path, sizeof(path))) return;
+  s_file = halFs().open(path, "w");
+  if (!s_file) {
+    logWarn("Failed to open %s for writing", path);
+    return;
+  }
+  writeHeader(s_file, s_header);
+  s_file.flush();
+}
+
+static void writerAppend(const JournalBlock &block) {
+  if (!s_file || s_full.load(std::memory_order_relaxed)) return;
+  const uint32_t written = s_blocksWritten.load(std::memory_order_relaxed);
+  if (written % JOURNAL_FREE_CHECK_BLOCKS == 0 &&
+      halFsFreeBytes() < JOURNAL_MIN_FREE_BYTES) {
+    logWarn("Result journal stopped: filesystem almost full");
+    s_full.store(true, std::memory_order_relaxed);
+    s_header.flags |= JOURNAL_FLAG_FULL;
+    return;
+  }
+  const uint32_t writeStart = perfNow();
+  const size_t blockWritten = s_file.write(reinterpret_cast<const uint8_t *>(&block), sizeof(block));
+  perfEnd(PerfStage::FS_WRITE, writeStart);
+  if (blockWritten != sizeof(block)) {
+    logWarn("Result journal write failed");
+    s_full.store(true, std::memory_order_relaxed);
+    s_header.flags |= JOURNAL_FLAG_FULL;
+    return;
+  }
+  s_header.blockCount++;
+  s_header.sampleCount += block.count;
+  s_peakThrust = blockPeak(block, s_header.flags, s_peakThrust);
+  s_blocksWritten.store(written + 1, std::memory_order_relaxed);
+}
+
+static void writerClose(bool aborted) {
+  s_header.rate = s_pendingRate;
+  s_header.flags |= JOURNAL_FLAG_CLOSED;
+  if (aborted) s_header.flags |= JOURNAL_FLAG_ABORTED;
+  const uint32_t runId = s_runId.load(std::memory_order_relaxed);
+  if (runId != 0) finishRunHistoryEntry(runId, s_header.sampleCount, s_peakThrust, s_header.flags);
+  if (!s_file) return;
+  writeHeader(s_file, s_header);
+  s_file.close();
+  logInfo("Run %u closed: %u samples in %u blocks%s",
+          (unsigned)runId,
+          (unsigned)s_header.sampleCount,
+          (unsigned)s_header.blockCount,
+          aborted ? " (aborted)" : "");
+}
+
+static void resultJournalTask(void *arg) {
+  (void)arg;
+  unsigned long lastFlushMs = halMillis();
+  JournalBlock block;
+  for (;;) {
+    halWaitNotify(JOURNAL_FLUSH_INTERVAL_MS);
+    if (s_openPending.load(std::memory_order_acquire)) {
+      writerOpen();
+      s_openPending.store(false, std::memory_order_release);
+      lastFlushMs = halMillis();
+    }
+    // Sample the close request before draining so its final block is never left behind.
+    const bool closing = s_closePending.load(std::memory_order_acquire);
+    while (s_blockRing.pop(block)) {
+      writerAppend(block);
+    }
+    if (closing) {
+      writerClose(s_closeAborted.load(std::memory_order_relaxed));
+      // The producer stopped before requesting the close, so the ring is empty for the next
+      // run; clearing it is the consumer's job (SpscRing), never beginResultJournal()'s.
+      s_blockRing.clear();
+      s_closePending.store(false, std::memory_order_release);
+      s_busy.store(false, std::memory_order_release);
+      continue;
+    }
+    if (s_file && halMillis() - lastFlushMs >= JOURNAL_FLUSH_INTERVAL_MS) {
+      // Blocks are self-validating, so a flush only needs to commit data; the header
+      // counts are rebuilt by recoverResultJournal() if the run never closes.
+      const uint32_t flushStart = perfNow();
+      s_file.flush();
+      perfEnd(PerfStage::FS_WRITE, flushStart);
+      s_flushes.fetch_add(1, std::memory_order_relaxed);
+      lastFlushMs = halMillis();
+    }
+  }
+}
+
+bool initResultJournal() {
+  if (s_writerTask) return true;
+  s_writerTask = halStartTask(resultJournalTask, "journal", JOURNAL_TASK_STACK, JOURNAL_TASK_PRIORITY,
+                              JOURNAL_TASK_CORE, nullptr);
+  if (!s_writerTask) {
+    logError("Failed to start result journal task");
+    return false;
+  }
+  return true;
+}
+
+// Rescans one unclosed journal file and rewrites its header with the real counts.
+static void recoverJournalFile(const RunManifestEntry &entry) {
+  char path[RUN_PATH_LEN];
+  uint32_t blocks = 0;
+  uint32_t samples = 0;
+  float peak = 0.0f;
+  uint32_t flags = JOURNAL_FLAG_CLOSED | JOURNAL_FLAG_ABORTED | JOURNAL_FLAG_RECOVERED;
+  File file;
+  if (runHistoryPath(entry.runId, path, sizeof(path))) file = halFs().open(path, "r+");
+  JournalFileHeader header;
+  if (file && readHeader(file, header)) {
+    file.seek(header.headerSize);
+    JournalBlock block;
+    while (file.read(reinterpret_cast<uint8_t *>(&block), sizeof(block)) == sizeof(block) &&
+           blockIsValid(block, header.flags, blocks)) {
+      blocks++;
+      samples += block.count;
+      peak = blockPeak(block, header.flags, peak);
+    }
+    // A clean close that only missed the manifest update keeps its own flags.
+    flags = (header.flags & JOURNAL_FLAG_CLOSED) ? header.flags : (header.flags | flags);
+    header.blockCount = blocks;
+    header.sampleCount = samples;
+    header.flags = flags;
+    writeHeader(file, header);
+  }
+  if (file) file.close();
+  finishRunHistoryEntry(entry.runId, samples, peak, flags);
+  logWarn("Recovered interrupted run %u: %u samples", (unsigned)entry.runId, (unsigned)samples);
+}
+
+void recoverResultJournal() {
+  RunManifestEntry entries[RUN_HISTORY_SLOTS];
+  const size_t count = listRunHistory(entries, RUN_HISTORY_SLOTS);
+  for (size_t i = 0; i < count; i++) {
+    if (!(entries[i].flags & JOURNAL_FLAG_CLOSED)) recoverJournalFile(entries[i]);
+  }
+}
+
+bool beginResultJournal(uint32_t startEpoch, unsigned long startMs, uint16_t stepCount, const char *sequence,
+                        uint8_t channels) {
+  if (!s_writerTask) return false;
+  if (s_busy.load(std::memory_order_acquire)) {
+    logWarn("Previous result journal still closing; this run is not journaled");
+    return false;
+  }
+  memset(&s_pendingHeader, 0, sizeof(s_pendingHeader));
+  s_pendingHeader.magic = JOURNAL_FILE_MAGIC;
+  s_pendingHeader.version = JOURNAL_VERSION;
+  s_pendingHeader.headerSize = sizeof(JournalFileHeader);
+  s_pendingHeader.startMs = (uint32_t)startMs;
+  s_pendingHeader.flags = ((channels & SAMPLE_CHANNEL_ELECTRICAL) ? JOURNAL_FLAG_ELECTRICAL : 0) |
+                          ((channels & SAMPLE_CHANNEL_RPM) ? JOURNAL_FLAG_RPM : 0);
+  s_pendingEpoch = startEpoch;
+  s_runId.store(0, std::memory_order_relaxed);
+  s_pendingStepCount = stepCount;
+  s_pendingRate = SampleRateSummary();
+  if (sequence) {
+    strncpy(s_pendingHeader.sequence, sequence, sizeof(s_pendingHeader.sequence) - 1);
+  }
+
+  s_fillSeq = 0;
+  s_fillBlock.count = 0;
+  s_fillFlags = s_pendingHeader.flags;
+  s_fillCapacity = (uint16_t)blockCapacity(s_pendingHeader.flags);
+  s_appended.store(0, std::memory_order_relaxed);
+  s_droppedBlocks.store(0, std::memory_order_relaxed);
+  s_endRequested.store(false, std::memory_order_relaxed);
+  s_busy.store(true, std::memory_order_release);
+  s_openPending.store(true, std::memory_order_release);
+  s_producerActive = true;
+  halNotifyTask(s_writerTask);
+  return true;
+}
+
+static void pushFillBlock() {
+  if (s_fillBlock.count == 0) return;
+  s_fillBlock.magic = JOURNAL_BLOCK_MAGIC;
+  s_fillBlock.seq = s_fillSeq;
+  if (s_blockRing.push(s_fillBlock)) {
+    s_fillSeq++;
+  } else {
+    // Keeping seq unchanged makes the next block overwrite this slot in the sequence,
+    // so readers never see a gap; the lost samples are only counted.
+    s_droppedBlocks.fetch_add(1, std::memory_order_relaxed);
+  }
+  s_fillBlock.count = 0;
+  halNotifyTask(s_writerTask);
+}
+
+void appendResultJournal(const DataPoint &point) {
+  if (!s_producerActive || s_endRequested.load(std::memory_order_acquire)) return;
+  const uint16_t index = s_fillBlock.count++;
+  JournalSample *sample = &s_fillBlock.samples[index];
+  JournalPowerSample *power = nullptr;
+  if (s_fillFlags & JOURNAL_FLAG_RPM) {
+    s_fillBlock.rpmSamples[index].rpm = point.rpm;
+    power = &s_fillBlock.rpmSamples[index].power;
+  } else if (s_fillFlags & JOURNAL_FLAG_ELECTRICAL) {
+    power = &s_fillBlock.powerSamples[index];
+  }
+  if (power) {
+    const bool electrical = s_fillFlags & JOURNAL_FLAG_ELECTRICAL;
+    power->voltageCenti = electrical ? toCentiU16(point.voltage) : 0;
+    power->currentCenti = electrical ? toCentiU16(point.current) : 0;
+    sample = &power->sample;
+  }
+  sample->timestamp = (uint32_t)point.timestamp;
+  sample->thrust = point.thrust;
+  sample->pwm = (int16_t)point.pwm;
+  sample->subMsUs = point.subMsUs;
+  s_appended.fetch_add(1, std::memory_order_relaxed);
+  if (s_fillBlock.count >= s_fillCapacity) pushFillBlock();
+}
+
+void setResultJournalSampleRate(const SampleRateSummary &rate) {
+  if (s_producerActive) s_pendingRate = rate;
+}
+
+void endResultJournal(bool aborted) {
+  s_endAborted.store(aborted, std::memory_order_relaxed);
+  s_endRequested.store(true, std::memory_order_release);
+}
+
+void tickResultJournal() {
+  if (!s_producerActive || !s_endRequested.load(std::memory_order_acquire)) return;
+  pushFillBlock();
+  s_producerActive = false;
+  s_closeAborted.store(s_endAborted.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  s_closePending.store(true, std::memory_order_release);
+  halNotifyTask(s_writerTask);
+}
+
+bool resultJournalBusy() { return s_busy.load(std::memory_order_acquire); }
+
+uint32_t resultJournalSampleCount() { return s_appended.load(std::memory_order_relaxed); }
+
+ResultJournalStats getResultJournalStats() {
+  ResultJournalStats stats;
+  stats.runId = s_runId.load(std::memory_order_relaxed);
+  stats.samples = s_appended.load(std::memory_order_relaxed);
+  stats.blocksWritten = s_blocksWritten.load(std::memory_order_relaxed);
+  stats.droppedBlocks = s_droppedBlocks.load(std::memory_order_relaxed);
+  stats.flushes = s_flushes.load(std::memory_order_relaxed);
+  stats.full = s_full.load(std::memory_order_relaxed);
+  stats.busy = s_busy.load(std::memory_order_relaxed);
+  return stats;
+}
+
+bool openResultJournalReader(ResultJournalReader &reader, uint32_t runId) {
+  char path[RUN_PATH_LEN];
+  if (!runHistoryPath(runId, path, sizeof(path))) return false;
+  reader.file = halFs().open(path, "r");
+  if (!reader.file) return false;
+  if (!readHeader(reader.file, reader.header)) {
+    reader.file.close();
+    return false;
+  }
+  reader.file.seek(reader.header.headerSize);
+  reader.nextSeq = 0;
+  reader.pos = 0;
+  reader.block.count = 0;
+  return true;
+}
+
+bool nextResultJournalSample(ResultJournalReader &reader, DataPoint &out) {
+  if (!reader.file) return false;
+  if (reader.pos >= reader.block.count) {
+    if (reader.file.read(reinterpret_cast<uint8_t *>(&reader.block), sizeof(reader.block)) !=
+            sizeof(reader.block) ||
+        !blockIsValid(reader.block, reader.header.flags, reader.nextSeq)) {
+      reader.file.close();
+      return false;
+    }
+    reader.nextSeq++;
+    reader.pos = 0;
+  }
+  const uint16_t index = reader.pos++;
+  const JournalSample &sample = blockSample(reader.block, reader.header.flags, index);
+  out.timestamp = sample.timestamp;
+  out.thrust = sample.thrust;
+  out.pwm = sample.pwm;
+  out.subMsUs = sample.subMsUs;
+  const JournalPowerSample *power = blockPowerSample(reader.block, reader.header.flags, index);
+  out.voltage = power ? (float)power->voltageCenti / 100.0f : 0.0f;
+  out.current = power ? (float)power->currentCenti / 100.0f : 0.0f;
+  out.rpm = (reader.header.flags & JOURNAL_FLAG_RPM) ? reader.block.rpmSamples[index].rpm : 0;
+  return true;
+}
+
+static uint32_t readerBlockCount(ResultJournalReader &reader) {
+  if (reader.header.flags & JOURNAL_FLAG_CLOSED) return reader.header.blockCount;
+  const size_t size = reader.file.size();
+  return size > reader.header.headerSize ? (uint32_t)((size - reader.header.headerSize) / sizeof(JournalBlock)) : 0;
+}
+
+static uint32_t blockOffset(const ResultJournalReader &reader, uint32_t index) {
+  return reader.header.headerSize + index * (uint32_t)sizeof(JournalBlock);
+}
+
+// Reads just the block header and its first sample (20 bytes) instead of the whole block.
+static bool readBlockStart(ResultJournalReader &reader, uint32_t index, uint32_t &timestamp) {
+  uint8_t head[8 + sizeof(JournalSample)];
+  if (!reader.file.seek(blockOffset(reader, index)) || reader.file.read(head, sizeof(head)) != sizeof(head)) {
+    return false;
+  }
+  uint16_t magic;
+  memcpy(&magic, head, sizeof(magic));
+  if (magic != JOURNAL_BLOCK_MAGIC) return false;
+  memcpy(&timestamp, head + 8, sizeof(timestamp));
+  return true;
+}
+
+bool seekResultJournalReader(ResultJournalReader &reader, uint32_t fromMs) {
+  if (!reader.file) return false;
+  const uint32_t blocks = readerBlockCount(reader);
+  uint32_t target = 0;
+  if (blocks > 0) {
+    // Last block whose first sample is at or before fromMs.
+    uint32_t lo = 0;
+    uint32_t hi = blocks - 1;
+    while (lo < hi) {
+      const uint32_t mid = lo + (hi - lo + 1) / 2;
+      uint32_t timestamp;
+      if (!readBlockStart(reader, mid, timestamp)) {
+        hi = mid - 1;
+        continue;
+      }
+      if (timestamp <= fromMs) lo = mid;
+      else hi = mid - 1;
+    }
+    target = lo;
+  }
+  reader.file.seek(blockOffset(reader, target));
+  reader.nextSeq = target;
+  reader.pos = 0;
+  reader.block.count = 0;
+  return true;
+}
+
+bool resultJournalLastTimestamp(ResultJournalReader &reader, uint32_t &out) {
+  if (!reader.file) return false;
+  const uint32_t blocks = readerBlockCount(reader);
+  if (blocks == 0) return false;
+  const size_t resume = reader.file.position();
+  JournalBlock block;
+  bool ok = reader.file.seek(blockOffset(reader, blocks - 1)) &&
+            reader.file.read(reinterpret_cast<uint8_t *>(&block), sizeof(block)) == sizeof(block) &&
+            blockIsValid(block, reader.header.flags, blocks - 1);
+  if (ok) out = blockSample(block, reader.header.flags, block.count - 1).timestamp;
+  reader.file.seek(resume);
+  return ok;
+}
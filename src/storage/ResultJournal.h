@@ -0,0 +1,124 @@
+#pragma once
+
+#include "FS.h"
+#include "test/SampleRateStats.h"
+#include "test/SampleStore.h"
+#include <stdint.h>
+
+// Append-only on-flash journal of a run; one file per run, see RunHistory.h.
+//
+// File layout: one JournalFileHeader followed by fixed-size JournalBlocks. Blocks are
+// filled by loop() and written by a background task, so flash latency never stalls
+// sampling. A block is valid if its magic matches and its seq follows the previous one,
+// so a run cut short by a brownout is readable up to the last flushed block.
+static const uint32_t JOURNAL_FILE_MAGIC = 0x314A5453; // "STJ1"
+// Version 2 appended the sample-rate section; version 1 files (128-byte header) still read,
+// with the rate zeroed. Version 3 added JOURNAL_FLAG_ELECTRICAL runs, whose blocks hold
+// JournalPowerSamples; without the flag the layout is unchanged. Version 4 added
+// JOURNAL_FLAG_RPM runs, whose blocks hold JournalRpmSamples (voltage/current stay 0 unless
+// JOURNAL_FLAG_ELECTRICAL is also set).
+static const uint16_t JOURNAL_VERSION = 4;
+static const uint16_t JOURNAL_V1_HEADER_SIZE = 128;
+static const uint16_t JOURNAL_BLOCK_MAGIC = 0x424A;    // "JB"
+static const size_t JOURNAL_SAMPLES_PER_BLOCK = 42;
+static const size_t JOURNAL_POWER_SAMPLES_PER_BLOCK = 31;
+static const size_t JOURNAL_RPM_SAMPLES_PER_BLOCK = 25;
+static const size_t JOURNAL_SEQUENCE_LEN = 104;
+
+static const uint32_t JOURNAL_FLAG_CLOSED = 0x0001;
+static const uint32_t JOURNAL_FLAG_ABORTED = 0x0002;
+static const uint32_t JOURNAL_FLAG_RECOVERED = 0x0004;
+static const uint32_t JOURNAL_FLAG_FULL = 0x0008;
+static const uint32_t JOURNAL_FLAG_ELECTRICAL = 0x0010; // samples carry ESC voltage/current
+static const uint32_t JOURNAL_FLAG_RPM = 0x0020;        // samples carry motor RPM
+
+struct JournalFileHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t headerSize;
+  uint32_t flags;
+  uint32_t startMs;
+  uint32_t sampleCount; // authoritative once JOURNAL_FLAG_CLOSED is set
+  uint32_t blockCount;
+  char sequence[JOURNAL_SEQUENCE_LEN];
+  SampleRateSummary rate; // whole run, written at close
+};
+static_assert(sizeof(JournalFileHeader) == 160, "journal header layout changed");
+
+struct JournalSample {
+  uint32_t timestamp;
+  float thrust;
+  int16_t pwm;
+  uint16_t subMsUs; // always 0 in files written before sub-ms timestamps
+};
+static_assert(sizeof(JournalSample) == 12, "journal sample layout changed");
+
+struct JournalPowerSample {
+  JournalSample sample;
+  uint16_t voltageCenti; // 0.01 V
+  uint16_t currentCenti; // 0.01 A
+};
+static_assert(sizeof(JournalPowerSample) == 16, "journal power sample layout changed");
+
+struct JournalRpmSample {
+  JournalPowerSample power;
+  uint32_t rpm;
+};
+static_assert(sizeof(JournalRpmSample) == 20, "journal RPM sample layout changed");
+
+// Samples always start at offset 8 with the timestamp first, whichever layout the run uses.
+struct JournalBlock {
+  uint16_t magic;
+  uint16_t count;
+  uint32_t seq;
+  union {
+    JournalSample samples[JOURNAL_SAMPLES_PER_BLOCK];
+    JournalPowerSample powerSamples[JOURNAL_POWER_SAMPLES_PER_BLOCK];
+    JournalRpmSample rpmSamples[JOURNAL_RPM_SAMPLES_PER_BLOCK];
+  };
+};
+static_assert(sizeof(JournalBlock) == 512, "journal block layout changed");
+
+struct ResultJournalStats {
+  uint32_t runId;
+  uint32_t samples;
+  uint32_t blocksWritten;
+  uint32_t droppedBlocks;
+  uint32_t flushes;
+  bool full;
+  bool busy;
+};
+
+struct ResultJournalReader {
+  File file;
+  JournalFileHeader header;
+  JournalBlock block;
+  uint32_t nextSeq;
+  uint16_t pos;
+};
+
+bool initResultJournal();
+// Closes out runs left open by a reset; call after initRunHistory().
+void recoverResultJournal();
+
+// Writer side: begin/append/tick from loop() only; end may be requested from any task.
+// channels (SAMPLE_CHANNEL_* mask) selects the sample layout for the whole run.
+bool beginResultJournal(uint32_t startEpoch, unsigned long startMs, uint16_t stepCount, const char *sequence,
+                        uint8_t channels);
+void appendResultJournal(const DataPoint &point);
+// Recorded in the header when the run closes; call before endResultJournal().
+void setResultJournalSampleRate(const SampleRateSummary &rate);
+void endResultJournal(bool aborted);
+void tickResultJournal();
+bool resultJournalBusy();
+uint32_t resultJournalSampleCount();
+ResultJournalStats getResultJournalStats();
+
+// runId 0 opens the newest run. header.flags lacks JOURNAL_FLAG_CLOSED while it is recording.
+bool openResultJournalReader(ResultJournalReader &reader, uint32_t runId);
+bool nextResultJournalSample(ResultJournalReader &reader, DataPoint &out);
+// Positions the reader on the block holding the first sample at or after fromMs. Blocks are
+// fixed-size and time-ordered, so the block array itself is the coarse time index.
+bool seekResultJournalReader(ResultJournalReader &reader, uint32_t fromMs);
+// Timestamp of the last readable sample; leaves the reader position unchanged.
+bool resultJournalLastTimestamp(ResultJournalReader &reader, uint32_t &out);
@@ -0,0 +1,89 @@
+#include "ResultQuery.h"
+
+void MinMaxDownsampler::begin(uint32_t fromMs, uint32_t toMs, uint32_t maxPoints) {
+  fromMs_ = fromMs;
+  const uint32_t buckets = maxPoints >= 2 ? maxPoints / 2 : 1;
+  const uint64_t span = (uint64_t)(toMs - fromMs) + 1;
+  bucketMs_ = (uint32_t)((span + buckets - 1) / buckets);
+  if (bucketMs_ == 0) bucketMs_ = 1;
+  bucket_ = 0;
+  open_ = false;
+}
+
+size_t MinMaxDownsampler::emit(DataPoint out[2]) {
+  if (!open_) return 0;
+  open_ = false;
+  if (min_.timestamp == max_.timestamp) {
+    out[0] = min_;
+    return 1;
+  }
+  const bool minFirst = min_.timestamp < max_.timestamp;
+  out[0] = minFirst ? min_ : max_;
+  out[1] = minFirst ? max_ : min_;
+  return 2;
+}
+
+size_t MinMaxDownsampler::push(const DataPoint &point, DataPoint out[2]) {
+  const uint32_t bucket = ((uint32_t)point.timestamp - fromMs_) / bucketMs_;
+  size_t emitted = 0;
+  if (open_ && bucket != bucket_) emitted = emit(out);
+  if (!open_) {
+    open_ = true;
+    bucket_ = bucket;
+    min_ = point;
+    max_ = point;
+    return emitted;
+  }
+  // Strict comparisons keep the earliest sample of a flat stretch.
+  if (point.thrust < min_.thrust) min_ = point;
+  if (point.thrust > max_.thrust) max_ = point;
+  return emitted;
+}
+
+size_t MinMaxDownsampler::finish(DataPoint out[2]) { return emit(out); }
+
+bool openResultQuery(ResultQueryStream &stream, const ResultQuery &query, uint32_t runId) {
+  if (!openResultJournalReader(stream.reader, runId)) return false;
+  stream.query = query;
+  uint32_t lastMs;
+  if (resultJournalLastTimestamp(stream.reader, lastMs) && stream.query.toMs > lastMs) {
+    stream.query.toMs = lastMs;
+  }
+  if (stream.query.fromMs > stream.query.toMs) {
+    stream.exhausted = true;
+  } else {
+    seekResultJournalReader(stream.reader, stream.query.fromMs);
+  }
+  if (stream.query.maxPoints > 0) {
+    stream.downsampler.begin(stream.query.fromMs, stream.query.toMs, stream.query.maxPoints);
+  }
+  stream.pendingCount = 0;
+  stream.pendingPos = 0;
+  return true;
+}
+
+bool nextResultQueryPoint(ResultQueryStream &stream, DataPoint &out) {
+  for (;;) {
+    if (stream.pendingPos < stream.pendingCount) {
+      out = stream.pending[stream.pendingPos++];
+      return true;
+    }
+    stream.pendingPos = 0;
+    stream.pendingCount = 0;
+    if (stream.exhausted) return false;
+
+    DataPoint point;
+    const bool more = nextResultJournalSample(stream.reader, point) && point.timestamp <= stream.query.toMs;
+    if (!more) {
+      stream.exhausted = true;
+      if (stream.query.maxPoints > 0) stream.pendingCount = (uint8_t)stream.downsampler.finish(stream.pending);
+      continue;
+    }
+    if (point.timestamp < stream.query.fromMs) continue;
+    if (stream.query.maxPoints == 0) {
+      out = point;
+      return true;
+    }
+    stream.pendingCount = (uint8_t)stream.downsampler.push(point, stream.pending);
+  }
+}
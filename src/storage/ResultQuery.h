@@ -0,0 +1,49 @@
+#pragma once
+
+#include "storage/ResultJournal.h"
+#include "test/SampleStore.h"
+#include <stdint.h>
+
+// Time window and point budget for a results download. toMs is inclusive.
+struct ResultQuery {
+  uint32_t fromMs = 0;
+  uint32_t toMs = UINT32_MAX;
+  uint32_t maxPoints = 0; // 0 = every sample in the window
+};
+
+// Min/max-preserving reducer: the window is split into maxPoints / 2 equal time buckets
+// and each bucket emits its lowest and highest thrust sample in time order, so spikes and
+// dropouts survive any amount of decimation.
+class MinMaxDownsampler {
+ public:
+  void begin(uint32_t fromMs, uint32_t toMs, uint32_t maxPoints);
+  // Feeds one in-window point; returns how many points (0..2) were completed into out.
+  size_t push(const DataPoint &point, DataPoint out[2]);
+  // Emits the last open bucket.
+  size_t finish(DataPoint out[2]);
+
+ private:
+  size_t emit(DataPoint out[2]);
+
+  uint32_t fromMs_ = 0;
+  uint32_t bucketMs_ = 1;
+  uint32_t bucket_ = 0;
+  bool open_ = false;
+  DataPoint min_ = {};
+  DataPoint max_ = {};
+};
+
+struct ResultQueryStream {
+  ResultJournalReader reader;
+  ResultQuery query;
+  MinMaxDownsampler downsampler;
+  DataPoint pending[2];
+  uint8_t pendingCount = 0;
+  uint8_t pendingPos = 0;
+  bool exhausted = false;
+};
+
+// Opens a run's journal (0 = newest) and seeks to query.fromMs. An open-ended window is
+// clamped to the last recorded sample so the bucket width matches the data on flash.
+bool openResultQuery(ResultQueryStream &stream, const ResultQuery &query, uint32_t runId);
+bool nextResultQueryPoint(ResultQueryStream &stream, DataPoint &out);
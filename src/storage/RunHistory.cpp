@@ -0,0 +1,241 @@
+#include "RunHistory.h"
+
+#include "hal/Hal.h"
+#include "util/Log.h"
+#include <Arduino.h>
+
+static const char RUN_HISTORY_DIR[] = "/runs";
+static const char RUN_MANIFEST_PATH[] = "/runs/manifest.bin";
+static const char RUN_MANIFEST_TMP_PATH[] = "/runs/manifest.tmp";
+static const uint32_t RUN_MANIFEST_MAGIC = 0x314D5453; // "STM1"
+static const uint16_t RUN_MANIFEST_VERSION = 1;
+// Files written by firmware versions that kept a single result file.
+static const char *const LEGACY_RESULT_PATHS[] = {"/last_test.csv", "/journal.bin"};
+
+struct RunManifestHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t entrySize;
+  uint32_t nextRunId;
+  uint32_t reserved;
+};
+
+static RunManifestHeader s_header;
+static RunManifestEntry s_entries[RUN_HISTORY_SLOTS];
+// Downloads holding a run open, per slot. pinnedRunId may be a run already evicted from the
+// slot, whose files are removed when its last pin goes.
+struct RunSlotPins {
+  uint32_t pinnedRunId;
+  uint16_t count;
+  bool evicted;
+};
+static RunSlotPins s_pins[RUN_HISTORY_SLOTS];
+// The journal task, HTTP handlers and setup() all touch the manifest.
+static HalMutex s_historyMutex = nullptr;
+
+static void lockHistory() { halLock(s_historyMutex); }
+
+static void unlockHistory() { halUnlock(s_historyMutex); }
+
+static void formatRunPath(uint32_t runId, char *out, size_t outLen) {
+  snprintf(out, outLen, "%s/%lu.bin", RUN_HISTORY_DIR, (unsigned long)runId);
+}
+
+static void formatStepsPath(uint32_t runId, char *out, size_t outLen) {
+  snprintf(out, outLen, "%s/%lu_steps.csv", RUN_HISTORY_DIR, (unsigned long)runId);
+}
+
+static void removeRunFiles(uint32_t runId) {
+  char path[RUN_PATH_LEN];
+  formatRunPath(runId, path, sizeof(path));
+  halFs().remove(path);
+  formatStepsPath(runId, path, sizeof(path));
+  if (halFs().exists(path)) halFs().remove(path);
+}
+
+static bool runPinned(uint32_t runId) {
+  const RunSlotPins &pins = s_pins[runId % RUN_HISTORY_SLOTS];
+  return pins.count > 0 && pins.pinnedRunId == runId;
+}
+
+static RunManifestEntry *findEntry(uint32_t runId) {
+  if (runId == 0) return nullptr;
+  RunManifestEntry &entry = s_entries[runId % RUN_HISTORY_SLOTS];
+  return entry.runId == runId ? &entry : nullptr;
+}
+
+static void resetManifest() {
+  memset(&s_header, 0, sizeof(s_header));
+  s_header.magic = RUN_MANIFEST_MAGIC;
+  s_header.version = RUN_MANIFEST_VERSION;
+  s_header.entrySize = sizeof(RunManifestEntry);
+  s_header.nextRunId = 1;
+  memset(s_entries, 0, sizeof(s_entries));
+}
+
+static void saveManifest() {
+  File file = halFs().open(RUN_MANIFEST_TMP_PATH, "w");
+  if (!file) {
+    logWarn("Failed to write %s", RUN_MANIFEST_TMP_PATH);
+    return;
+  }
+  const size_t expected = sizeof(s_header) + sizeof(s_entries);
+  size_t written = file.write(reinterpret_cast<const uint8_t *>(&s_header), sizeof(s_header));
+  written += file.write(reinterpret_cast<const uint8_t *>(s_entries), sizeof(s_entries));
+  file.close();
+  if (written != expected) {
+    logWarn("Short write to %s", RUN_MANIFEST_TMP_PATH);
+    halFs().remove(RUN_MANIFEST_TMP_PATH);
+    return;
+  }
+  halFs().remove(RUN_MANIFEST_PATH);
+  halFs().rename(RUN_MANIFEST_TMP_PATH, RUN_MANIFEST_PATH);
+}
+
+static bool loadManifest() {
+  // A crash between remove and rename leaves only the tmp file, which is complete.
+  const char *path = halFs().exists(RUN_MANIFEST_PATH) ? RUN_MANIFEST_PATH : RUN_MANIFEST_TMP_PATH;
+  File file = halFs().open(path, "r");
+  if (!file) return false;
+  RunManifestHeader header;
+  bool ok = file.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) == sizeof(header) &&
+            header.magic == RUN_MANIFEST_MAGIC && header.version == RUN_MANIFEST_VERSION &&
+            header.entrySize == sizeof(RunManifestEntry) &&
+            file.read(reinterpret_cast<uint8_t *>(s_entries), sizeof(s_entries)) == sizeof(s_entries);
+  file.close();
+  if (!ok) return false;
+  s_header = header;
+  return true;
+}
+
+void initRunHistory() {
+  if (!s_historyMutex) s_historyMutex = halCreateMutex();
+  if (!halFs().exists(RUN_HISTORY_DIR)) halFs().mkdir(RUN_HISTORY_DIR);
+  for (const char *legacy : LEGACY_RESULT_PATHS) {
+    if (halFs().exists(legacy)) halFs().remove(legacy);
+  }
+  lockHistory();
+  if (!loadManifest()) {
+    resetManifest();
+    saveManifest();
+  }
+  unlockHistory();
+}
+
+uint32_t createRunHistoryEntry(uint32_t startEpoch, uint32_t startMs, uint16_t stepCount, const char *sequence) {
+  lockHistory();
+  const uint32_t runId = s_header.nextRunId++;
+  if (s_header.nextRunId == 0) s_header.nextRunId = 1;
+  RunManifestEntry &entry = s_entries[runId % RUN_HISTORY_SLOTS];
+  if (entry.runId != 0) {
+    if (runPinned(entry.runId)) {
+      s_pins[runId % RUN_HISTORY_SLOTS].evicted = true;
+    } else {
+      removeRunFiles(entry.runId);
+    }
+  }
+  memset(&entry, 0, sizeof(entry));
+  entry.runId = runId;
+  entry.startEpoch = startEpoch;
+  entry.startMs = startMs;
+  entry.stepCount = stepCount;
+  if (sequence) strncpy(entry.sequence, sequence, sizeof(entry.sequence) - 1);
+  saveManifest();
+  unlockHistory();
+  return runId;
+}
+
+void finishRunHistoryEntry(uint32_t runId, uint32_t sampleCount, float peakThrust, uint32_t flags) {
+  lockHistory();
+  RunManifestEntry *entry = findEntry(runId);
+  if (entry) {
+    entry->sampleCount = sampleCount;
+    entry->peakThrust = peakThrust;
+    entry->flags = (uint16_t)flags;
+    saveManifest();
+  }
+  unlockHistory();
+}
+
+uint32_t latestRunId() {
+  lockHistory();
+  uint32_t latest = 0;
+  for (const RunManifestEntry &entry : s_entries) {
+    if (entry.runId > latest) latest = entry.runId;
+  }
+  unlockHistory();
+  return latest;
+}
+
+bool runHistoryPath(uint32_t runId, char *out, size_t outLen) {
+  if (runId == 0) runId = latestRunId();
+  lockHistory();
+  const bool found = findEntry(runId) != nullptr;
+  unlockHistory();
+  if (found) formatRunPath(runId, out, outLen);
+  return found;
+}
+
+bool runHistoryStepsPath(uint32_t runId, char *out, size_t outLen) {
+  if (runId == 0) runId = latestRunId();
+  lockHistory();
+  const bool found = findEntry(runId) != nullptr;
+  unlockHistory();
+  if (found) formatStepsPath(runId, out, outLen);
+  return found;
+}
+
+size_t listRunHistory(RunManifestEntry *out, size_t maxEntries) {
+  lockHistory();
+  size_t count = 0;
+  // Walking ids downward from the newest visits slots newest first.
+  const uint32_t newest = s_header.nextRunId - 1;
+  for (size_t i = 0; i < RUN_HISTORY_SLOTS && count < maxEntries && newest >= i + 1; i++) {
+    const RunManifestEntry *entry = findEntry(newest - (uint32_t)i);
+    if (entry) out[count++] = *entry;
+  }
+  unlockHistory();
+  return count;
+}
+
+RunDeleteResult deleteRunHistoryEntry(uint32_t runId) {
+  lockHistory();
+  RunManifestEntry *entry = findEntry(runId);
+  RunDeleteResult result = RunDeleteResult::NOT_FOUND;
+  if (entry && (entry->flags & JOURNAL_FLAG_CLOSED)) {
+    if (runPinned(runId)) {
+      result = RunDeleteResult::IN_USE;
+    } else {
+      removeRunFiles(runId);
+      memset(entry, 0, sizeof(*entry));
+      saveManifest();
+      result = RunDeleteResult::DELETED;
+    }
+  }
+  unlockHistory();
+  return result;
+}
+
+uint32_t pinRunHistoryEntry(uint32_t runId) {
+  if (runId == 0) runId = latestRunId();
+  lockHistory();
+  RunSlotPins &pins = s_pins[runId % RUN_HISTORY_SLOTS];
+  const bool slotFree = pins.count == 0 || pins.pinnedRunId == runId;
+  const bool pinned = slotFree && findEntry(runId) != nullptr;
+  if (pinned) {
+    if (pins.count == 0) pins = {runId, 0, false};
+    pins.count++;
+  }
+  unlockHistory();
+  return pinned ? runId : 0;
+}
+
+void unpinRunHistoryEntry(uint32_t runId) {
+  lockHistory();
+  RunSlotPins &pins = s_pins[runId % RUN_HISTORY_SLOTS];
+  if (pins.count > 0 && pins.pinnedRunId == runId && --pins.count == 0 && pins.evicted) {
+    removeRunFiles(runId);
+    pins.evicted = false;
+  }
+  unlockHistory();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "storage/ResultJournal.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded history of recorded runs.
+//
+// Each run's journal lives at /runs/<id>.bin, its step summary at /runs/<id>_steps.csv.
+// /runs/manifest.bin holds one fixed-size entry per slot (slot = id % RUN_HISTORY_SLOTS),
+// so creating run N evicts run N - RUN_HISTORY_SLOTS and listing never opens a result file. The manifest is cached in
+// RAM and rewritten (tmp + rename) whenever an entry changes.
+static const size_t RUN_HISTORY_SLOTS = 8;
+static const size_t RUN_PATH_LEN = 32;
+
+struct RunManifestEntry {
+  uint32_t runId;      // 0 = empty slot
+  uint32_t startEpoch; // wall-clock seconds supplied by the client, 0 if unknown
+  uint32_t startMs;    // device uptime at run start
+  uint16_t stepCount;
+  uint16_t flags;      // JOURNAL_FLAG_*; CLOSED clear while the run is being recorded
+  uint32_t sampleCount;
+  float peakThrust;
+  char sequence[JOURNAL_SEQUENCE_LEN];
+};
+static_assert(sizeof(RunManifestEntry) == 128, "manifest entry layout changed");
+
+void initRunHistory();
+// Allocates the next run id and records an open entry; returns 0 on failure.
+uint32_t createRunHistoryEntry(uint32_t startEpoch, uint32_t startMs, uint16_t stepCount, const char *sequence);
+void finishRunHistoryEntry(uint32_t runId, uint32_t sampleCount, float peakThrust, uint32_t flags);
+// runId 0 resolves to the newest run.
+bool runHistoryPath(uint32_t runId, char *out, size_t outLen);
+// Per-step summary CSV stored next to the run's journal.
+bool runHistoryStepsPath(uint32_t runId, char *out, size_t outLen);
+uint32_t latestRunId();
+// Copies entries newest first; returns the number copied.
+size_t listRunHistory(RunManifestEntry *out, size_t maxEntries);
+enum class RunDeleteResult : uint8_t { DELETED, NOT_FOUND, IN_USE };
+// Deletes a closed run and its files. The run being recorded counts as NOT_FOUND, one
+// pinned by a download as IN_USE.
+RunDeleteResult deleteRunHistoryEntry(uint32_t runId);
+// Keeps a run's files while a download reads them (runId 0 = newest): deleting it is
+// refused, and evicting it for a new run defers removing its files to the last unpin.
+// Returns the pinned id, or 0 if there is no such run or its slot is still pinned by the
+// run it evicted.
+uint32_t pinRunHistoryEntry(uint32_t runId);
+void unpinRunHistoryEntry(uint32_t runId);
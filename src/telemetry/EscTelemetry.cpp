@@ -1,14 +1,92 @@
 #include "EscTelemetry.h"
 
+#include "esc/DshotTelemetry.h"
+#include "esc/EscOutput.h"
+#include "hal/Hal.h"
+#include "telemetry/KissTelemetry.h"
+#include "util/Log.h"
+#include "util/SpscRing.h"
 #include <Arduino.h>
+#include <atomic>
 
 static volatile uint32_t latestPulseWidth = 0;
 static volatile unsigned long pulseStartTime = 0;
 static volatile uint32_t lastPulseAtUs = 0;
 static const BoardConfig *s_cfg = nullptr;
 static const unsigned long TELEM_STALE_MS = 500;
+// Idle time that ends a capture, in reply bits; GCR never holds a level longer than 3.
+static const uint32_t RPM_CAPTURE_IDLE_BITS = 4;
 
-void initEscTelemetry(const BoardConfig &cfg) { s_cfg = &cfg; }
+static uint32_t s_rpmBitNs = 0;
+static std::atomic<uint32_t> s_erpm{0};
+static std::atomic<uint32_t> s_rpmAtMs{0};
+static std::atomic<uint32_t> s_rpmReplies{0};
+static std::atomic<uint32_t> s_rpmErrors{0};
+
+// KISS serial: the UART task parses frames and hands them to loop() through the ring.
+static KissTelemetryParser s_kissParser; // UART task only
+static uint32_t s_kissByteUs = 0;
+static SpscRing<KissTelemetryFrame, 8> s_kissRing;
+static std::atomic<uint32_t> s_kissFrames{0};
+static std::atomic<uint32_t> s_kissCrcErrors{0};
+static std::atomic<uint32_t> s_kissDropped{0};
+static KissTelemetryFrame s_kissLatest; // loop only
+static bool s_kissHaveFrame = false;
+static unsigned long s_lastKissRequestMs = 0;
+
+static void handleKissBytes(const uint8_t *data, size_t len, uint64_t firstByteUs, void *arg) {
+  (void)arg;
+  for (size_t i = 0; i < len; i++) {
+    KissTelemetryFrame frame;
+    if (kissParserPush(s_kissParser, data[i], firstByteUs + i * s_kissByteUs, frame) && !s_kissRing.push(frame)) {
+      s_kissDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  s_kissFrames.store(s_kissParser.frames, std::memory_order_relaxed);
+  s_kissCrcErrors.store(s_kissParser.crcErrors, std::memory_order_relaxed);
+}
+
+void initEscTelemetry(const BoardConfig &cfg) {
+  s_cfg = &cfg;
+  if (cfg.esc_telem_source == EscTelemSource::PWM) {
+    pinMode(cfg.esc_telem_pin, INPUT_PULLDOWN);
+    attachInterrupt(digitalPinToInterrupt(cfg.esc_telem_pin), handleTelemInterrupt, CHANGE);
+    return;
+  }
+  kissParserReset(s_kissParser);
+  s_kissByteUs = (10000000UL + cfg.esc_telem_baud / 2) / cfg.esc_telem_baud;
+  if (!halSerialInputBegin(cfg.esc_telem_pin, cfg.esc_telem_baud, handleKissBytes, nullptr)) {
+    logError("Failed to start KISS telemetry UART on GPIO %d", cfg.esc_telem_pin);
+    return;
+  }
+  logInfo("KISS telemetry on GPIO %d at %lu baud", cfg.esc_telem_pin, (unsigned long)cfg.esc_telem_baud);
+  if (!escProtocolIsDshot(cfg.esc_protocol)) {
+    logWarn("%s cannot request KISS telemetry; the ESC has to send it unprompted", escProtocolName(cfg.esc_protocol));
+  }
+}
+
+// Drains the ring and asks the ESC for the next frame at ESC_TELEM_REQUEST_HZ.
+static void pollKissTelemetry(const BoardConfig &cfg) {
+  KissTelemetryFrame frame;
+  while (s_kissRing.pop(frame)) {
+    s_kissLatest = frame;
+    s_kissHaveFrame = true;
+  }
+  const unsigned long now = halMillis();
+  if (now - s_lastKissRequestMs >= 1000UL / (unsigned long)cfg.esc_telem_request_hz) {
+    s_lastKissRequestMs = now;
+    requestEscTelemetry();
+  }
+}
+
+static bool kissFrameFresh(unsigned long &ageMs) {
+  if (!s_kissHaveFrame) {
+    ageMs = 0;
+    return false;
+  }
+  ageMs = (unsigned long)((halWallMicros() - s_kissLatest.atUs) / 1000ULL);
+  return ageMs <= TELEM_STALE_MS;
+}
 
 void IRAM_ATTR handleTelemInterrupt() {
   if (!s_cfg) return;
@@ -31,6 +109,13 @@ void readEscTelemetry(bool simEnabled,
     ageMs = 0;
     return;
   }
+  if (cfg.esc_telem_source == EscTelemSource::KISS) {
+    pollKissTelemetry(cfg);
+    stale = !kissFrameFresh(ageMs);
+    escVoltage = stale ? 0.0f : s_kissLatest.voltage;
+    escCurrent = stale ? 0.0f : s_kissLatest.current;
+    return;
+  }
   uint32_t nowUs = micros();
   uint32_t ageUs = nowUs - lastPulseAtUs;
   ageMs = (lastPulseAtUs == 0) ? 0 : (unsigned long)(ageUs / 1000UL);
@@ -49,3 +134,70 @@ void readEscTelemetry(bool simEnabled,
     escCurrent = (pulse - cfg.telem_current_min) / cfg.telem_scale;
   }
 }
+
+// Runs on the capture driver task. Bursts that do not add up to a reply (our own frames,
+// noise) fail the run-length step and are ignored; only corrupted replies count as errors.
+static void handleRpmCapture(const uint16_t *runTicks, size_t count, void *arg) {
+  (void)arg;
+  uint32_t stream = 0;
+  if (!dshotTelemetryStream(runTicks, count, ESC_FRAME_TICK_NS, s_rpmBitNs, stream)) return;
+  uint16_t value = 0;
+  if (!dshotTelemetryValue(stream, value)) {
+    s_rpmErrors.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  s_erpm.store(dshotTelemetryErpm(value), std::memory_order_relaxed);
+  s_rpmAtMs.store((uint32_t)halMillis(), std::memory_order_release);
+  s_rpmReplies.fetch_add(1, std::memory_order_relaxed);
+}
+
+void initEscRpmTelemetry(const BoardConfig &cfg) {
+  const EscOutputPlan &plan = escOutputPlan();
+  if (!plan.bidirectional) return;
+  s_rpmBitNs = plan.telemetryBitNs;
+  const uint32_t idleTicks = RPM_CAPTURE_IDLE_BITS * s_rpmBitNs / ESC_FRAME_TICK_NS;
+  if (!halFrameCaptureBegin(cfg.esc_pin, ESC_FRAME_TICK_NS, idleTicks, handleRpmCapture, nullptr)) {
+    logError("Failed to start DShot RPM capture on GPIO %d", cfg.esc_pin);
+    return;
+  }
+  logInfo("DShot RPM telemetry on GPIO %d (%d poles)", cfg.esc_pin, cfg.motor_poles);
+}
+
+void readEscRpm(bool simEnabled, const BoardConfig &cfg, uint32_t &rpm, bool &stale) {
+  // Serial telemetry carries eRPM too; bidirectional DShot wins when both are running.
+  unsigned long kissAgeMs = 0;
+  if (!simEnabled && s_rpmBitNs == 0 && cfg.esc_telem_source == EscTelemSource::KISS && kissFrameFresh(kissAgeMs)) {
+    rpm = dshotErpmToRpm(s_kissLatest.erpm, cfg.motor_poles);
+    stale = false;
+    return;
+  }
+  const uint32_t atMs = s_rpmAtMs.load(std::memory_order_acquire);
+  if (simEnabled || atMs == 0 || (uint32_t)halMillis() - atMs > TELEM_STALE_MS) {
+    rpm = 0;
+    stale = true;
+    return;
+  }
+  rpm = dshotErpmToRpm(s_erpm.load(std::memory_order_relaxed), cfg.motor_poles);
+  stale = false;
+}
+
+EscRpmStats getEscRpmStats() {
+  EscRpmStats stats;
+  stats.replies = s_rpmReplies.load(std::memory_order_relaxed);
+  stats.errors = s_rpmErrors.load(std::memory_order_relaxed);
+  return stats;
+}
+
+bool readEscSerialTelemetry(KissTelemetryFrame &out) {
+  if (!s_kissHaveFrame) return false;
+  out = s_kissLatest;
+  return true;
+}
+
+EscSerialStats getEscSerialStats() {
+  EscSerialStats stats;
+  stats.frames = s_kissFrames.load(std::memory_order_relaxed);
+  stats.crcErrors = s_kissCrcErrors.load(std::memory_order_relaxed);
+  stats.dropped = s_kissDropped.load(std::memory_order_relaxed);
+  return stats;
+}
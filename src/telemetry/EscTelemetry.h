@@ -1,7 +1,10 @@
 #pragma once
 
 #include "config/BoardConfig.h"
+#include "telemetry/KissTelemetry.h"
 
+// Starts the [esc_telem] source: the pulse-width interrupt on ESC_TELEM_PIN, or the KISS
+// UART task reading it. readEscTelemetry() serves either one.
 void initEscTelemetry(const BoardConfig &cfg);
 void handleTelemInterrupt();
 void readEscTelemetry(bool simEnabled,
@@ -10,3 +13,23 @@ void readEscTelemetry(bool simEnabled,
                       float &escCurrent,
                       bool &stale,
                       unsigned long &ageMs);
+
+// Bidirectional DShot RPM, read back on ESC_PIN. Start after initEscOutput(); does nothing
+// unless the output plan is bidirectional.
+struct EscRpmStats {
+  uint32_t replies; // decoded eRPM replies
+  uint32_t errors;  // replies with a bad GCR symbol or checksum
+};
+void initEscRpmTelemetry(const BoardConfig &cfg);
+void readEscRpm(bool simEnabled, const BoardConfig &cfg, uint32_t &rpm, bool &stale);
+EscRpmStats getEscRpmStats();
+
+struct EscSerialStats {
+  uint32_t frames;
+  uint32_t crcErrors;
+  uint32_t dropped; // parsed but not collected by loop() in time
+};
+// Latest KISS frame (temperature, consumption, eRPM and arrival time); false until one arrives.
+// Call from loop() after readEscTelemetry().
+bool readEscSerialTelemetry(KissTelemetryFrame &out);
+EscSerialStats getEscSerialStats();
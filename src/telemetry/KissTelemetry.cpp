@@ -0,0 +1,42 @@
+#include "KissTelemetry.h"
+
+#include <string.h>
+
+uint8_t kissCrc8(const uint8_t *data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+void kissParserReset(KissTelemetryParser &parser) { memset(&parser, 0, sizeof(parser)); }
+
+static uint16_t be16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+bool kissParserPush(KissTelemetryParser &parser, uint8_t byte, uint64_t atUs, KissTelemetryFrame &out) {
+  if (parser.len > 0 && atUs - parser.lastByteUs > KISS_FRAME_GAP_US) parser.len = 0;
+  if (parser.len == 0) parser.firstByteUs = atUs;
+  parser.lastByteUs = atUs;
+  parser.buf[parser.len++] = byte;
+  if (parser.len < KISS_FRAME_LEN) return false;
+
+  const uint8_t *b = parser.buf;
+  if (kissCrc8(b, KISS_FRAME_LEN - 1) != b[KISS_FRAME_LEN - 1]) {
+    parser.crcErrors++;
+    // Retry from the next byte; its arrival time is unknown, so the frame time becomes approximate.
+    memmove(parser.buf, parser.buf + 1, KISS_FRAME_LEN - 1);
+    parser.len = KISS_FRAME_LEN - 1;
+    return false;
+  }
+  out.atUs = parser.firstByteUs;
+  out.temperatureC = b[0];
+  out.voltage = be16(b + 1) / 100.0f;
+  out.current = be16(b + 3) / 100.0f;
+  out.consumptionMah = be16(b + 5);
+  out.erpm = (uint32_t)be16(b + 7) * 100;
+  parser.len = 0;
+  parser.frames++;
+  return true;
+}
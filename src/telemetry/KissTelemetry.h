@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// KISS serial ESC telemetry (also sent by BLHeli_32 and AM32), 115200 8N1. Each 10-byte
+// frame answers one DShot telemetry request:
+//   temperature (C), voltage (0.01 V, BE16), current (0.01 A, BE16), consumption (mAh,
+//   BE16), eRPM / 100 (BE16), CRC8 (poly 0x07, init 0) over the first 9 bytes.
+// Frames have no sync byte; the parser resynchronises on idle gaps and by sliding one byte
+// at a time past bad checksums. It never allocates and accepts any byte sequence, so it can
+// be fed noise on the host.
+
+static const size_t KISS_FRAME_LEN = 10;
+// A gap this long between bytes starts a new frame (a frame takes ~870 us at 115200).
+static const uint32_t KISS_FRAME_GAP_US = 500;
+
+struct KissTelemetryFrame {
+  uint64_t atUs; // arrival of the first byte
+  float voltage;
+  float current;
+  uint16_t consumptionMah;
+  uint32_t erpm;
+  uint8_t temperatureC;
+};
+
+struct KissTelemetryParser {
+  uint8_t buf[KISS_FRAME_LEN];
+  size_t len;
+  uint64_t firstByteUs;
+  uint64_t lastByteUs;
+  uint32_t frames;
+  uint32_t crcErrors;
+};
+
+uint8_t kissCrc8(const uint8_t *data, size_t len);
+void kissParserReset(KissTelemetryParser &parser);
+// Feeds one byte received at atUs; true when it completed a valid frame, stored in out.
+bool kissParserPush(KissTelemetryParser &parser, uint8_t byte, uint64_t atUs, KissTelemetryFrame &out);
@@ -0,0 +1,55 @@
+#include "SampleRateStats.h"
+
+#include <math.h>
+#include <stdio.h>
+
+void SampleRateStats::begin(uint32_t gapThresholdUs) {
+  *this = SampleRateStats();
+  gapThresholdUs_ = gapThresholdUs;
+}
+
+void SampleRateStats::add(uint32_t timestampUs) {
+  if (!seeded_) {
+    seeded_ = true;
+    lastUs_ = timestampUs;
+    return;
+  }
+  const uint32_t interval = timestampUs - lastUs_;
+  lastUs_ = timestampUs;
+
+  if (gapThresholdUs_ > 0) {
+    if (interval > gapThresholdUs_) gaps_++;
+  } else if (count_ >= SAMPLE_GAP_AUTO_MIN_INTERVALS && interval > mean_ * SAMPLE_GAP_AUTO_FACTOR) {
+    gaps_++;
+  }
+
+  count_++;
+  const double delta = interval - mean_;
+  mean_ += delta / count_;
+  m2_ += delta * (interval - mean_);
+  if (count_ == 1 || interval < min_) min_ = interval;
+  if (count_ == 1 || interval > max_) max_ = interval;
+  spanUs_ += interval;
+}
+
+SampleRateSummary SampleRateStats::summary() const {
+  SampleRateSummary s = {};
+  s.intervals = count_;
+  s.meanUs = (uint32_t)(mean_ + 0.5);
+  s.stddevUs = count_ > 1 ? (uint32_t)(sqrt(m2_ / (count_ - 1)) + 0.5) : 0;
+  s.minUs = min_;
+  s.maxUs = max_;
+  s.gaps = gaps_;
+  s.sps = spanUs_ > 0 ? (float)((double)count_ * 1e6 / (double)spanUs_) : 0.0f;
+  s.gapThresholdUs = gapThresholdUs_;
+  return s;
+}
+
+size_t formatSampleRateJson(const SampleRateSummary &run, const SampleRateSummary &step, char *out, size_t outLen) {
+  int n = snprintf(out, outLen,
+                   "{\"type\":\"sample_rate\",\"sps\":%.2f,\"mean_us\":%lu,\"jitter_us\":%lu,\"min_us\":%lu,"
+                   "\"max_us\":%lu,\"gaps\":%lu,\"step_sps\":%.2f,\"step_gaps\":%lu}",
+                   run.sps, (unsigned long)run.meanUs, (unsigned long)run.stddevUs, (unsigned long)run.minUs,
+                   (unsigned long)run.maxUs, (unsigned long)run.gaps, step.sps, (unsigned long)step.gaps);
+  return (n > 0 && (size_t)n < outLen) ? (size_t)n : 0;
+}
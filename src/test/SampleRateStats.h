@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Without a configured threshold (SAMPLE_GAP_MS = 0) an interval counts as a gap when it is
+// longer than this multiple of the average interval so far.
+static const float SAMPLE_GAP_AUTO_FACTOR = 1.5f;
+// Intervals needed before the automatic threshold is trusted.
+static const uint32_t SAMPLE_GAP_AUTO_MIN_INTERVALS = 4;
+
+// Also the on-flash layout of the rate section of a journal header (32 bytes).
+struct SampleRateSummary {
+  uint32_t intervals;
+  uint32_t meanUs;
+  uint32_t stddevUs; // jitter
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint32_t gaps;
+  float sps;               // effective rate: intervals over the time they span
+  uint32_t gapThresholdUs; // configured threshold, 0 = automatic
+};
+static_assert(sizeof(SampleRateSummary) == 32, "sample rate summary layout changed");
+
+// Inter-sample interval statistics from sample timestamps (micros(), wrap-safe), O(1) per
+// sample with Welford's update.
+class SampleRateStats {
+ public:
+  void begin(uint32_t gapThresholdUs);
+  void add(uint32_t timestampUs);
+  SampleRateSummary summary() const;
+
+ private:
+  bool seeded_ = false;
+  uint32_t lastUs_ = 0;
+  uint32_t gapThresholdUs_ = 0;
+  uint32_t count_ = 0;
+  double mean_ = 0.0;
+  double m2_ = 0.0;
+  uint32_t min_ = 0;
+  uint32_t max_ = 0;
+  uint32_t gaps_ = 0;
+  uint64_t spanUs_ = 0;
+};
+
+size_t formatSampleRateJson(const SampleRateSummary &run, const SampleRateSummary &step, char *out, size_t outLen);
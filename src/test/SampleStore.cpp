@@ -0,0 +1,281 @@
+#include "SampleStore.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+static int32_t toCenti(float value) {
+  const float scaled = value * 100.0f;
+  if (scaled >= 2147483520.0f) return INT32_MAX;
+  if (scaled <= -2147483520.0f) return INT32_MIN;
+  return (int32_t)lroundf(scaled);
+}
+
+// Deltas use wrapping unsigned arithmetic so extreme values never overflow int32.
+static int32_t wrappingSub(int32_t a, int32_t b) { return (int32_t)((uint32_t)a - (uint32_t)b); }
+
+static int32_t wrappingAdd(int32_t a, int32_t b) { return (int32_t)((uint32_t)a + (uint32_t)b); }
+
+static uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+
+static int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+static size_t putVarint(uint8_t *p, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  p[n++] = (uint8_t)v;
+  return n;
+}
+
+static uint32_t getVarint(const uint8_t *p, size_t &offset) {
+  uint32_t v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    uint8_t b = p[offset++];
+    v |= (uint32_t)(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) break;
+  }
+  return v;
+}
+
+SampleStore::~SampleStore() { release(); }
+
+bool SampleStore::begin(size_t maxSamples, size_t maxBytes, uint8_t channels) {
+  release();
+  if (maxSamples == 0) return false;
+  const size_t blockCount = (maxSamples + SAMPLE_STORE_BLOCK_SIZE - 1) / SAMPLE_STORE_BLOCK_SIZE;
+  blocks_ = static_cast<BlockHeader *>(malloc(blockCount * sizeof(BlockHeader)));
+  if (maxBytes < SAMPLE_STORE_MAX_ROW_BYTES) maxBytes = SAMPLE_STORE_MAX_ROW_BYTES;
+  arena_ = static_cast<uint8_t *>(malloc(maxBytes));
+  if (!blocks_ || !arena_) {
+    release();
+    return false;
+  }
+  arenaSize_ = maxBytes;
+  if (channels & SAMPLE_CHANNEL_ELECTRICAL) {
+    size_t electricalBytes = maxSamples * SAMPLE_STORE_ELECTRICAL_BYTES_PER_SAMPLE;
+    if (electricalBytes < maxSamples + SAMPLE_STORE_MAX_ELECTRICAL_ROW_BYTES) {
+      electricalBytes = maxSamples + SAMPLE_STORE_MAX_ELECTRICAL_ROW_BYTES;
+    }
+    electricalBlocks_ = static_cast<ElectricalBlockHeader *>(malloc(blockCount * sizeof(ElectricalBlockHeader)));
+    electricalArena_ = static_cast<uint8_t *>(malloc(electricalBytes));
+    if (!electricalBlocks_ || !electricalArena_) {
+      release();
+      return false;
+    }
+    electricalArenaSize_ = electricalBytes;
+  }
+  if (channels & SAMPLE_CHANNEL_RPM) {
+    size_t rpmBytes = maxSamples * SAMPLE_STORE_RPM_BYTES_PER_SAMPLE;
+    if (rpmBytes < SAMPLE_STORE_MAX_RPM_ROW_BYTES) rpmBytes = SAMPLE_STORE_MAX_RPM_ROW_BYTES;
+    rpmBlocks_ = static_cast<RpmBlockHeader *>(malloc(blockCount * sizeof(RpmBlockHeader)));
+    rpmArena_ = static_cast<uint8_t *>(malloc(rpmBytes));
+    if (!rpmBlocks_ || !rpmArena_) {
+      release();
+      return false;
+    }
+    rpmArenaSize_ = rpmBytes;
+  }
+  channels_ = channels;
+  maxSamples_ = maxSamples;
+  clear();
+  return true;
+}
+
+void SampleStore::release() {
+  free(arena_);
+  free(blocks_);
+  free(electricalArena_);
+  free(electricalBlocks_);
+  free(rpmArena_);
+  free(rpmBlocks_);
+  arena_ = nullptr;
+  blocks_ = nullptr;
+  electricalArena_ = nullptr;
+  electricalBlocks_ = nullptr;
+  rpmArena_ = nullptr;
+  rpmBlocks_ = nullptr;
+  arenaSize_ = 0;
+  electricalArenaSize_ = 0;
+  rpmArenaSize_ = 0;
+  channels_ = 0;
+  maxSamples_ = 0;
+  clear();
+}
+
+void SampleStore::clear() {
+  arenaUsed_ = 0;
+  blockCount_ = 0;
+  count_ = 0;
+  lastTimestamp_ = 0;
+  lastThrustCenti_ = 0;
+  lastPwm_ = 0;
+  electricalArenaUsed_ = 0;
+  lastVoltageCenti_ = 0;
+  lastCurrentCenti_ = 0;
+  rpmArenaUsed_ = 0;
+  lastRpm_ = 0;
+}
+
+// Appends the electrical column for the sample about to become count_.
+void SampleStore::pushElectrical(const DataPoint &point) {
+  const int32_t voltageCenti = toCenti(point.voltage);
+  const int32_t currentCenti = toCenti(point.current);
+  if (count_ % SAMPLE_STORE_BLOCK_SIZE == 0) {
+    ElectricalBlockHeader &block = electricalBlocks_[count_ / SAMPLE_STORE_BLOCK_SIZE];
+    block.offset = (uint32_t)electricalArenaUsed_;
+    block.voltageCenti = voltageCenti;
+    block.currentCenti = currentCenti;
+  } else {
+    // A full row must still leave one byte for each later row's "unchanged" mask.
+    const size_t laterRows = maxSamples_ - count_ - 1;
+    if (electricalArenaSize_ - electricalArenaUsed_ < SAMPLE_STORE_MAX_ELECTRICAL_ROW_BYTES + laterRows) {
+      electricalArena_[electricalArenaUsed_++] = 0;
+      return;
+    }
+    const bool voltageChanged = voltageCenti != lastVoltageCenti_;
+    const bool currentChanged = currentCenti != lastCurrentCenti_;
+    uint8_t *p = electricalArena_ + electricalArenaUsed_;
+    size_t n = 0;
+    p[n++] = (uint8_t)((voltageChanged ? 1u : 0u) | (currentChanged ? 2u : 0u));
+    if (voltageChanged) n += putVarint(p + n, zigzag(wrappingSub(voltageCenti, lastVoltageCenti_)));
+    if (currentChanged) n += putVarint(p + n, zigzag(wrappingSub(currentCenti, lastCurrentCenti_)));
+    electricalArenaUsed_ += n;
+  }
+  lastVoltageCenti_ = voltageCenti;
+  lastCurrentCenti_ = currentCenti;
+}
+
+// Appends the RPM column for the sample about to become count_.
+void SampleStore::pushRpm(const DataPoint &point) {
+  const int32_t rpm = point.rpm > INT32_MAX ? INT32_MAX : (int32_t)point.rpm;
+  if (count_ % SAMPLE_STORE_BLOCK_SIZE == 0) {
+    RpmBlockHeader &block = rpmBlocks_[count_ / SAMPLE_STORE_BLOCK_SIZE];
+    block.offset = (uint32_t)rpmArenaUsed_;
+    block.rpm = rpm;
+  } else {
+    rpmArenaUsed_ += putVarint(rpmArena_ + rpmArenaUsed_, zigzag(wrappingSub(rpm, lastRpm_)));
+  }
+  lastRpm_ = rpm;
+}
+
+bool SampleStore::push(const DataPoint &point) {
+  if (!arena_ || count_ >= maxSamples_) return false;
+  // Every column's room is checked before any is written, so a failed push leaves none ahead.
+  // The electrical column always has room for a row, see pushElectrical().
+  if (count_ % SAMPLE_STORE_BLOCK_SIZE != 0) {
+    if (arenaSize_ - arenaUsed_ < SAMPLE_STORE_MAX_ROW_BYTES) return false;
+    if ((channels_ & SAMPLE_CHANNEL_RPM) && rpmArenaSize_ - rpmArenaUsed_ < SAMPLE_STORE_MAX_RPM_ROW_BYTES) return false;
+  }
+  if (channels_ & SAMPLE_CHANNEL_ELECTRICAL) pushElectrical(point);
+  if (channels_ & SAMPLE_CHANNEL_RPM) pushRpm(point);
+  const uint32_t timestamp = (uint32_t)point.timestamp;
+  const int32_t thrustCenti = toCenti(point.thrust);
+  const int32_t pwm = (int32_t)point.pwm;
+
+  if (count_ % SAMPLE_STORE_BLOCK_SIZE == 0) {
+    // Block starts are absolute, which is what lets reader() seek without decoding from 0.
+    BlockHeader &block = blocks_[blockCount_++];
+    block.offset = (uint32_t)arenaUsed_;
+    block.timestamp = timestamp;
+    block.thrustCenti = thrustCenti;
+    block.pwm = pwm;
+  } else {
+    const uint32_t dt = timestamp - lastTimestamp_;
+    const bool pwmChanged = (pwm != lastPwm_);
+    uint8_t *p = arena_ + arenaUsed_;
+    size_t n = 0;
+    // dt above 2^31 ms cannot happen within one run; the top bit is dropped.
+    n += putVarint(p + n, (dt << 1) | (pwmChanged ? 1u : 0u));
+    n += putVarint(p + n, zigzag(wrappingSub(thrustCenti, lastThrustCenti_)));
+    if (pwmChanged) n += putVarint(p + n, zigzag(wrappingSub(pwm, lastPwm_)));
+    arenaUsed_ += n;
+  }
+
+  lastTimestamp_ = timestamp;
+  lastThrustCenti_ = thrustCenti;
+  lastPwm_ = pwm;
+  count_++;
+  return true;
+}
+
+size_t SampleStore::bytesUsed() const {
+  size_t used = arenaUsed_ + blockCount_ * sizeof(BlockHeader);
+  if (channels_ & SAMPLE_CHANNEL_ELECTRICAL) used += electricalArenaUsed_ + blockCount_ * sizeof(ElectricalBlockHeader);
+  if (channels_ & SAMPLE_CHANNEL_RPM) used += rpmArenaUsed_ + blockCount_ * sizeof(RpmBlockHeader);
+  return used;
+}
+
+size_t SampleStore::bytesReserved() const {
+  const size_t blockCapacity = (maxSamples_ + SAMPLE_STORE_BLOCK_SIZE - 1) / SAMPLE_STORE_BLOCK_SIZE;
+  size_t reserved = arenaSize_ + blockCapacity * sizeof(BlockHeader);
+  if (channels_ & SAMPLE_CHANNEL_ELECTRICAL) reserved += electricalArenaSize_ + blockCapacity * sizeof(ElectricalBlockHeader);
+  if (channels_ & SAMPLE_CHANNEL_RPM) reserved += rpmArenaSize_ + blockCapacity * sizeof(RpmBlockHeader);
+  return reserved;
+}
+
+SampleStore::Reader SampleStore::reader(size_t startIndex) const {
+  Reader r;
+  r.store_ = this;
+  if (startIndex > count_) startIndex = count_;
+  r.index_ = startIndex;
+  if (startIndex == count_) return r;
+
+  const size_t block = startIndex / SAMPLE_STORE_BLOCK_SIZE;
+  r.index_ = block * SAMPLE_STORE_BLOCK_SIZE;
+  r.offset_ = blocks_[block].offset;
+  if (channels_ & SAMPLE_CHANNEL_ELECTRICAL) r.electricalOffset_ = electricalBlocks_[block].offset;
+  if (channels_ & SAMPLE_CHANNEL_RPM) r.rpmOffset_ = rpmBlocks_[block].offset;
+  DataPoint skipped;
+  while (r.index_ < startIndex) r.next(skipped);
+  return r;
+}
+
+bool SampleStore::Reader::next(DataPoint &out) {
+  if (!store_ || index_ >= store_->count_) return false;
+  if (index_ % SAMPLE_STORE_BLOCK_SIZE == 0) {
+    const BlockHeader &block = store_->blocks_[index_ / SAMPLE_STORE_BLOCK_SIZE];
+    offset_ = block.offset;
+    timestamp_ = block.timestamp;
+    thrustCenti_ = block.thrustCenti;
+    pwm_ = block.pwm;
+  } else {
+    const uint8_t *arena = store_->arena_;
+    const uint32_t head = getVarint(arena, offset_);
+    timestamp_ += head >> 1;
+    thrustCenti_ = wrappingAdd(thrustCenti_, unzigzag(getVarint(arena, offset_)));
+    if (head & 1) pwm_ = wrappingAdd(pwm_, unzigzag(getVarint(arena, offset_)));
+  }
+  if (store_->channels_ & SAMPLE_CHANNEL_ELECTRICAL) {
+    if (index_ % SAMPLE_STORE_BLOCK_SIZE == 0) {
+      const ElectricalBlockHeader &block = store_->electricalBlocks_[index_ / SAMPLE_STORE_BLOCK_SIZE];
+      electricalOffset_ = block.offset;
+      voltageCenti_ = block.voltageCenti;
+      currentCenti_ = block.currentCenti;
+    } else {
+      const uint8_t *arena = store_->electricalArena_;
+      const uint8_t mask = arena[electricalOffset_++];
+      if (mask & 1) voltageCenti_ = wrappingAdd(voltageCenti_, unzigzag(getVarint(arena, electricalOffset_)));
+      if (mask & 2) currentCenti_ = wrappingAdd(currentCenti_, unzigzag(getVarint(arena, electricalOffset_)));
+    }
+  }
+  if (store_->channels_ & SAMPLE_CHANNEL_RPM) {
+    if (index_ % SAMPLE_STORE_BLOCK_SIZE == 0) {
+      const RpmBlockHeader &block = store_->rpmBlocks_[index_ / SAMPLE_STORE_BLOCK_SIZE];
+      rpmOffset_ = block.offset;
+      rpm_ = block.rpm;
+    } else {
+      rpm_ = wrappingAdd(rpm_, unzigzag(getVarint(store_->rpmArena_, rpmOffset_)));
+    }
+  }
+  out.timestamp = timestamp_;
+  out.thrust = (float)thrustCenti_ / 100.0f;
+  out.pwm = pwm_;
+  out.subMsUs = 0;
+  out.voltage = (float)voltageCenti_ / 100.0f;
+  out.current = (float)currentCenti_ / 100.0f;
+  out.rpm = (uint32_t)rpm_;
+  index_++;
+  return true;
+}
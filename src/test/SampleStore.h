@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Decoded view of one recorded sample.
+struct DataPoint {
+  unsigned long timestamp;
+  float thrust;
+  int pwm;
+  uint16_t subMsUs; // 0..999 us past timestamp; only journaled samples carry it
+  float voltage;    // ESC telemetry at the sample, 0 when the run has no electrical channel
+  float current;
+  uint32_t rpm; // motor RPM from bidirectional DShot, 0 when the run has no RPM channel
+};
+
+inline float dataPointPower(const DataPoint &point) { return point.voltage * point.current; }
+
+// Compact in-RAM store for a test run.
+//
+// Samples are grouped in blocks of SAMPLE_STORE_BLOCK_SIZE. The first sample of a
+// block lives in the block index; the rest are varint rows relative to the previous
+// sample: ((dt_ms << 1) | pwm_changed), zigzag(d_thrust in 0.01 g)[, zigzag(d_pwm)].
+// A steady run costs ~3 bytes per sample instead of 12 for a raw journal record.
+//
+// Optional channels are separate columns with their own block index and arena, so a
+// run that does not enable them pays nothing. SAMPLE_CHANNEL_ELECTRICAL rows are
+// (changed_mask)[, zigzag(d_voltage in 0.01 V)][, zigzag(d_current in 0.01 A)]; ESC
+// telemetry updates far slower than the load cell, so most rows are a single 0 byte, but
+// noisy telemetry changes every row. The column is sized for that (5 bytes covers steps up
+// to 81 V / 81 A); if it still runs short it keeps one byte per remaining row and records
+// "unchanged" until the next block start, so thrust keeps recording.
+// SAMPLE_CHANNEL_RPM rows are zigzag(d_rpm), one byte while the speed holds within 63 RPM.
+static const uint8_t SAMPLE_CHANNEL_ELECTRICAL = 0x01;
+static const uint8_t SAMPLE_CHANNEL_RPM = 0x02;
+static const size_t SAMPLE_STORE_BLOCK_SIZE = 64;
+static const size_t SAMPLE_STORE_MAX_ROW_BYTES = 15;
+static const size_t SAMPLE_STORE_MAX_ELECTRICAL_ROW_BYTES = 11;
+static const size_t SAMPLE_STORE_MAX_RPM_ROW_BYTES = 5;
+// Planning figures used to size the arenas from MAX_TEST_SAMPLES and the heap budget.
+static const size_t SAMPLE_STORE_BYTES_PER_SAMPLE = 4;
+static const size_t SAMPLE_STORE_ELECTRICAL_BYTES_PER_SAMPLE = 5;
+static const size_t SAMPLE_STORE_RPM_BYTES_PER_SAMPLE = 2;
+
+class SampleStore {
+ public:
+  class Reader {
+   public:
+    bool next(DataPoint &out);
+    size_t index() const { return index_; }
+
+   private:
+    friend class SampleStore;
+    const SampleStore *store_ = nullptr;
+    size_t index_ = 0;
+    size_t offset_ = 0;
+    uint32_t timestamp_ = 0;
+    int32_t thrustCenti_ = 0;
+    int32_t pwm_ = 0;
+    size_t electricalOffset_ = 0;
+    int32_t voltageCenti_ = 0;
+    int32_t currentCenti_ = 0;
+    size_t rpmOffset_ = 0;
+    int32_t rpm_ = 0;
+  };
+
+  SampleStore() = default;
+  ~SampleStore();
+  SampleStore(const SampleStore &) = delete;
+  SampleStore &operator=(const SampleStore &) = delete;
+
+  // Allocates room for up to maxSamples, with the row arena capped at maxBytes. Each
+  // channel in the SAMPLE_CHANNEL_* mask adds a column sized by its planning figure.
+  bool begin(size_t maxSamples, size_t maxBytes, uint8_t channels = 0);
+  void release();
+  void clear();
+  bool push(const DataPoint &point);
+
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  size_t maxSamples() const { return maxSamples_; }
+  uint8_t channels() const { return channels_; }
+  size_t bytesUsed() const;
+  size_t bytesReserved() const;
+
+  // Reader positioned at startIndex (clamped to size()).
+  Reader reader(size_t startIndex = 0) const;
+
+ private:
+  struct BlockHeader {
+    uint32_t offset;
+    uint32_t timestamp;
+    int32_t thrustCenti;
+    int32_t pwm;
+  };
+  struct ElectricalBlockHeader {
+    uint32_t offset;
+    int32_t voltageCenti;
+    int32_t currentCenti;
+  };
+  struct RpmBlockHeader {
+    uint32_t offset;
+    int32_t rpm;
+  };
+
+  void pushElectrical(const DataPoint &point);
+  void pushRpm(const DataPoint &point);
+
+  uint8_t *arena_ = nullptr;
+  size_t arenaSize_ = 0;
+  size_t arenaUsed_ = 0;
+  BlockHeader *blocks_ = nullptr;
+  size_t blockCount_ = 0;
+  size_t maxSamples_ = 0;
+  size_t count_ = 0;
+  uint32_t lastTimestamp_ = 0;
+  int32_t lastThrustCenti_ = 0;
+  int32_t lastPwm_ = 0;
+  uint8_t channels_ = 0;
+  uint8_t *electricalArena_ = nullptr;
+  size_t electricalArenaSize_ = 0;
+  size_t electricalArenaUsed_ = 0;
+  ElectricalBlockHeader *electricalBlocks_ = nullptr;
+  int32_t lastVoltageCenti_ = 0;
+  int32_t lastCurrentCenti_ = 0;
+  uint8_t *rpmArena_ = nullptr;
+  size_t rpmArenaSize_ = 0;
+  size_t rpmArenaUsed_ = 0;
+  RpmBlockHeader *rpmBlocks_ = nullptr;
+  int32_t lastRpm_ = 0;
+};
@@ -0,0 +1,120 @@
+#include "StepStats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+const char STEP_SUMMARY_CSV_HEADER[] =
+    "step,pwm_us,samples,mean_g,stddev_g,min_g,max_g,settle_ms,voltage_v,current_a,power_w,g_per_w,sps,gaps,"
+    "target_g,mean_pwm_us";
+
+void StepStats::begin(uint16_t step, int pwm, float targetThrust) {
+  *this = StepStats();
+  active_ = true;
+  step_ = step;
+  pwm_ = pwm;
+  targetThrust_ = targetThrust;
+}
+
+void StepStats::trackSettle(SettleEnvelope &env, float thrust, uint32_t elapsedMs, bool high) {
+  // The top entry is always the previous sample.
+  if (env.count > 0) env.entries[env.count - 1].nextMs = elapsedMs;
+  while (env.count > 0 && (high ? env.entries[env.count - 1].thrust <= thrust
+                                : env.entries[env.count - 1].thrust >= thrust)) {
+    env.count--;
+  }
+  if (env.count == STEP_SETTLE_TRACK) {
+    if (env.entries[0].nextMs > settleFloorMs_) settleFloorMs_ = env.entries[0].nextMs;
+    memmove(env.entries, env.entries + 1, (STEP_SETTLE_TRACK - 1) * sizeof(SettleEntry));
+    env.count--;
+  }
+  env.entries[env.count++] = {thrust, elapsedMs};
+}
+
+uint32_t StepStats::settleMs(float finalThrust) const {
+  float band = fabsf(finalThrust) * STEP_SETTLE_BAND_PCT;
+  if (band < STEP_SETTLE_BAND_G) band = STEP_SETTLE_BAND_G;
+  uint32_t settle = settleFloorMs_;
+  // Newest first: the first entry out of band is the last such sample on that side.
+  for (int i = settleHigh_.count - 1; i >= 0; i--) {
+    if (settleHigh_.entries[i].thrust - finalThrust > band) {
+      if (settleHigh_.entries[i].nextMs > settle) settle = settleHigh_.entries[i].nextMs;
+      break;
+    }
+  }
+  for (int i = settleLow_.count - 1; i >= 0; i--) {
+    if (finalThrust - settleLow_.entries[i].thrust > band) {
+      if (settleLow_.entries[i].nextMs > settle) settle = settleLow_.entries[i].nextMs;
+      break;
+    }
+  }
+  return settle;
+}
+
+void StepStats::add(unsigned long elapsedInStepMs, bool stable, float thrust, bool telemetryValid, float voltage,
+                    float current, int pwm) {
+  if (!active_) return;
+
+  trackSettle(settleHigh_, thrust, (uint32_t)elapsedInStepMs, true);
+  trackSettle(settleLow_, thrust, (uint32_t)elapsedInStepMs, false);
+  lastThrust_ = thrust;
+
+  if (!stable) return;
+
+  count_++;
+  const double delta = thrust - mean_;
+  mean_ += delta / count_;
+  m2_ += delta * (thrust - mean_);
+  if (count_ == 1 || thrust < min_) min_ = thrust;
+  if (count_ == 1 || thrust > max_) max_ = thrust;
+  pwmSum_ += pwm;
+
+  if (telemetryValid) {
+    telemCount_++;
+    voltageSum_ += voltage;
+    currentSum_ += current;
+    powerSum_ += (double)voltage * current;
+  }
+}
+
+StepSummary StepStats::summary() const {
+  StepSummary s = {};
+  s.step = step_;
+  s.pwm = pwm_;
+  s.samples = count_;
+  s.meanThrust = (float)mean_;
+  s.stddevThrust = count_ > 1 ? (float)sqrt(m2_ / (count_ - 1)) : 0.0f;
+  s.minThrust = min_;
+  s.maxThrust = max_;
+  s.settleMs = settleMs(count_ > 0 ? (float)mean_ : lastThrust_);
+  s.targetThrust = targetThrust_;
+  s.meanPwm = count_ > 0 ? (float)(pwmSum_ / count_) : (float)pwm_;
+  if (targetThrust_ > 0.0f) s.pwm = (int)lroundf(s.meanPwm);
+  if (telemCount_ > 0) {
+    s.meanVoltage = (float)(voltageSum_ / telemCount_);
+    s.meanCurrent = (float)(currentSum_ / telemCount_);
+    s.meanPower = (float)(powerSum_ / telemCount_);
+    s.gramsPerWatt = s.meanPower > 0.0f ? s.meanThrust / s.meanPower : 0.0f;
+  }
+  return s;
+}
+
+size_t formatStepSummaryJson(const StepSummary &s, char *out, size_t outLen) {
+  int n = snprintf(out, outLen,
+                   "{\"type\":\"step_summary\",\"step\":%u,\"pwm\":%d,\"samples\":%lu,\"mean\":%.2f,"
+                   "\"stddev\":%.3f,\"min\":%.2f,\"max\":%.2f,\"settle_ms\":%lu,\"voltage\":%.2f,"
+                   "\"current\":%.2f,\"power\":%.1f,\"g_per_w\":%.3f,\"sps\":%.2f,\"gaps\":%lu,\"target\":%.1f,"
+                   "\"mean_pwm\":%.1f}",
+                   (unsigned)s.step, s.pwm, (unsigned long)s.samples, s.meanThrust, s.stddevThrust, s.minThrust,
+                   s.maxThrust, (unsigned long)s.settleMs, s.meanVoltage, s.meanCurrent, s.meanPower,
+                   s.gramsPerWatt, s.sps, (unsigned long)s.gaps, s.targetThrust, s.meanPwm);
+  return (n > 0 && (size_t)n < outLen) ? (size_t)n : 0;
+}
+
+size_t formatStepSummaryCsvRow(const StepSummary &s, char *out, size_t outLen) {
+  int n = snprintf(out, outLen, "%u,%d,%lu,%.2f,%.3f,%.2f,%.2f,%lu,%.2f,%.2f,%.1f,%.3f,%.2f,%lu,%.1f,%.1f\n",
+                   (unsigned)s.step, s.pwm, (unsigned long)s.samples, s.meanThrust, s.stddevThrust, s.minThrust,
+                   s.maxThrust, (unsigned long)s.settleMs, s.meanVoltage, s.meanCurrent, s.meanPower, s.gramsPerWatt,
+                   s.sps, (unsigned long)s.gaps, s.targetThrust, s.meanPwm);
+  return (n > 0 && (size_t)n < outLen) ? (size_t)n : 0;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Settling: a sample is "in band" when it is within max(STEP_SETTLE_BAND_G,
+// STEP_SETTLE_BAND_PCT of the mean) of the stable-window mean thrust (the last sample when
+// the step has no stable window). The settle time is the step-relative time of the sample
+// after the last out-of-band one, i.e. when thrust entered the band for good.
+static const float STEP_SETTLE_BAND_G = 2.0f;
+static const float STEP_SETTLE_BAND_PCT = 0.02f;
+// Entries kept per settling envelope; see StepStats::SettleEnvelope.
+static const uint8_t STEP_SETTLE_TRACK = 32;
+
+struct StepSummary {
+  uint16_t step;
+  int pwm;
+  uint32_t samples; // stable-window samples behind the thrust figures
+  float meanThrust;
+  float stddevThrust;
+  float minThrust;
+  float maxThrust;
+  uint32_t settleMs; // from step start, including spin-up
+  float meanVoltage; // 0 when no fresh ESC telemetry arrived during the window
+  float meanCurrent;
+  float meanPower;
+  float gramsPerWatt;
+  float sps;     // effective sample rate over the whole step
+  uint32_t gaps; // sampling gaps during the step, see SampleRateStats
+  float targetThrust; // thrust-target steps only, 0 for PWM steps
+  float meanPwm;      // over the stable window; what a thrust-target step converged to
+};
+
+// O(1)-per-sample accumulator for one TestStep. Thrust statistics use Welford's update
+// and only cover the stable window; settling is tracked from the start of the step. For
+// thrust-target steps the summary's pwm is the rounded mean PWM.
+class StepStats {
+ public:
+  void begin(uint16_t step, int pwm, float targetThrust = 0.0f);
+  void add(unsigned long elapsedInStepMs, bool stable, float thrust, bool telemetryValid, float voltage,
+           float current, int pwm);
+  StepSummary summary() const;
+  bool active() const { return active_; }
+  void close() { active_ = false; }
+
+ private:
+  bool active_ = false;
+  uint16_t step_ = 0;
+  int pwm_ = 0;
+  float targetThrust_ = 0.0f;
+  double pwmSum_ = 0.0;
+  uint32_t count_ = 0;
+  double mean_ = 0.0;
+  double m2_ = 0.0;
+  float min_ = 0.0f;
+  float max_ = 0.0f;
+  // The mean is only known at the end, so settling keeps the samples that could still be
+  // the last one out of band: those above (high) or below (low) every later sample. Noise
+  // adds about ln(n) of them, a ramp or overshoot one per sample; when full the oldest is
+  // dropped and its time kept as a lower bound for the settle time.
+  struct SettleEntry {
+    float thrust;
+    uint32_t nextMs; // time of the sample after it
+  };
+  struct SettleEnvelope {
+    SettleEntry entries[STEP_SETTLE_TRACK];
+    uint8_t count;
+  };
+  void trackSettle(SettleEnvelope &env, float thrust, uint32_t elapsedMs, bool high);
+  uint32_t settleMs(float finalThrust) const;
+  SettleEnvelope settleHigh_ = {};
+  SettleEnvelope settleLow_ = {};
+  uint32_t settleFloorMs_ = 0;
+  float lastThrust_ = 0.0f;
+  uint32_t telemCount_ = 0;
+  double voltageSum_ = 0.0;
+  double currentSum_ = 0.0;
+  double powerSum_ = 0.0;
+};
+
+size_t formatStepSummaryJson(const StepSummary &summary, char *out, size_t outLen);
+size_t formatStepSummaryCsvRow(const StepSummary &summary, char *out, size_t outLen);
+extern const char STEP_SUMMARY_CSV_HEADER[];
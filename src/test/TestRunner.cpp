@@ -1,37 +1,105 @@
 #include "TestRunner.h"
 
-#include "FS.h"
-#include "LittleFS.h"
 #include "ArduinoJson.h"
+#include "esc/EscOutput.h"
+#include "hal/Hal.h"
+#include "net/LiveTelemetry.h"
 #include "net/WebSocketUtils.h"
 #include "scale/LoadCellManager.h"
 #include "sim/Simulator.h"
+#include "storage/ResultJournal.h"
+#include "storage/RunHistory.h"
 #include "util/Log.h"
+#include "util/Perf.h"
 #include <Arduino.h>
 
-static const size_t FINAL_RESULTS_CHUNK_SIZE = 100;
-static const char LAST_RESULTS_PATH[] = "/last_test.csv";
+// Worst case per point is {"time":4294967295,"thrust":-99999999.999,"pwm":65535}, (54 chars),
+// plus ,"voltage":-21474836.48,"current":-21474836.48 (46 chars) and ,"rpm":4294967295
+// (17 chars) when the run records them.
+static const size_t FINAL_RESULTS_CHUNK_SIZE = 36;
+static const size_t FINAL_RESULTS_CHANNELS_CHUNK_SIZE = 16;
+static_assert(64 + FINAL_RESULTS_CHUNK_SIZE * 54 <= WS_SCRATCH_SIZE, "final chunk must fit the WS scratch buffer");
+static_assert(64 + FINAL_RESULTS_CHANNELS_CHUNK_SIZE * 117 <= WS_SCRATCH_SIZE,
+              "final chunk with channels must fit the WS scratch buffer");
+static const size_t FINAL_RESULTS_CHUNKS_PER_TICK = 2;
+static const unsigned long FINAL_RESULTS_STALL_TIMEOUT_MS = 5000;
+// Upper bound on queued load-cell samples handled per loop() pass.
+static const size_t MAX_SAMPLES_PER_TICK = 32;
+static const unsigned long SAMPLE_RATE_REPORT_INTERVAL_MS = 1000;
+// Upper bound for "<grams>g" steps; anything above is a typo, not a rig.
+static const float THRUST_TARGET_MAX_G = 50000.0f;
 
-const char *getLastResultsPath() { return LAST_RESULTS_PATH; }
+// Streams every sample recorded since the last call as live_batch messages.
+static void flushLiveBatches(AppState &state, const BoardConfig &cfg, AsyncWebSocket &ws) {
+  const size_t total = state.testResults.size();
+  if (state.liveBatchCursor > total) state.liveBatchCursor = total;
+  DataPoint points[LIVE_BATCH_MAX_SAMPLES];
+  SampleStore::Reader reader = state.testResults.reader(state.liveBatchCursor);
+  while (state.liveBatchCursor < total) {
+    size_t count = 0;
+    while (count < LIVE_BATCH_MAX_SAMPLES && reader.next(points[count])) count++;
+    if (count == 0) break;
+    LiveBatch batch;
+    batch.samples = points;
+    batch.count = count;
+    batch.firstIndex = (uint32_t)state.liveBatchCursor;
+    batch.voltage = state.escVoltage;
+    batch.current = state.escCurrent;
+    batch.escTelemStale = state.escTelemStale;
+    batch.escTelemAgeMs = state.escTelemAgeMs;
+    publishLiveBatch(ws, cfg, state.wifiProvisioningMode, batch);
+    state.liveBatchCursor += count;
+  }
+}
 
-void deleteLastResultsFile() {
-  if (LittleFS.exists(LAST_RESULTS_PATH)) {
-    LittleFS.remove(LAST_RESULTS_PATH);
+// Closes the step in progress, announces it and keeps it for the run's summary file.
+static void completeStepStats(AppState &state, const BoardConfig &cfg, AsyncWebSocket &ws) {
+  if (!state.stepStats.active()) return;
+  StepSummary summary = state.stepStats.summary();
+  const SampleRateSummary rate = state.stepRate.summary();
+  summary.sps = rate.sps;
+  summary.gaps = rate.gaps;
+  state.stepStats.close();
+  state.stepSummaries.push_back(summary);
+  if (wsChannelHasClients(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_STEP_SUMMARY) &&
+      formatStepSummaryJson(summary, wsScratchBuffer(), WS_SCRATCH_SIZE) > 0) {
+    notifyChannel(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_STEP_SUMMARY, wsScratchBuffer());
   }
 }
 
-static void saveResultsCsv(const std::vector<DataPoint> &results) {
-  File file = LittleFS.open(LAST_RESULTS_PATH, "w");
+static void saveStepSummaries(AppState &state) {
+  PERF_SCOPE(FS_WRITE);
+  state.stepSummariesPending = false;
+  const uint32_t runId = getResultJournalStats().runId;
+  char path[RUN_PATH_LEN];
+  if (runId == 0 || state.stepSummaries.empty() || !runHistoryStepsPath(runId, path, sizeof(path))) return;
+  File file = halFs().open(path, "w");
   if (!file) {
-    logWarn("Failed to open %s for writing", LAST_RESULTS_PATH);
+    logWarn("Failed to open %s for writing", path);
     return;
   }
-  file.println("timestamp_ms,thrust_g,pwm_us");
-  for (const auto &point : results) {
-    file.printf("%lu,%.3f,%d\n", point.timestamp, point.thrust, point.pwm);
+  file.println(STEP_SUMMARY_CSV_HEADER);
+  char row[192];
+  for (const StepSummary &summary : state.stepSummaries) {
+    if (formatStepSummaryCsvRow(summary, row, sizeof(row)) > 0) file.print(row);
   }
   file.close();
-  logInfo("Saved %u results to %s", (unsigned)results.size(), LAST_RESULTS_PATH);
+}
+
+static bool allocateResultStore(AppState &state, const BoardConfig &cfg, uint8_t channels) {
+  size_t maxSamples = cfg.max_test_samples;
+  while (!state.testResults.begin(maxSamples, maxSamples * SAMPLE_STORE_BYTES_PER_SAMPLE, channels)) {
+    maxSamples /= 2;
+    if (maxSamples < 100) {
+      logError("Failed to allocate result buffer");
+      return false;
+    }
+  }
+  if (maxSamples < cfg.max_test_samples) {
+    logWarn("Result buffer reduced to %u samples (free heap %u bytes)", (unsigned)maxSamples,
+            (unsigned)halFreeHeap());
+  }
+  return true;
 }
 
 void setEscThrottlePwm(AppState &state, const BoardConfig &cfg, bool simEnabled, int pulse_width_us) {
@@ -41,10 +109,7 @@ void setEscThrottlePwm(AppState &state, const BoardConfig &cfg, bool simEnabled,
   state.currentPwm = pulse_width_us;
 
   if (!simEnabled) {
-    const uint32_t maxDuty = (1UL << cfg.pwm_resolution) - 1UL;
-    const uint32_t periodUs = (cfg.pwm_freq > 0) ? (1000000UL / (uint32_t)cfg.pwm_freq) : 20000UL;
-    uint32_t duty = (maxDuty * (uint32_t)pulse_width_us) / periodUs;
-    ledcWrite(cfg.esc_pwm_channel, duty);
+    writeEscOutput(pulse_width_us);
   }
 }
 
@@ -52,6 +117,9 @@ void triggerSafetyShutdown(AppState &state, const BoardConfig &cfg, bool simEnab
   setEscThrottlePwm(state, cfg, simEnabled, cfg.min_pulse_width);
   state.currentState = State::SAFETY_SHUTDOWN;
   Serial.printf("SAFETY SHUTDOWN TRIGGERED: %s\n", reason);
+  // Keep whatever was recorded; the journal is closed as aborted on the next tick.
+  setResultJournalSampleRate(state.runRate.summary());
+  endResultJournal(true);
 
   StaticJsonDocument<200> doc;
   doc["type"] = "safety_shutdown";
@@ -70,7 +138,21 @@ void finishTest(AppState &state, const BoardConfig &cfg, bool simEnabled, AsyncW
   state.currentState = State::TEST_FINISHED;
   Serial.println("Test sequence finished.");
 
-  saveResultsCsv(state.testResults);
+  if (hasWsClients(ws)) {
+    flushLiveBatches(state, cfg, ws);
+  }
+  setResultJournalSampleRate(state.runRate.summary());
+  endResultJournal(false);
+  tickResultJournal();
+
+  if (!simEnabled) {
+    LoadCellSamplerStats sampler = getLoadCellSamplerStats();
+    logInfo("Load cell sampler: %u samples, %u dropped, %u polled, max latency %u us",
+            (unsigned)sampler.samples,
+            (unsigned)sampler.dropped,
+            (unsigned)sampler.polled,
+            (unsigned)sampler.maxLatencyUs);
+  }
 
   StaticJsonDocument<200> doc;
   doc["type"] = "status";
@@ -79,71 +161,146 @@ void finishTest(AppState &state, const BoardConfig &cfg, bool simEnabled, AsyncW
     char output[256];
     size_t outLen = serializeJson(doc, output, sizeof(output));
     if (outLen > 0) {
-      notifyClients(ws, cfg, state.wifiProvisioningMode, output);
+      notifyChannel(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_LOGS, output);
     }
   }
 
-  const size_t totalPoints = state.testResults.size();
-  if (hasWsClients(ws)) {
-    StaticJsonDocument<128> startDoc;
-    startDoc["type"] = "final_results_start";
-    startDoc["total"] = (uint32_t)totalPoints;
-    char startOut[192];
-    size_t startLen = serializeJson(startDoc, startOut, sizeof(startOut));
-    if (startLen > 0) {
-      notifyClients(ws, cfg, state.wifiProvisioningMode, startOut);
-    }
+  if (!wsChannelHasClients(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_RESULTS)) {
+    state.testResults.release();
+    state.currentState = State::IDLE;
+    return;
   }
 
-  if (hasWsClients(ws)) {
-    static char chunkOut[9000];
-    static DynamicJsonDocument chunkDoc(8192);
-    for (size_t i = 0; i < totalPoints; i += FINAL_RESULTS_CHUNK_SIZE) {
-      chunkDoc.clear();
-      chunkDoc["type"] = "final_results_chunk";
-      chunkDoc["index"] = (uint32_t)i;
-      JsonArray data = chunkDoc.createNestedArray("data");
-      size_t end = i + FINAL_RESULTS_CHUNK_SIZE;
-      if (end > totalPoints) end = totalPoints;
-      for (size_t j = i; j < end; j++) {
-        JsonObject dataPoint = data.createNestedObject();
-        dataPoint["time"] = state.testResults[j].timestamp;
-        dataPoint["thrust"] = state.testResults[j].thrust;
-        dataPoint["pwm"] = state.testResults[j].pwm;
-      }
-      size_t chunkLen = serializeJson(chunkDoc, chunkOut, sizeof(chunkOut));
-      if (chunkLen > 0) {
-        notifyClients(ws, cfg, state.wifiProvisioningMode, chunkOut);
-      } else {
-        logWarn("Chunk JSON buffer too small; skipping chunk %u", (unsigned)i);
-      }
-    }
+  // The RAM store may only hold the head of a long run; advertising the journal's count
+  // makes the UI fall back to /api/results/latest for the full data set.
+  uint32_t totalPoints = (uint32_t)state.testResults.size();
+  if (resultJournalSampleCount() > totalPoints) totalPoints = resultJournalSampleCount();
+
+  StaticJsonDocument<128> startDoc;
+  startDoc["type"] = "final_results_start";
+  startDoc["total"] = totalPoints;
+  char startOut[192];
+  size_t startLen = serializeJson(startDoc, startOut, sizeof(startOut));
+  if (startLen > 0) {
+    notifyChannel(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_RESULTS, startOut);
   }
 
+  // The chunks themselves go out from tickTestRunner() so loop() keeps running.
+  state.finalizeCursor = 0;
+  state.finalizeProgressMs = halMillis();
+  state.currentState = State::FINALIZING;
+}
+
+static void endFinalResults(AppState &state, const BoardConfig &cfg, AsyncWebSocket &ws) {
   if (hasWsClients(ws)) {
     StaticJsonDocument<128> endDoc;
     endDoc["type"] = "final_results_end";
     char endOut[192];
     size_t endLen = serializeJson(endDoc, endOut, sizeof(endOut));
     if (endLen > 0) {
-      notifyClients(ws, cfg, state.wifiProvisioningMode, endOut);
+      notifyChannel(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_RESULTS, endOut);
     }
   }
-
-  state.testResults.clear();
+  state.testResults.release();
+  state.finalizeCursor = 0;
   state.currentState = State::IDLE;
 }
 
+static size_t encodeFinalResultsChunk(const SampleStore &results, size_t start, size_t count, char *out,
+                                      size_t outLen) {
+  PERF_SCOPE(JSON_ENCODE);
+  int n = snprintf(out, outLen, "{\"type\":\"final_results_chunk\",\"index\":%u,\"data\":[", (unsigned)start);
+  if (n < 0 || (size_t)n >= outLen) return 0;
+  size_t pos = (size_t)n;
+  const bool electrical = results.channels() & SAMPLE_CHANNEL_ELECTRICAL;
+  const bool rpm = results.channels() & SAMPLE_CHANNEL_RPM;
+  SampleStore::Reader reader = results.reader(start);
+  DataPoint point;
+  for (size_t i = 0; i < count && reader.next(point); i++) {
+    n = snprintf(out + pos, outLen - pos, "%s{\"time\":%lu,\"thrust\":%.3f,\"pwm\":%d", i == 0 ? "" : ",",
+                 point.timestamp, point.thrust, point.pwm);
+    if (n < 0 || (size_t)n >= outLen - pos) return 0;
+    pos += (size_t)n;
+    if (electrical) {
+      n = snprintf(out + pos, outLen - pos, ",\"voltage\":%.2f,\"current\":%.2f", point.voltage, point.current);
+      if (n < 0 || (size_t)n >= outLen - pos) return 0;
+      pos += (size_t)n;
+    }
+    n = rpm ? snprintf(out + pos, outLen - pos, ",\"rpm\":%lu}", (unsigned long)point.rpm)
+            : snprintf(out + pos, outLen - pos, "}");
+    if (n < 0 || (size_t)n >= outLen - pos) return 0;
+    pos += (size_t)n;
+  }
+  if (outLen - pos < 3) return 0;
+  out[pos++] = ']';
+  out[pos++] = '}';
+  out[pos] = '\0';
+  return pos;
+}
+
+static void tickFinalResults(AppState &state, const BoardConfig &cfg, AsyncWebSocket &ws) {
+  const size_t totalPoints = state.testResults.size();
+  if (!wsChannelHasClients(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_RESULTS)) {
+    endFinalResults(state, cfg, ws);
+    return;
+  }
+  if (state.finalizeCursor >= totalPoints) {
+    // final_results_end may trigger a fetch of /api/results/latest; the journal must be closed first.
+    if (!resultJournalBusy() || halMillis() - state.finalizeProgressMs >= FINAL_RESULTS_STALL_TIMEOUT_MS) {
+      endFinalResults(state, cfg, ws);
+    }
+    return;
+  }
+  for (size_t sent = 0; sent < FINAL_RESULTS_CHUNKS_PER_TICK && state.finalizeCursor < totalPoints; sent++) {
+    // Never overrun a client's send queue: wait for it to drain instead of having chunks dropped.
+    if (!wsClientsCanQueue(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_RESULTS)) {
+      if (halMillis() - state.finalizeProgressMs >= FINAL_RESULTS_STALL_TIMEOUT_MS) {
+        logWarn("Final results stalled at %u/%u points; ending transfer", (unsigned)state.finalizeCursor,
+                (unsigned)totalPoints);
+        endFinalResults(state, cfg, ws);
+      }
+      return;
+    }
+    const size_t chunkSize = state.testResults.channels()
+                                 ? FINAL_RESULTS_CHANNELS_CHUNK_SIZE
+                                 : FINAL_RESULTS_CHUNK_SIZE;
+    size_t count = totalPoints - state.finalizeCursor;
+    if (count > chunkSize) count = chunkSize;
+    size_t chunkLen = encodeFinalResultsChunk(state.testResults, state.finalizeCursor, count, wsScratchBuffer(),
+                                              WS_SCRATCH_SIZE);
+    if (chunkLen > 0) {
+      notifyChannel(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_RESULTS, wsScratchBuffer());
+    } else {
+      logWarn("Chunk JSON buffer too small; skipping chunk %u", (unsigned)state.finalizeCursor);
+    }
+    state.finalizeCursor += count;
+    state.finalizeProgressMs = halMillis();
+  }
+}
+
 bool parseAndStoreSequence(AppState &state, const BoardConfig &cfg, const char *sequenceStr) {
   if (!sequenceStr) return false;
   state.testSequence.clear();
+  state.testSequenceText = sequenceStr;
   char *sequenceCopy = strdup(sequenceStr);
   char *stepToken = strtok(sequenceCopy, ";");
 
   while (stepToken != NULL) {
-    TestStep step;
+    TestStep step = {};
     int pwm, spinup, stable;
-    if (sscanf(stepToken, "%d - %d - %d", &pwm, &spinup, &stable) == 3) {
+    float grams;
+    char unit;
+    if (sscanf(stepToken, " %f %c - %d - %d", &grams, &unit, &spinup, &stable) == 4 && (unit == 'g' || unit == 'G')) {
+      if (!(grams > 0.0f && grams <= THRUST_TARGET_MAX_G) || spinup < 0 || stable < 0) {
+        Serial.printf("Invalid thrust target step: %s\n", stepToken);
+        free(sequenceCopy);
+        return false;
+      }
+      step.thrustTarget = grams;
+      step.spinup_ms = (unsigned long)spinup * 1000UL;
+      step.stable_ms = (unsigned long)stable * 1000UL;
+      state.testSequence.push_back(step);
+    } else if (sscanf(stepToken, "%d - %d - %d", &pwm, &spinup, &stable) == 3) {
       if (pwm < cfg.min_pulse_width || pwm > cfg.max_pulse_width) {
         Serial.printf("Invalid PWM in step: %s\n", stepToken);
         free(sequenceCopy);
@@ -169,11 +326,22 @@ bool parseAndStoreSequence(AppState &state, const BoardConfig &cfg, const char *
   return !state.testSequence.empty();
 }
 
+bool testHoldsConfig(State state) {
+  switch (state) {
+    case State::ARMING:
+    case State::PRE_TEST_TARE:
+    case State::RUNNING_SEQUENCE:
+    case State::FINALIZING:
+      return true;
+    default:
+      return false;
+  }
+}
+
 void resetTest(AppState &state) {
   state.currentState = State::IDLE;
-  state.testResults.clear();
+  state.testResults.release();
   state.testSequence.clear();
-  deleteLastResultsFile();
   state.lastThrustForSafetyCheck = 0.0f;
   state.lastSafetyCheckTime = 0;
   state.lastSimSampleMs = 0;
@@ -182,53 +350,211 @@ void resetTest(AppState &state) {
 
 void startPreTestTare(AppState &state, const BoardConfig &cfg) {
   state.currentState = State::PRE_TEST_TARE;
-  state.stepStartTime = millis();
+  state.stepStartTime = halMillis();
   state.preTestSettling = false;
   state.preTestSettleStart = 0;
   (void)cfg;
 }
 
+// Starts statistics, and the PID for a thrust-target step, for state.currentSequenceStep.
+static void beginStepControl(AppState &state) {
+  const TestStep &step = state.testSequence[state.currentSequenceStep];
+  state.stepStats.begin((uint16_t)state.currentSequenceStep, step.pwm, step.thrustTarget);
+  if (step.thrustTarget > 0.0f) state.thrustPid.begin((float)state.currentPwm);
+}
+
+// One PID update per load cell sample while a thrust-target step is running. Samples taken
+// before the step started (still the previous step's thrust) are skipped. A target the
+// motor cannot reach pins the PWM at MAX_PULSE_WIDTH; after THRUST_PID_MAX_HOLD_MS of that
+// the run is stopped with a safety shutdown and false is returned.
+static bool updateThrustControl(AppState &state,
+                                const BoardConfig &cfg,
+                                bool simEnabled,
+                                AsyncWebSocket &ws,
+                                const ThrustSample &sample) {
+  if (state.currentState != State::RUNNING_SEQUENCE) return true;
+  if (state.currentSequenceStep >= (int)state.testSequence.size()) return true;
+  const TestStep &step = state.testSequence[state.currentSequenceStep];
+  if (step.thrustTarget <= 0.0f) return true;
+  if ((long)(sample.timestampMs - state.stepStartTime) < 0) return true;
+  const ThrustPidGains gains = {cfg.thrust_pid_kp, cfg.thrust_pid_ki,   cfg.thrust_pid_kd,
+                                cfg.thrust_pid_slew, cfg.min_pulse_width, cfg.max_pulse_width};
+  const float pwm = state.thrustPid.update(gains, step.thrustTarget, sample.thrust, sample.timestampUs);
+  if (cfg.thrust_pid_max_hold_ms > 0 && state.thrustPid.atMaxUs() >= (uint64_t)cfg.thrust_pid_max_hold_ms * 1000ULL) {
+    triggerSafetyShutdown(state, cfg, simEnabled, ws, "Thrust target not reached at maximum PWM.");
+    return false;
+  }
+  setEscThrottlePwm(state, cfg, simEnabled, (int)lroundf(pwm));
+  return true;
+}
+
+static void handleRunningSample(AppState &state,
+                                const BoardConfig &cfg,
+                                bool simEnabled,
+                                AsyncWebSocket &ws,
+                                const TestStep &step,
+                                unsigned long elapsedInStep,
+                                const ThrustSample &sample) {
+  // Conversions captured before the run started (e.g. during pre-test tare) are not part of it.
+  if (sample.timestampUs < state.testStartUs) return;
+
+  const float currentThrust = sample.thrust;
+  const uint64_t relativeUs = sample.timestampUs - state.testStartUs;
+  const unsigned long currentTime = (unsigned long)(relativeUs / 1000);
+  const bool simSamplingReady = !simEnabled || (halMillis() - state.lastSimSampleMs >= TELEMETRY_INTERVAL_MS);
+  if (simEnabled && simSamplingReady) {
+    state.lastSimSampleMs = halMillis();
+  }
+
+  if (state.escTelemStale && hasWsClients(ws)) {
+    const unsigned long now = halMillis();
+    if (state.lastEscTelemWarningMs == 0 || (now - state.lastEscTelemWarningMs) > 2000) {
+      state.lastEscTelemWarningMs = now;
+      notifyChannel(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_LOGS,
+                    "{\"type\":\"warning\",\"message\":\"ESC telemetry lost during test\"}");
+    }
+  } else {
+    state.lastEscTelemWarningMs = 0;
+  }
+
+  if (!simEnabled || simSamplingReady) {
+    // Stale telemetry is recorded as 0 V / 0 A / 0 RPM rather than the last value seen.
+    const bool electricalValid = (state.testResults.channels() & SAMPLE_CHANNEL_ELECTRICAL) && !state.escTelemStale;
+    const bool rpmValid = (state.testResults.channels() & SAMPLE_CHANNEL_RPM) && !state.escRpmStale;
+    const DataPoint point = {currentTime,
+                             currentThrust,
+                             state.currentPwm,
+                             (uint16_t)(relativeUs % 1000),
+                             electricalValid ? state.escVoltage : 0.0f,
+                             electricalValid ? state.escCurrent : 0.0f,
+                             rpmValid ? state.escRpm : 0};
+    state.runRate.add((uint32_t)sample.timestampUs);
+    state.stepRate.add((uint32_t)sample.timestampUs);
+    // The journal keeps the full run; RAM only holds what fits for live/final streaming.
+    appendResultJournal(point);
+    const long stepElapsed = (long)(sample.timestampMs - state.stepStartTime);
+    if (stepElapsed >= 0) {
+      const bool telemetryValid = !state.escTelemStale && state.escVoltage > 0.0f;
+      state.stepStats.add((unsigned long)stepElapsed, (unsigned long)stepElapsed >= step.spinup_ms, currentThrust,
+                          telemetryValid, state.escVoltage, state.escCurrent, state.currentPwm);
+    }
+    if (!state.testResults.push(point) && !state.testResultsFullLogged) {
+      logWarn("Result buffer full; remaining samples are journaled to flash only");
+      state.testResultsFullLogged = true;
+    }
+  }
+
+  const bool liveListeners = wsChannelHasClients(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_LIVE_DATA);
+  if (liveListeners && halMillis() - state.lastSampleRateReportMs >= SAMPLE_RATE_REPORT_INTERVAL_MS) {
+    state.lastSampleRateReportMs = halMillis();
+    if (formatSampleRateJson(state.runRate.summary(), state.stepRate.summary(), wsScratchBuffer(), WS_SCRATCH_SIZE) >
+        0) {
+      notifyChannel(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_LIVE_DATA, wsScratchBuffer());
+    }
+  }
+
+  if (!liveListeners) {
+    state.liveBatchCursor = state.testResults.size();
+  } else if (halMillis() - state.lastTelemetryMs >= cfg.telemetry_interval_ms && (!simEnabled || simSamplingReady)) {
+    state.lastTelemetryMs = halMillis();
+    if (state.liveBatchCursor < state.testResults.size()) {
+      flushLiveBatches(state, cfg, ws);
+    } else {
+      // Nothing new recorded (e.g. sample buffer full): keep the live view moving.
+      LiveDataFrame frame;
+      frame.timeMs = currentTime;
+      frame.thrust = currentThrust;
+      frame.pwm = state.currentPwm;
+      frame.voltage = state.escVoltage;
+      frame.current = state.escCurrent;
+      frame.escTelemStale = state.escTelemStale;
+      frame.escTelemAgeMs = state.escTelemAgeMs;
+      publishLiveData(ws, cfg, state.wifiProvisioningMode, frame);
+    }
+  }
+
+  if (!updateThrustControl(state, cfg, simEnabled, ws, sample)) return;
+
+  if (halMillis() - state.lastSafetyCheckTime > cfg.safety_check_interval) {
+    if (state.lastSafetyCheckTime != 0) {
+      perfRecordUs(PerfStage::SAFETY_CHECK_GAP, (uint32_t)(halMillis() - state.lastSafetyCheckTime) * 1000UL);
+    }
+    bool isStablePhase = (elapsedInStep > step.spinup_ms);
+    if (state.currentPwm > cfg.safety_pwm_threshold && isStablePhase) {
+      if ((state.lastThrustForSafetyCheck - currentThrust) > cfg.abnormal_thrust_drop) {
+        triggerSafetyShutdown(state, cfg, simEnabled, ws, "Abnormal thrust drop detected!");
+      }
+    }
+    state.lastThrustForSafetyCheck = currentThrust;
+    state.lastSafetyCheckTime = halMillis();
+  }
+}
+
 void tickTestRunner(AppState &state, const BoardConfig &cfg, bool simEnabled, HX711_ADC *loadCell, AsyncWebSocket &ws) {
+  tickResultJournal();
+  // Completion or shutdown: the (possibly partial) last step still gets a summary.
+  if (state.stepSummariesPending && state.currentState != State::RUNNING_SEQUENCE) {
+    completeStepStats(state, cfg, ws);
+    saveStepSummaries(state);
+  }
   switch (state.currentState) {
     case State::ARMING: {
       if (state.armingStartTime == 0) {
         Serial.println("Arming ESC... Sending min throttle.");
         setEscThrottlePwm(state, cfg, simEnabled, cfg.min_pulse_width);
-        state.armingStartTime = millis();
-      } else if (millis() - state.armingStartTime >= cfg.esc_arming_delay_ms) {
-        notifyClients(ws, cfg, state.wifiProvisioningMode, "{\"type\":\"status\", \"message\":\"ESC Armed. Ready.\"}");
+        state.armingStartTime = halMillis();
+      } else if (halMillis() - state.armingStartTime >= cfg.esc_arming_delay_ms) {
+        notifyChannel(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_LOGS,
+                      "{\"type\":\"status\", \"message\":\"ESC Armed. Ready.\"}");
         state.currentState = State::IDLE;
         state.armingStartTime = 0;
       }
       break;
     }
     case State::PRE_TEST_TARE: {
-      if (millis() - state.stepStartTime < cfg.pre_test_tare_spinup_ms) {
+      if (halMillis() - state.stepStartTime < cfg.pre_test_tare_spinup_ms) {
         setEscThrottlePwm(state, cfg, simEnabled, cfg.pre_test_tare_pwm);
       } else {
         if (!state.preTestSettling) {
           setEscThrottlePwm(state, cfg, simEnabled, cfg.min_pulse_width);
           state.preTestSettling = true;
-          state.preTestSettleStart = millis();
-        } else if (millis() - state.preTestSettleStart >= cfg.pre_test_tare_settle_ms) {
+          state.preTestSettleStart = halMillis();
+        } else if (halMillis() - state.preTestSettleStart >= cfg.pre_test_tare_settle_ms) {
           tareScale(simEnabled, loadCell, state);
           Serial.println("Pre-test tare complete.");
-          notifyClients(ws, cfg, state.wifiProvisioningMode, "{\"type\":\"status\", \"message\":\"Pre-test tare complete. Starting sequence.\"}");
+          // Voltage/current and RPM are only recorded when the ESC is reporting them as the run starts.
+          const uint8_t channels = (state.escTelemStale ? 0 : SAMPLE_CHANNEL_ELECTRICAL) |
+                                   (state.escRpmStale ? 0 : SAMPLE_CHANNEL_RPM);
+          if (!allocateResultStore(state, cfg, channels)) {
+            triggerSafetyShutdown(state, cfg, simEnabled, ws, "Not enough memory for the result buffer.");
+            break;
+          }
+          notifyChannel(ws, cfg, state.wifiProvisioningMode, WS_CHANNEL_LOGS,
+                        "{\"type\":\"status\", \"message\":\"Pre-test tare complete. Starting sequence.\"}");
 
           state.currentState = State::RUNNING_SEQUENCE;
           state.currentSequenceStep = 0;
-          state.testStartTime = millis();
-          state.stepStartTime = millis();
+          state.testStartUs = halMicros64();
+          state.testStartTime = (unsigned long)(state.testStartUs / 1000);
+          state.stepStartTime = halMillis();
           state.previousPwmForRamp = cfg.min_pulse_width;
-          state.testResults.clear();
-          state.testResults.reserve(cfg.max_test_samples);
+          beginResultJournal(state.testStartEpoch, state.testStartTime, (uint16_t)state.testSequence.size(),
+                             state.testSequenceText.c_str(), channels);
           state.testResultsFullLogged = false;
+          state.liveBatchCursor = 0;
           state.lastThrustForSafetyCheck = 0.0f;
           state.lastSafetyCheckTime = 0;
           state.lastSimSampleMs = 0;
           state.lastSimUpdateMs = 0;
           state.preTestSettling = false;
           state.preTestSettleStart = 0;
+          resetLoadCellSamplerStats();
+          state.stepSummaries.clear();
+          state.stepSummariesPending = true;
+          beginStepControl(state);
+          state.runRate.begin(cfg.sample_gap_ms * 1000UL);
+          state.stepRate.begin(cfg.sample_gap_ms * 1000UL);
+          state.lastSampleRateReportMs = halMillis();
         }
       }
       break;
@@ -240,85 +566,48 @@ void tickTestRunner(AppState &state, const BoardConfig &cfg, bool simEnabled, HX
       }
 
       TestStep &step = state.testSequence[state.currentSequenceStep];
-      unsigned long elapsedInStep = millis() - state.stepStartTime;
+      unsigned long elapsedInStep = halMillis() - state.stepStartTime;
 
-      if (step.spinup_ms == 0) {
-        setEscThrottlePwm(state, cfg, simEnabled, step.pwm);
-      } else if (elapsedInStep < step.spinup_ms) {
-        int new_pwm = map(elapsedInStep, 0, step.spinup_ms, state.previousPwmForRamp, step.pwm);
-        setEscThrottlePwm(state, cfg, simEnabled, new_pwm);
+      // A step without spin-up goes straight to its stable phase. Thrust-target steps set
+      // their PWM per sample in updateThrustControl().
+      const bool thrustStep = step.thrustTarget > 0.0f;
+      if (elapsedInStep < step.spinup_ms) {
+        if (!thrustStep) {
+          int new_pwm = map(elapsedInStep, 0, step.spinup_ms, state.previousPwmForRamp, step.pwm);
+          setEscThrottlePwm(state, cfg, simEnabled, new_pwm);
+        }
       } else if (elapsedInStep < (step.spinup_ms + step.stable_ms)) {
-        setEscThrottlePwm(state, cfg, simEnabled, step.pwm);
+        if (!thrustStep) setEscThrottlePwm(state, cfg, simEnabled, step.pwm);
       } else {
-        state.previousPwmForRamp = step.pwm;
+        completeStepStats(state, cfg, ws);
+        // The next step ramps from wherever a thrust-target step converged.
+        state.previousPwmForRamp = thrustStep ? state.currentPwm : step.pwm;
         state.currentSequenceStep++;
-        state.stepStartTime = millis();
+        state.stepStartTime = halMillis();
+        if (state.currentSequenceStep < (int)state.testSequence.size()) {
+          beginStepControl(state);
+          state.stepRate.begin(cfg.sample_gap_ms * 1000UL);
+        }
       }
 
       if (simEnabled) {
         updateSimTelemetry(state, cfg);
       }
 
-      float currentThrust = 0.0f;
-      const bool simSamplingReady = !simEnabled || (millis() - state.lastSimSampleMs >= TELEMETRY_INTERVAL_MS);
-      if (readThrust(simEnabled, loadCell, state, &currentThrust)) {
-        unsigned long currentTime = millis() - state.testStartTime;
-        if (simEnabled && simSamplingReady) {
-          state.lastSimSampleMs = millis();
-        }
-
-        if (state.escTelemStale && hasWsClients(ws)) {
-          const unsigned long now = millis();
-          if (state.lastEscTelemWarningMs == 0 || (now - state.lastEscTelemWarningMs) > 2000) {
-            state.lastEscTelemWarningMs = now;
-            notifyClients(ws, cfg, state.wifiProvisioningMode,
-                          "{\"type\":\"warning\",\"message\":\"ESC telemetry lost during test\"}");
-          }
-        } else {
-          state.lastEscTelemWarningMs = 0;
-        }
-
-        if (!simEnabled || simSamplingReady) {
-          if (state.testResults.size() < cfg.max_test_samples) {
-            state.testResults.push_back({currentTime, currentThrust, state.currentPwm});
-          } else if (!state.testResultsFullLogged) {
-            logWarn("Memory limit reached for test results!");
-            state.testResultsFullLogged = true;
-          }
-        }
-
-        if (hasWsClients(ws) && millis() - state.lastTelemetryMs >= TELEMETRY_INTERVAL_MS &&
-            (!simEnabled || simSamplingReady)) {
-          state.lastTelemetryMs = millis();
-          StaticJsonDocument<200> doc;
-          doc["type"] = "live_data";
-          doc["time"] = currentTime;
-          doc["thrust"] = currentThrust;
-          doc["pwm"] = state.currentPwm;
-          doc["voltage"] = state.escVoltage;
-          doc["current"] = state.escCurrent;
-          doc["esc_telem_stale"] = state.escTelemStale;
-          doc["esc_telem_age_ms"] = state.escTelemAgeMs;
-          char output[256];
-          size_t outLen = serializeJson(doc, output, sizeof(output));
-          if (outLen > 0) {
-            notifyClients(ws, cfg, state.wifiProvisioningMode, output);
-          }
-        }
-
-        if (millis() - state.lastSafetyCheckTime > cfg.safety_check_interval) {
-          bool isStablePhase = (elapsedInStep > step.spinup_ms);
-          if (state.currentPwm > cfg.safety_pwm_threshold && isStablePhase) {
-            if ((state.lastThrustForSafetyCheck - currentThrust) > cfg.abnormal_thrust_drop) {
-              triggerSafetyShutdown(state, cfg, simEnabled, ws, "Abnormal thrust drop detected!");
-            }
-          }
-          state.lastThrustForSafetyCheck = currentThrust;
-          state.lastSafetyCheckTime = millis();
-        }
+      ThrustSample sample;
+      size_t drained = 0;
+      while (drained < MAX_SAMPLES_PER_TICK && state.currentState == State::RUNNING_SEQUENCE &&
+             readThrustSample(simEnabled, state, &sample)) {
+        drained++;
+        handleRunningSample(state, cfg, simEnabled, ws, step, elapsedInStep, sample);
+        if (simEnabled) break;
       }
       break;
     }
+    case State::FINALIZING: {
+      tickFinalResults(state, cfg, ws);
+      break;
+    }
     case State::IDLE:
     case State::SAFETY_SHUTDOWN:
     case State::TEST_FINISHED:
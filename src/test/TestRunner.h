@@ -11,7 +11,7 @@ void triggerSafetyShutdown(AppState &state, const BoardConfig &cfg, bool simEnab
 void finishTest(AppState &state, const BoardConfig &cfg, bool simEnabled, AsyncWebSocket &ws);
 bool parseAndStoreSequence(AppState &state, const BoardConfig &cfg, const char *sequenceStr);
 void resetTest(AppState &state);
+// True from arming until the results are sent; live config changes wait for the run to end.
+bool testHoldsConfig(State state);
 void startPreTestTare(AppState &state, const BoardConfig &cfg);
 void tickTestRunner(AppState &state, const BoardConfig &cfg, bool simEnabled, HX711_ADC *loadCell, AsyncWebSocket &ws);
-void deleteLastResultsFile();
-const char *getLastResultsPath();
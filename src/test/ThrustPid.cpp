@@ -0,0 +1,49 @@
+#include "ThrustPid.h"
+
+static float clampf(float v, float lo, float hi) {
+  if (v < lo) return lo;
+  if (v > hi) return hi;
+  return v;
+}
+
+void ThrustPid::begin(float startPwm) {
+  *this = ThrustPid();
+  integral_ = startPwm;
+  output_ = startPwm;
+}
+
+float ThrustPid::update(const ThrustPidGains &gains, float target, float measured, uint64_t sampleUs) {
+  if (!primed_) {
+    primed_ = true;
+    lastUs_ = sampleUs;
+    lastMeasured_ = measured;
+    return output_;
+  }
+  if (sampleUs <= lastUs_) return output_;
+  float dt = (float)(sampleUs - lastUs_) / 1e6f;
+  if (dt > THRUST_PID_MAX_DT_S) dt = THRUST_PID_MAX_DT_S;
+  lastUs_ = sampleUs;
+
+  const float error = target - measured;
+  const float derivative = -(measured - lastMeasured_) / dt;
+  lastMeasured_ = measured;
+
+  const float integral = integral_ + gains.ki * error * dt;
+  const float unlimited = integral + gains.kp * error + gains.kd * derivative;
+  float limited = clampf(unlimited, (float)gains.minPwm, (float)gains.maxPwm);
+  if (gains.slewUsPerS > 0.0f) {
+    const float maxStep = gains.slewUsPerS * dt;
+    limited = clampf(limited, output_ - maxStep, output_ + maxStep);
+  }
+  const bool heldHigh = unlimited > limited && error > 0.0f;
+  const bool heldLow = unlimited < limited && error < 0.0f;
+  if (!heldHigh && !heldLow) integral_ = clampf(integral, (float)gains.minPwm, (float)gains.maxPwm);
+  output_ = limited;
+  if (output_ < (float)gains.maxPwm) {
+    atMax_ = false;
+  } else if (!atMax_) {
+    atMax_ = true;
+    atMaxSinceUs_ = sampleUs;
+  }
+  return output_;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+// Sample gaps longer than this are treated as this long, so a stalled load cell cannot
+// dump seconds of error into the integral in one update.
+static const float THRUST_PID_MAX_DT_S = 0.5f;
+
+struct ThrustPidGains {
+  float kp;         // us per g of error
+  float ki;         // us per g*s
+  float kd;         // us per g/s, on the measured thrust so target changes do not kick
+  float slewUsPerS; // largest PWM change per second, 0 = unlimited
+  int minPwm;
+  int maxPwm;
+};
+
+// PID for thrust-target steps, producing a PWM. One update per load cell sample, timed by
+// the samples' own timestamps rather than loop() passes, so the loop behaves the same at
+// 10 or 80 SPS and replays identically in the simulator. The integral holds the PWM bias
+// and starts at the step's starting PWM; it is not advanced while the output is held at
+// a PWM or slew limit in the direction the error pushes (conditional integration).
+class ThrustPid {
+ public:
+  void begin(float startPwm);
+  // Returns the PWM to apply from now on. The first sample only seeds the timing.
+  float update(const ThrustPidGains &gains, float target, float measured, uint64_t sampleUs);
+  float output() const { return output_; }
+  // How long, in sample time, the output has been held at maxPwm; 0 when below it.
+  uint64_t atMaxUs() const { return atMax_ ? lastUs_ - atMaxSinceUs_ : 0; }
+
+ private:
+  bool primed_ = false;
+  uint64_t lastUs_ = 0;
+  float lastMeasured_ = 0.0f;
+  float integral_ = 0.0f;
+  float output_ = 0.0f;
+  bool atMax_ = false;
+  uint64_t atMaxSinceUs_ = 0;
+};
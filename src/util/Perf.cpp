@@ -0,0 +1,69 @@
+#include "Perf.h"
+
+#include "hal/Hal.h"
+#include <string.h>
+
+static const size_t STAGE_COUNT = (size_t)PerfStage::COUNT;
+
+static const char *const STAGE_NAMES[STAGE_COUNT] = {
+    "loop", "esc_telemetry", "wifi_provisioning", "live_telemetry", "test_runner",
+    "json_encode", "ws_send", "fs_write", "safety_check_gap",
+};
+
+static PerfStageStats s_stats[STAGE_COUNT];
+static unsigned long s_resetMs = 0;
+
+static size_t histogramBucket(uint32_t us) {
+  if (us == 0) return 0;
+  const size_t bucket = 32 - __builtin_clz(us);
+  return bucket < PERF_HISTOGRAM_BUCKETS ? bucket : PERF_HISTOGRAM_BUCKETS - 1;
+}
+
+const char *perfStageName(PerfStage stage) {
+  const size_t index = (size_t)stage;
+  return index < STAGE_COUNT ? STAGE_NAMES[index] : "unknown";
+}
+
+uint32_t perfNow() { return halCycleCount(); }
+
+void perfEnd(PerfStage stage, uint32_t startCycles) {
+#if ENABLE_PERF_STATS
+  // Wraps cleanly: stages are far shorter than a full counter period.
+  perfRecordUs(stage, (halCycleCount() - startCycles) / halCyclesPerMicrosecond());
+#else
+  (void)stage;
+  (void)startCycles;
+#endif
+}
+
+void perfRecordUs(PerfStage stage, uint32_t us) {
+#if ENABLE_PERF_STATS
+  const size_t index = (size_t)stage;
+  if (index >= STAGE_COUNT) return;
+  PerfStageStats &stats = s_stats[index];
+  if (stats.count == 0 || us < stats.minUs) stats.minUs = us;
+  if (us > stats.maxUs) stats.maxUs = us;
+  stats.totalUs += us;
+  stats.histogram[histogramBucket(us)]++;
+  stats.count++;
+#else
+  (void)stage;
+  (void)us;
+#endif
+}
+
+void getPerfStageStats(PerfStage stage, PerfStageStats &out) {
+  const size_t index = (size_t)stage;
+  if (index >= STAGE_COUNT) {
+    memset(&out, 0, sizeof(out));
+    return;
+  }
+  out = s_stats[index];
+}
+
+void resetPerfStats() {
+  memset(s_stats, 0, sizeof(s_stats));
+  s_resetMs = halMillis();
+}
+
+uint32_t perfSinceResetMs() { return (uint32_t)(halMillis() - s_resetMs); }
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef ENABLE_PERF_STATS
+#define ENABLE_PERF_STATS 1
+#endif
+
+// Per-stage timing from the CPU cycle counter, reported at /api/perf. Stages nest (LOOP
+// covers one whole loop() pass), so their times do not add up. Recording is a handful of
+// integer operations with no locking: a stage hit from two tasks at the same instant can
+// lose a sample, which is fine for diagnostics.
+enum class PerfStage : uint8_t {
+  LOOP,
+  ESC_TELEMETRY,
+  WIFI_PROVISIONING,
+  LIVE_TELEMETRY,
+  TEST_RUNNER,
+  JSON_ENCODE,
+  WS_SEND,
+  FS_WRITE,
+  SAFETY_CHECK_GAP, // time between consecutive safety checks during a run
+  COUNT
+};
+
+// Bucket 0 counts durations under 1 us, bucket i (i >= 1) those in [2^(i-1), 2^i) us; the
+// last bucket also takes everything longer.
+static const size_t PERF_HISTOGRAM_BUCKETS = 20;
+
+struct PerfStageStats {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+  uint32_t histogram[PERF_HISTOGRAM_BUCKETS];
+};
+
+const char *perfStageName(PerfStage stage);
+uint32_t perfNow();
+void perfEnd(PerfStage stage, uint32_t startCycles);
+void perfRecordUs(PerfStage stage, uint32_t us);
+void getPerfStageStats(PerfStage stage, PerfStageStats &out);
+void resetPerfStats();
+uint32_t perfSinceResetMs();
+
+// Times the enclosing scope.
+class PerfScope {
+ public:
+  explicit PerfScope(PerfStage stage) : stage_(stage), start_(perfNow()) {}
+  ~PerfScope() { perfEnd(stage_, start_); }
+  PerfScope(const PerfScope &) = delete;
+  PerfScope &operator=(const PerfScope &) = delete;
+
+ private:
+  PerfStage stage_;
+  uint32_t start_;
+};
+
+#if ENABLE_PERF_STATS
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+#define PERF_SCOPE(stage) PerfScope PERF_CONCAT(perfScope_, __LINE__)(PerfStage::stage)
+#else
+#define PERF_SCOPE(stage) \
+  do {                    \
+  } while (0)
+#endif
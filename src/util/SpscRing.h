@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free single-producer/single-consumer ring buffer.
+// push() may only be called from one task/ISR and pop()/clear() from one other task.
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+ public:
+  bool push(const T &item) {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    const uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail >= N) return false;
+    items_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T &out) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    const uint32_t head = head_.load(std::memory_order_acquire);
+    if (tail == head) return false;
+    out = items_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: discard everything currently queued.
+  void clear() { tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release); }
+
+  size_t size() const {
+    return (size_t)(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+  }
+
+  static constexpr size_t capacity() { return N; }
+
+ private:
+  T items_[N];
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+};
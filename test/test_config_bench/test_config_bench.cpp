@@ -0,0 +1,79 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "config/BoardConfig.h"
+
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Config parse benchmark: time and heap allocations for validating the full default
+// board.cfg, which /api/config and /api/config/validate do inside the async web task.
+// Run with: pio test -e native -f test_config_bench
+
+static size_t s_allocations = 0;
+
+void *operator new(size_t size) {
+  s_allocations++;
+  void *p = malloc(size ? size : 1);
+  if (!p) abort();
+  return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+struct TextBuffer : public Print {
+  char text[8192];
+  size_t len = 0;
+  size_t write(uint8_t c) override {
+    if (len + 1 >= sizeof(text)) return 0;
+    text[len++] = (char)c;
+    text[len] = '\0';
+    return 1;
+  }
+  using Print::write;
+};
+
+static TextBuffer s_defaultText;
+
+static void test_config_parse_benchmark() {
+  printDefaultBoardConfig(s_defaultText);
+  const int iterations = 2000;
+  BoardConfig cfg;
+  const size_t allocationsBefore = s_allocations;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    setBoardConfigDefaults(cfg);
+    TEST_ASSERT_TRUE(parseConfigContent(s_defaultText.text, cfg, true));
+  }
+  const auto end = std::chrono::steady_clock::now();
+  const size_t allocations = s_allocations - allocationsBefore;
+  const double usPerParse = std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+
+  char message[128];
+  snprintf(message, sizeof(message), "default board.cfg (%u bytes): %.2f us/parse, %.2f allocations/parse",
+           (unsigned)s_defaultText.len, usPerParse, (double)allocations / iterations);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+static int runBenchmarks() {
+  UNITY_BEGIN();
+  RUN_TEST(test_config_parse_benchmark);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+  delay(2000);
+  runBenchmarks();
+}
+
+void loop() {}
+#else
+int main() { return runBenchmarks(); }
+#endif
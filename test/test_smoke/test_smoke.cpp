@@ -3,7 +3,24 @@
 
 #include "AppState.h"
 #include "config/BoardConfig.h"
+#include "esc/DshotTelemetry.h"
+#include "esc/EscOutput.h"
+#include "hal/Hal.h"
+#include "net/LiveTelemetry.h"
+#include "net/RequestBody.h"
+#include "net/StaticAssets.h"
+#include "net/WebSocketUtils.h"
+#include "scale/LoadCellManager.h"
+#include "sim/SimRunner.h"
+#include "storage/ResultQuery.h"
+#include "storage/RunHistory.h"
+#include "telemetry/KissTelemetry.h"
+#include "test/SampleRateStats.h"
+#include "test/SampleStore.h"
+#include "test/StepStats.h"
 #include "test/TestRunner.h"
+#include "test/ThrustPid.h"
+#include "util/Perf.h"
 
 static void test_parse_sequence_ok() {
   AppState state;
@@ -88,8 +105,1068 @@ static void test_config_parse_detailed_invalid_value() {
   TEST_ASSERT_EQUAL_STRING("Invalid value", message);
 }
 
-void setup() {
-  delay(2000);
+static void test_config_hx711_rate() {
+  BoardConfig cfg;
+  setBoardConfigDefaults(cfg);
+  TEST_ASSERT_EQUAL_INT(-1, cfg.hx711_rate_pin);
+  TEST_ASSERT_TRUE(parseConfigContent("[pins]\nHX711_RATE_PIN = 23\n[scale]\nHX711_RATE = 80\n", cfg, true));
+  TEST_ASSERT_EQUAL_INT(23, cfg.hx711_rate_pin);
+  TEST_ASSERT_EQUAL_INT(80, cfg.hx711_rate);
+  TEST_ASSERT_TRUE(parseConfigContent("[pins]\nHX711_RATE_PIN = -1\n", cfg, true));
+  TEST_ASSERT_EQUAL_INT(-1, cfg.hx711_rate_pin);
+  TEST_ASSERT_FALSE(parseConfigContent("[scale]\nHX711_RATE = 40\n", cfg, true));
+  TEST_ASSERT_FALSE(parseConfigContent("[pins]\nHX711_RATE_PIN = 36\n", cfg, true));
+}
+
+struct ConfigTextBuffer : public Print {
+  String text;
+  size_t write(uint8_t c) override {
+    text += (char)c;
+    return 1;
+  }
+  using Print::write;
+};
+
+static void test_config_default_text_round_trip() {
+  // The default file is generated from the same key table the parser uses.
+  ConfigTextBuffer out;
+  printDefaultBoardConfig(out);
+  BoardConfig defaults;
+  setBoardConfigDefaults(defaults);
+  BoardConfig parsed;
+  memset(&parsed, 0, sizeof(parsed));
+  TEST_ASSERT_TRUE(parseConfigContent(out.text.c_str(), parsed, true));
+  TEST_ASSERT_EQUAL_INT(0, memcmp(&defaults, &parsed, sizeof(defaults)));
+  TEST_ASSERT_EQUAL_INT(14, parsed.motor_poles);
+  TEST_ASSERT_EQUAL_STRING("ThrustScale_Setup", parsed.wifi_ap_name);
+
+  TEST_ASSERT_FALSE(parseConfigContent("[esc]\nMOTOR_POLES = 13\n", parsed, true));
+  TEST_ASSERT_FALSE(parseConfigContent("[esc_telem]\nTELEM_SCALE = 0\n", parsed, true));
+  TEST_ASSERT_FALSE(parseConfigContent("[pins]\nPWM_FREQ = 400\n", parsed, true)); // wrong section
+  TEST_ASSERT_TRUE(parseConfigContent("  [ESC]  \r\n  PWM_FREQ=  480  \r\n", parsed, true));
+  TEST_ASSERT_EQUAL_INT(480, parsed.pwm_freq);
+}
+
+struct ConfigChangeRecord {
+  int live;
+  int reboot;
+  char lastLive[32];
+};
+
+static void recordConfigChange(const char *section, const char *key, bool live, void *arg) {
+  (void)section;
+  ConfigChangeRecord *record = static_cast<ConfigChangeRecord *>(arg);
+  if (live) {
+    record->live++;
+    strncpy(record->lastLive, key, sizeof(record->lastLive) - 1);
+  } else {
+    record->reboot++;
+  }
+}
+
+static void test_config_live_apply() {
+  BoardConfig running;
+  setBoardConfigDefaults(running);
+  BoardConfig next;
+  setBoardConfigDefaults(next);
+  TEST_ASSERT_TRUE(parseConfigContent("[pins]\nESC_PIN = 25\n[safety]\nSAFETY_PWM_THRESHOLD = 1300\n"
+                                      "[wifi]\nWIFI_AP_NAME = ThrustScale_Setup\n",
+                                      next, true));
+  ConfigChangeRecord record = {};
+  TEST_ASSERT_EQUAL_UINT32(2, forEachChangedConfigKey(running, next, recordConfigChange, &record));
+  TEST_ASSERT_EQUAL_INT(1, record.live);
+  TEST_ASSERT_EQUAL_INT(1, record.reboot);
+  TEST_ASSERT_EQUAL_STRING("SAFETY_PWM_THRESHOLD", record.lastLive);
+
+  TEST_ASSERT_EQUAL_UINT32(1, applyLiveConfigKeys(running, next));
+  TEST_ASSERT_EQUAL_INT(1300, running.safety_pwm_threshold);
+  TEST_ASSERT_EQUAL_INT(27, running.esc_pin); // pins wait for a reboot
+  TEST_ASSERT_EQUAL_UINT32(0, applyLiveConfigKeys(running, next));
+
+  // Saves are diffed against the file, not the running config clamped to the heap.
+  File f = halFs().open(getBoardConfigPath(), "w");
+  f.print("[test]\nMAX_TEST_SAMPLES = 80000\n");
+  f.close();
+  TEST_ASSERT_TRUE(loadBoardConfig(running));
+  halFs().remove(getBoardConfigPath());
+  running.max_test_samples = 1000;
+  BoardConfig saved = next;
+  saved.max_test_samples = 80000;
+  record = {};
+  TEST_ASSERT_EQUAL_UINT32(2, queueLiveBoardConfig(saved, recordConfigChange, &record));
+  TEST_ASSERT_EQUAL_INT(1, record.live);
+  TEST_ASSERT_EQUAL_STRING("SAFETY_PWM_THRESHOLD", record.lastLive);
+  // Saved again: nothing new to apply, but the pin still waits for a reboot.
+  record = {};
+  TEST_ASSERT_EQUAL_UINT32(1, queueLiveBoardConfig(saved, recordConfigChange, &record));
+  TEST_ASSERT_EQUAL_INT(0, record.live);
+  TEST_ASSERT_EQUAL_INT(1, record.reboot);
+  BoardConfig queued;
+  TEST_ASSERT_TRUE(takeQueuedBoardConfig(queued));
+  TEST_ASSERT_EQUAL_UINT32(80000, queued.max_test_samples);
+  TEST_ASSERT_FALSE(takeQueuedBoardConfig(queued));
+  // Live keys queued during a run are reported as pending until it ends.
+  TEST_ASSERT_TRUE(testHoldsConfig(State::RUNNING_SEQUENCE));
+  TEST_ASSERT_TRUE(testHoldsConfig(State::FINALIZING));
+  TEST_ASSERT_FALSE(testHoldsConfig(State::IDLE));
+}
+
+static void test_config_stream_chunks() {
+  ConfigTextBuffer out;
+  printDefaultBoardConfig(out);
+  out.text += "[esc]\nPWM_FREQ = 480\n[wifi]\nWIFI_AP_NAME = Bench"; // last line without newline
+  const char *text = out.text.c_str();
+  const size_t total = out.text.length();
+
+  // Every chunk size gives the same config, whether lines are split or not.
+  for (size_t chunk = 1; chunk <= 97; chunk += 12) {
+    AsyncWebServerRequest request;
+    for (size_t index = 0; index < total; index += chunk) {
+      const size_t len = (total - index < chunk) ? total - index : chunk;
+      const RequestBodyResult result = collectRequestBody(&request, reinterpret_cast<const uint8_t *>(text) + index,
+                                                          len, index, total, 8192, sizeof(ConfigStreamParser), true);
+      TEST_ASSERT_TRUE(result == (index + len == total ? RequestBodyResult::COMPLETE : RequestBodyResult::PARTIAL));
+      ConfigStreamParser *parser = static_cast<ConfigStreamParser *>(requestBodyState(&request));
+      TEST_ASSERT_NOT_NULL(parser);
+      static BoardConfig cfg;
+      if (index == 0) {
+        setBoardConfigDefaults(cfg);
+        configStreamBegin(*parser, cfg, true);
+      }
+      TEST_ASSERT_TRUE(configStreamFeed(*parser, text + index, len));
+      if (result == RequestBodyResult::COMPLETE) {
+        TEST_ASSERT_TRUE(configStreamEnd(*parser));
+        TEST_ASSERT_EQUAL_INT(480, cfg.pwm_freq);
+        TEST_ASSERT_EQUAL_STRING("Bench", cfg.wifi_ap_name);
+      }
+    }
+    size_t bodyLen = 0;
+    const char *body = requestBodyText(&request, bodyLen);
+    TEST_ASSERT_EQUAL_UINT32(total, bodyLen);
+    TEST_ASSERT_EQUAL_STRING(text, body);
+  }
+
+  // Errors point at the key even when its line was split; later chunks are ignored.
+  BoardConfig cfg;
+  setBoardConfigDefaults(cfg);
+  ConfigStreamParser parser;
+  configStreamBegin(parser, cfg, true);
+  const char *first = "[esc]\nPWM_RESO";
+  const char *second = "LUTION = 32\nPWM_FREQ = 100\n";
+  TEST_ASSERT_TRUE(configStreamFeed(parser, first, strlen(first)));
+  TEST_ASSERT_FALSE(configStreamFeed(parser, second, strlen(second)));
+  TEST_ASSERT_EQUAL_STRING("esc", parser.section);
+  TEST_ASSERT_EQUAL_STRING("PWM_RESOLUTION", parser.errKey);
+  TEST_ASSERT_EQUAL_INT(400, cfg.pwm_freq);
+
+  AsyncWebServerRequest request;
+  TEST_ASSERT_TRUE(collectRequestBody(&request, nullptr, 0, 0, 9000, 8192, 0, true) == RequestBodyResult::TOO_LARGE);
+  TEST_ASSERT_TRUE(collectRequestBody(&request, reinterpret_cast<const uint8_t *>(text), 10, 10, total, 8192, 0, true) ==
+                   RequestBodyResult::DROPPED);
+}
+
+static void writeTestFile(const char *path, const char *content) {
+  File f = halFs().open(path, "w");
+  TEST_ASSERT_TRUE((bool)f);
+  f.print(content);
+  f.close();
+}
+
+static void test_static_asset_etags() {
+  writeTestFile("/index.html.gz", "gzip bytes v1");
+  writeTestFile("/wifi_setup.html", "<html>setup</html>");
+  halFs().remove("/wifi_setup.html.gz");
+  initStaticAssets(halFs());
+
+  const StaticAsset *index = findStaticAsset("/index.html");
+  TEST_ASSERT_NOT_NULL(index);
+  TEST_ASSERT_TRUE(index->gzip);
+  TEST_ASSERT_EQUAL_STRING("/index.html.gz", index->filePath);
+  TEST_ASSERT_EQUAL_UINT32(18, strlen(index->etag));
+  const StaticAsset *setup = findStaticAsset("/wifi_setup.html");
+  TEST_ASSERT_NOT_NULL(setup);
+  TEST_ASSERT_FALSE(setup->gzip);
+  TEST_ASSERT_TRUE(strcmp(index->etag, setup->etag) != 0);
+  TEST_ASSERT_NULL(findStaticAsset("/board.cfg"));
+
+  char etag[20];
+  strcpy(etag, index->etag);
+  char header[64];
+  snprintf(header, sizeof(header), "\"other\", W/%s", etag);
+  TEST_ASSERT_TRUE(etagMatches(header, etag));
+  TEST_ASSERT_TRUE(etagMatches("*", etag));
+  TEST_ASSERT_FALSE(etagMatches("\"other\"", etag));
+  TEST_ASSERT_FALSE(etagMatches("", etag));
+
+  // New page contents, new tag.
+  writeTestFile("/index.html.gz", "gzip bytes v2");
+  initStaticAssets(halFs());
+  TEST_ASSERT_TRUE(strcmp(etag, findStaticAsset("/index.html")->etag) != 0);
+}
+
+static void test_esc_output_encoders() {
+  BoardConfig cfg;
+  setBoardConfigDefaults(cfg);
+  EscOutputPlan plan;
+  cfg.pwm_freq = 50;
+  planEscOutput(cfg, plan);
+  TEST_ASSERT_EQUAL_UINT32(4915, escAnalogDuty(plan, 1500)); // 65535 * 1500 / 20000
+
+  TEST_ASSERT_TRUE(parseConfigContent("[esc]\nESC_PROTOCOL = oneshot125\nPWM_FREQ = 2000\n", cfg, true));
+  planEscOutput(cfg, plan);
+  TEST_ASSERT_EQUAL_INT(15, plan.resolutionBits); // 16 bits do not fit 80 MHz / 2 kHz
+  TEST_ASSERT_UINT32_WITHIN(1, 12288, escAnalogDuty(plan, 1500)); // 187.5 us of 500 us
+
+  cfg.esc_protocol = EscProtocol::DSHOT600;
+  cfg.pwm_freq = 1000;
+  planEscOutput(cfg, plan);
+  TEST_ASSERT_EQUAL_UINT16(0, escDshotThrottle(plan, 1000));
+  TEST_ASSERT_GREATER_THAN(DSHOT_THROTTLE_MIN, escDshotThrottle(plan, 1001));
+  TEST_ASSERT_EQUAL_UINT16(DSHOT_THROTTLE_MAX, escDshotThrottle(plan, 2000));
+  TEST_ASSERT_EQUAL_HEX16(0x82C6, escDshotFrame(1046, false));
+  HalPulse pulses[DSHOT_FRAME_BITS];
+  escDshotPulses(plan, 0x8000, pulses);
+  TEST_ASSERT_EQUAL_UINT16(50, pulses[0].highTicks); // 1.25 us of a 1.67 us bit at 25 ns ticks
+  TEST_ASSERT_EQUAL_UINT16(25, pulses[1].highTicks);
+  TEST_ASSERT_FALSE(parseConfigContent("[esc]\nESC_PROTOCOL = DSHOT1200\n", cfg, true));
+}
+
+static void test_dshot_telemetry_decode() {
+  // DShot600 replies captured at 25 ns ticks (1333 ns per bit, a few ticks of jitter).
+  const uint32_t bitNs = dshotTelemetryBitNs(600000);
+  const uint16_t spinning[] = {50, 163, 55, 49, 106, 56, 108, 111, 110, 102, 56, 47, 54};
+  uint32_t stream = 0;
+  uint16_t value = 0;
+  TEST_ASSERT_TRUE(dshotTelemetryStream(spinning, 13, 25, bitNs, stream));
+  TEST_ASSERT_TRUE(dshotTelemetryValue(stream, value));
+  TEST_ASSERT_EQUAL_HEX16(0x365, value); // 357 << 1 = 714 us per electrical revolution
+  TEST_ASSERT_EQUAL_UINT32(84033, dshotTelemetryErpm(value));
+  TEST_ASSERT_EQUAL_UINT32(12004, dshotErpmToRpm(dshotTelemetryErpm(value), 14));
+
+  const uint16_t badChecksum[] = {51, 162, 50, 50, 112, 54, 109, 109, 108, 107, 57, 49, 104};
+  TEST_ASSERT_TRUE(dshotTelemetryStream(badChecksum, 13, 25, bitNs, stream));
+  TEST_ASSERT_FALSE(dshotTelemetryValue(stream, value));
+
+  const uint16_t stopped[] = {111, 49, 55, 53, 112, 47, 57, 59, 102, 49, 59, 56, 47, 51, 166};
+  TEST_ASSERT_TRUE(dshotTelemetryStream(stopped, 15, 25, bitNs, stream));
+  TEST_ASSERT_TRUE(dshotTelemetryValue(stream, value));
+  TEST_ASSERT_EQUAL_UINT32(0, dshotTelemetryErpm(value));
+
+  // Our own DShot600 frame (0.625/1.25 us pulses) has runs under half a reply bit.
+  const uint16_t ownFrame[] = {25, 42, 50, 17, 25, 42};
+  TEST_ASSERT_FALSE(dshotTelemetryStream(ownFrame, 6, 25, bitNs, stream));
+  // Bidirectional frames carry the inverted checksum.
+  TEST_ASSERT_EQUAL_HEX16(0x82C9, escDshotFrame(1046, false, true));
+}
+
+static void test_kiss_telemetry_parser() {
+  // 42 C, 16.80 V, 12.34 A, 321 mAh, 24500 eRPM.
+  uint8_t frame[KISS_FRAME_LEN] = {42, 0x06, 0x90, 0x04, 0xD2, 0x01, 0x41, 0x00, 0xF5, 0};
+  frame[9] = kissCrc8(frame, 9);
+  KissTelemetryParser parser;
+  kissParserReset(parser);
+  KissTelemetryFrame out = {};
+  uint64_t t = 1000;
+
+  // Line noise right before a frame: resynchronised by sliding past bad checksums.
+  const uint8_t noise[] = {0xFF, 0x00, 0x13};
+  for (uint8_t b : noise) TEST_ASSERT_FALSE(kissParserPush(parser, b, t += 87, out));
+  int completed = 0;
+  for (size_t i = 0; i < KISS_FRAME_LEN; i++) completed += kissParserPush(parser, frame[i], t += 87, out);
+  TEST_ASSERT_EQUAL(1, completed);
+  TEST_ASSERT_EQUAL_UINT8(42, out.temperatureC);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 16.8f, out.voltage);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.34f, out.current);
+  TEST_ASSERT_EQUAL_UINT16(321, out.consumptionMah);
+  TEST_ASSERT_EQUAL_UINT32(24500, out.erpm);
+  TEST_ASSERT_EQUAL_UINT32(1, parser.frames);
+
+  // A corrupted frame after an idle gap counts a checksum error and yields nothing.
+  t += 10000;
+  frame[3] ^= 0x40;
+  completed = 0;
+  for (size_t i = 0; i < KISS_FRAME_LEN; i++) completed += kissParserPush(parser, frame[i], t += 87, out);
+  TEST_ASSERT_EQUAL(0, completed);
+  TEST_ASSERT_TRUE(parser.crcErrors > 0);
+
+  // A partial frame is dropped by the gap before the next one, which then parses and is
+  // stamped with its own first byte.
+  frame[3] ^= 0x40;
+  t += 10000;
+  kissParserReset(parser);
+  for (size_t i = 0; i < 4; i++) kissParserPush(parser, frame[i], t += 87, out);
+  t += 10000;
+  const uint64_t firstUs = t + 87;
+  completed = 0;
+  for (size_t i = 0; i < KISS_FRAME_LEN; i++) completed += kissParserPush(parser, frame[i], t += 87, out);
+  TEST_ASSERT_EQUAL(1, completed);
+  TEST_ASSERT_TRUE(out.atUs == firstUs);
+
+  // Arbitrary bytes never overrun the buffer.
+  uint32_t seed = 12345;
+  for (int i = 0; i < 20000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    kissParserPush(parser, (uint8_t)(seed >> 16), t += (seed >> 8) % 700, out);
+    TEST_ASSERT_TRUE(parser.len < KISS_FRAME_LEN);
+  }
+}
+
+static void test_sample_store_rpm_column() {
+  SampleStore store;
+  TEST_ASSERT_TRUE(store.begin(130, 130 * SAMPLE_STORE_BYTES_PER_SAMPLE, SAMPLE_CHANNEL_RPM));
+  for (int i = 0; i < 130; i++) {
+    DataPoint point = {(unsigned long)(i * 12), 500.0f, 1500, 0, 0.0f, 0.0f, 20000u + (uint32_t)(i % 3) * 10};
+    TEST_ASSERT_TRUE(store.push(point));
+  }
+  SampleStore::Reader reader = store.reader(101);
+  DataPoint point;
+  TEST_ASSERT_TRUE(reader.next(point));
+  TEST_ASSERT_EQUAL_UINT32(20020, point.rpm);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, point.voltage);
+}
+
+static void test_live_frame_binary_layout() {
+  LiveDataFrame frame;
+  frame.timeMs = 0x01020304UL;
+  frame.thrust = 1.5f;
+  frame.pwm = 1500;
+  frame.voltage = 16.0f;
+  frame.current = 2.0f;
+  frame.escTelemStale = true;
+  frame.escTelemAgeMs = 700;
+  uint8_t buf[LIVE_FRAME_SIZE];
+  TEST_ASSERT_EQUAL_UINT32(LIVE_FRAME_SIZE, encodeLiveDataBinary(frame, buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL_UINT8(LIVE_FRAME_TYPE_DATA, buf[0]);
+  TEST_ASSERT_EQUAL_UINT8(LIVE_FRAME_VERSION, buf[1]);
+  TEST_ASSERT_EQUAL_UINT8(0x01, buf[2]);
+  TEST_ASSERT_EQUAL_UINT8(0x04, buf[4]);
+  TEST_ASSERT_EQUAL_UINT8(0x01, buf[7]);
+  float thrust;
+  memcpy(&thrust, buf + 8, sizeof(thrust));
+  TEST_ASSERT_EQUAL_FLOAT(1.5f, thrust);
+  TEST_ASSERT_EQUAL_UINT16(1500, (uint16_t)(buf[12] | (buf[13] << 8)));
+  TEST_ASSERT_EQUAL_UINT32(0, encodeLiveDataBinary(frame, buf, LIVE_FRAME_SIZE - 1));
+}
+
+static void test_ws_channel_subscriptions() {
+  BoardConfig cfg;
+  setBoardConfigDefaults(cfg);
+  AsyncWebSocket ws("/ws");
+  AsyncWebSocketClient *dashboard = ws.addClient();
+  AsyncWebSocketClient *script = ws.addClient();
+  attachWsClientSession(dashboard);
+  attachWsClientSession(script);
+  wsClientSession(dashboard)->channels = WS_CHANNEL_LIVE_DATA | WS_CHANNEL_LOGS;
+  wsClientSession(dashboard)->binaryLive = true;
+  TEST_ASSERT_EQUAL_UINT16(10, setWsLiveRate(*wsClientSession(dashboard), 10));
+  wsClientSession(script)->channels = WS_CHANNEL_RESULTS;
+  TEST_ASSERT_EQUAL_UINT8(WS_CHANNEL_RESULTS, wsChannelFromName("results"));
+  TEST_ASSERT_EQUAL_UINT8(0, wsChannelFromName("everything"));
+  TEST_ASSERT_EQUAL_STRING("live_data", wsChannelName(WS_CHANNEL_LIVE_DATA));
+
+  notifyChannel(ws, cfg, false, WS_CHANNEL_RESULTS, "{\"type\":\"final_results_end\"}");
+  notifyChannel(ws, cfg, false, WS_CHANNEL_LOGS, "{\"type\":\"status\"}");
+  TEST_ASSERT_EQUAL_UINT32(1, script->textFrames.size());
+  TEST_ASSERT_EQUAL_UINT32(1, dashboard->textFrames.size());
+  TEST_ASSERT_EQUAL_STRING("{\"type\":\"status\"}", dashboard->textFrames[0].c_str());
+  // Command replies go through notifyClients and reach the results-only script too.
+  notifyClients(ws, cfg, false, "{\"type\":\"status\", \"message\":\"Scale tared.\"}");
+  TEST_ASSERT_EQUAL_UINT32(2, script->textFrames.size());
+  TEST_ASSERT_EQUAL_STRING("{\"type\":\"status\", \"message\":\"Scale tared.\"}", script->textFrames[1].c_str());
+  TEST_ASSERT_EQUAL_UINT32(2, dashboard->textFrames.size());
+  TEST_ASSERT_TRUE(wsChannelHasClients(ws, cfg, false, WS_CHANNEL_RESULTS));
+  TEST_ASSERT_FALSE(wsChannelHasClients(ws, cfg, false, WS_CHANNEL_STEP_SUMMARY));
+  script->queueFull = true;
+  TEST_ASSERT_TRUE(wsClientsCanQueue(ws, cfg, false, WS_CHANNEL_LIVE_DATA));
+  TEST_ASSERT_FALSE(wsClientsCanQueue(ws, cfg, false, WS_CHANNEL_RESULTS));
+
+  // 10 Hz live rate: 50 ms batches reach the dashboard as every other latest sample only.
+  halSetVirtualClock(true);
+  DataPoint samples[4] = {};
+  LiveBatch batch = {};
+  batch.samples = samples;
+  batch.count = 4;
+  for (int i = 0; i < 6; i++) {
+    for (int j = 0; j < 4; j++) samples[j].timestamp = (unsigned long)(i * 50 + j * 12);
+    publishLiveBatch(ws, cfg, false, batch);
+    halAdvanceClock(50000);
+  }
+  halSetVirtualClock(false);
+  TEST_ASSERT_EQUAL_UINT32(3, dashboard->binaryFrames.size());
+  TEST_ASSERT_EQUAL_UINT32(LIVE_FRAME_SIZE, dashboard->binaryFrames[1].size());
+  TEST_ASSERT_EQUAL_UINT8(LIVE_FRAME_TYPE_DATA, (uint8_t)dashboard->binaryFrames[1][0]);
+  TEST_ASSERT_EQUAL_UINT8(100 + 36, (uint8_t)dashboard->binaryFrames[1][4]);
+  TEST_ASSERT_EQUAL_UINT32(2, dashboard->textFrames.size());
+  TEST_ASSERT_EQUAL_UINT32(2, script->textFrames.size());
+  TEST_ASSERT_EQUAL_UINT32(0, script->binaryFrames.size());
+
+  releaseWsClientSession(dashboard);
+  releaseWsClientSession(script);
+  reapWsClientSessions();
+}
+
+static void test_ws_broadcast_backpressure() {
+  BoardConfig cfg;
+  setBoardConfigDefaults(cfg);
+  AsyncWebSocket ws("/ws");
+  AsyncWebSocketClient *fast = ws.addClient();
+  AsyncWebSocketClient *slow = ws.addClient();
+  attachWsClientSession(fast);
+  attachWsClientSession(slow);
+  wsClientSession(fast)->binaryLive = true;
+  wsClientSession(slow)->binaryLive = true;
+  WsBroadcastStats before;
+  getWsBroadcastStats(before);
+
+  // Everyone receives it: one shared buffer.
+  notifyClients(ws, cfg, false, "{\"type\":\"status\"}");
+  TEST_ASSERT_EQUAL_UINT32(1, ws.sharedBuffers);
+  TEST_ASSERT_EQUAL_UINT32(1, slow->textFrames.size());
+
+  // A saturated client skips live frames and loses anything else sent to it.
+  slow->queueFull = true;
+  LiveDataFrame frame = {};
+  publishLiveData(ws, cfg, false, frame);
+  notifyChannel(ws, cfg, false, WS_CHANNEL_RESULTS, "{\"type\":\"final_results_chunk\"}");
+  TEST_ASSERT_EQUAL_UINT32(1, fast->binaryFrames.size());
+  TEST_ASSERT_EQUAL_UINT32(0, slow->binaryFrames.size());
+  TEST_ASSERT_EQUAL_UINT32(1, slow->textFrames.size());
+  TEST_ASSERT_EQUAL_UINT32(2, fast->textFrames.size());
+  TEST_ASSERT_EQUAL_UINT32(1, wsClientSession(slow)->stats.liveDropped);
+  TEST_ASSERT_EQUAL_UINT32(1, wsClientSession(slow)->stats.dropped);
+  TEST_ASSERT_EQUAL_UINT32(1, wsClientSession(slow)->stats.queued);
+  TEST_ASSERT_EQUAL_UINT32(3, wsClientSession(fast)->stats.queued);
+  // The live frame only went to one of two connected clients, so it was copied.
+  TEST_ASSERT_EQUAL_UINT32(2, ws.sharedBuffers);
+
+  WsBroadcastStats after;
+  getWsBroadcastStats(after);
+  TEST_ASSERT_EQUAL_UINT32(3, after.payloads - before.payloads);
+  TEST_ASSERT_EQUAL_UINT32(2, after.shared - before.shared);
+  TEST_ASSERT_EQUAL_UINT32(1, after.liveDropped - before.liveDropped);
+  TEST_ASSERT_EQUAL_UINT32(1, after.dropped - before.dropped);
+
+  releaseWsClientSession(fast);
+  releaseWsClientSession(slow);
+  reapWsClientSessions();
+}
+
+// Stands in for the async_tcp task accepting a connection while a broadcast is picking targets.
+static bool connectDuringScan(AsyncWebSocketClient *, void *arg) {
+  AsyncWebSocket *ws = static_cast<AsyncWebSocket *>(arg);
+  if (ws->count() == 1) ws->addClient();
+  return true;
+}
+
+static void test_ws_broadcast_late_client() {
+  BoardConfig cfg;
+  setBoardConfigDefaults(cfg);
+  strcpy(cfg.auth_token, "secret");
+  AsyncWebSocket ws("/ws");
+  AsyncWebSocketClient *client = ws.addClient();
+  attachWsClientSession(client);
+  wsClientSession(client)->authorized = true;
+
+  WsBroadcastSpec spec;
+  spec.filter = connectDuringScan;
+  spec.arg = &ws;
+  const char *message = "{\"type\":\"final_results_chunk\"}";
+  TEST_ASSERT_EQUAL_UINT32(1, wsBroadcast(ws, cfg, false, spec, reinterpret_cast<const uint8_t *>(message),
+                                          strlen(message), false));
+  // The newcomer has not authenticated, so the frame must not be shared with it.
+  TEST_ASSERT_EQUAL_UINT32(0, ws.sharedBuffers);
+  TEST_ASSERT_EQUAL_UINT32(1, client->textFrames.size());
+  AsyncWebSocketClient *late = ws.getClients()[1];
+  TEST_ASSERT_EQUAL_UINT32(0, late->textFrames.size());
+
+  // Once nobody else connects the shared buffer is used again for the lone authorized client.
+  ws.removeClient(late);
+  notifyClients(ws, cfg, false, message);
+  TEST_ASSERT_EQUAL_UINT32(1, ws.sharedBuffers);
+  TEST_ASSERT_EQUAL_UINT32(2, client->textFrames.size());
+
+  // A disconnect only detaches the session; loop() frees it.
+  releaseWsClientSession(client);
+  TEST_ASSERT_TRUE(wsClientSession(client) == nullptr);
+  reapWsClientSessions();
+}
+
+static void test_virtual_clock_consistent() {
+  halSetVirtualClock(true);
+  uint64_t last = halMicros64();
+  // Past the 32-bit micros wrap, in steps that leave sub-millisecond remainders.
+  for (int i = 0; i < 5; i++) {
+    halAdvanceClock(999999999u);
+    const uint64_t us = halMicros64();
+    TEST_ASSERT_TRUE(us > last);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)us, halMicros());
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(us / 1000), (uint32_t)halMillis());
+    last = us;
+  }
+  halSetVirtualClock(false);
+}
+
+static void test_tare_filter_long_uptime() {
+  halSetVirtualClock(true);
+  halAdvanceClock(5000);
+  const uint64_t tareDoneUs = halMicros64();
+  TEST_ASSERT_TRUE(sampleBeforeTare(tareDoneUs - 1, tareDoneUs));
+  TEST_ASSERT_FALSE(sampleBeforeTare(tareDoneUs, tareDoneUs));
+  // More than 2^31 us (35.8 min) after the tare, samples must still pass.
+  halAdvanceClock(0x80000000u);
+  halAdvanceClock(1000000u);
+  const uint64_t sampleUs = halMicros64();
+  halSetVirtualClock(false);
+  TEST_ASSERT_TRUE(sampleUs - tareDoneUs > 0x80000000ull);
+  TEST_ASSERT_FALSE(sampleBeforeTare(sampleUs, tareDoneUs));
+  TEST_ASSERT_FALSE(sampleBeforeTare(sampleUs, 0));
+}
+
+static void test_sample_store_round_trip() {
+  SampleStore store;
+  TEST_ASSERT_TRUE(store.begin(200, 200 * SAMPLE_STORE_BYTES_PER_SAMPLE));
+  for (int i = 0; i < 200; i++) {
+    DataPoint point = {(unsigned long)(i * 12), (float)(i % 7) * 1.25f - 3.0f, 1000 + (i / 50) * 100, 0, 0.0f, 0.0f, 0};
+    TEST_ASSERT_TRUE(store.push(point));
+  }
+  TEST_ASSERT_FALSE(store.push({0, 0.0f, 1000, 0, 0.0f, 0.0f, 0}));
+  TEST_ASSERT_EQUAL_UINT32(200, store.size());
+  TEST_ASSERT_LESS_THAN(200 * sizeof(DataPoint) / 2, store.bytesUsed());
+
+  SampleStore::Reader reader = store.reader(130);
+  DataPoint point;
+  TEST_ASSERT_TRUE(reader.next(point));
+  TEST_ASSERT_EQUAL_UINT32(130 * 12, point.timestamp);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, (float)(130 % 7) * 1.25f - 3.0f, point.thrust);
+  TEST_ASSERT_EQUAL_INT(1200, point.pwm);
+}
+
+static void test_sample_store_electrical_column() {
+  SampleStore plain;
+  SampleStore electrical;
+  TEST_ASSERT_TRUE(plain.begin(130, 130 * SAMPLE_STORE_BYTES_PER_SAMPLE));
+  TEST_ASSERT_TRUE(electrical.begin(130, 130 * SAMPLE_STORE_BYTES_PER_SAMPLE, SAMPLE_CHANNEL_ELECTRICAL));
+  for (int i = 0; i < 130; i++) {
+    const float current = (i / 20) * 2.5f;
+    DataPoint point = {(unsigned long)(i * 12), 100.0f + i, 1300, 0, 16.8f, current, 0};
+    TEST_ASSERT_TRUE(plain.push(point));
+    TEST_ASSERT_TRUE(electrical.push(point));
+  }
+  TEST_ASSERT_EQUAL_UINT8(0, plain.channels());
+  // One mask byte per steady row, a few more where the current steps, plus the block starts.
+  TEST_ASSERT_TRUE(electrical.bytesUsed() <= plain.bytesUsed() + 130 + 20 + 3 * 12);
+
+  SampleStore::Reader reader = electrical.reader(70);
+  DataPoint point;
+  TEST_ASSERT_TRUE(reader.next(point));
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, 16.8f, point.voltage);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, 7.5f, point.current);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 126.0f, dataPointPower(point));
+  reader = plain.reader(70);
+  TEST_ASSERT_TRUE(reader.next(point));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, point.voltage);
+
+  // Noisy telemetry changing V and I on every row, by steps up to the sizing limit, fits.
+  TEST_ASSERT_TRUE(electrical.begin(130, 130 * SAMPLE_STORE_BYTES_PER_SAMPLE, SAMPLE_CHANNEL_ELECTRICAL));
+  for (int i = 0; i < 130; i++) {
+    DataPoint noisy = {(unsigned long)(i * 12), 100.0f + i, 1300, 0, (i % 2) ? 16.0f : 10.0f,
+                       (i % 2) ? 30.0f : 1.0f, 0};
+    TEST_ASSERT_TRUE(electrical.push(noisy));
+  }
+  reader = electrical.reader(0);
+  for (int i = 0; i < 130; i++) {
+    TEST_ASSERT_TRUE(reader.next(point));
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, (i % 2) ? 16.0f : 10.0f, point.voltage);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, (i % 2) ? 30.0f : 1.0f, point.current);
+  }
+
+  // Beyond it the column runs short: thrust is still recorded for every sample, and the
+  // electrical values hold until the next block start brings them back.
+  TEST_ASSERT_TRUE(electrical.begin(130, 130 * SAMPLE_STORE_BYTES_PER_SAMPLE, SAMPLE_CHANNEL_ELECTRICAL));
+  for (int i = 0; i < 130; i++) {
+    DataPoint noisy = {(unsigned long)(i * 12), 100.0f + i, 1300, 0, (i % 2) ? 300.0f : 0.0f,
+                       (i % 2) ? 0.0f : 300.0f, 0};
+    TEST_ASSERT_TRUE(electrical.push(noisy));
+  }
+  TEST_ASSERT_EQUAL_UINT32(130, electrical.size());
+  reader = electrical.reader(0);
+  DataPoint previous = {};
+  for (int i = 0; i < 130; i++) {
+    TEST_ASSERT_TRUE(reader.next(point));
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 100.0f + i, point.thrust);
+    const float voltage = (i % 2) ? 300.0f : 0.0f;
+    if (i % SAMPLE_STORE_BLOCK_SIZE == 0) TEST_ASSERT_FLOAT_WITHIN(0.005f, voltage, point.voltage);
+    TEST_ASSERT_TRUE(fabsf(point.voltage - voltage) < 0.005f || point.voltage == previous.voltage);
+    previous = point;
+  }
+}
+
+// Starts the run history from an empty manifest.
+static void resetRunHistory() {
+  halFs().remove("/runs/manifest.bin");
+  halFs().remove("/runs/manifest.tmp");
+  initRunHistory();
+}
+
+static bool runFileExists(uint32_t runId) {
+  char path[RUN_PATH_LEN];
+  snprintf(path, sizeof(path), "/runs/%lu.bin", (unsigned long)runId);
+  return halFs().exists(path);
+}
+
+static uint32_t createClosedRun(uint32_t startMs) {
+  const uint32_t runId = createRunHistoryEntry(1700000000, startMs, 2, "1200 - 1 - 2");
+  char path[RUN_PATH_LEN];
+  if (!runHistoryPath(runId, path, sizeof(path))) return 0;
+  File f = halFs().open(path, "w");
+  f.print("journal");
+  f.close();
+  finishRunHistoryEntry(runId, 100 + runId, 50.0f, JOURNAL_FLAG_CLOSED);
+  return runId;
+}
+
+static void test_run_history_manifest_and_eviction() {
+  resetRunHistory();
+  for (uint32_t i = 1; i <= RUN_HISTORY_SLOTS; i++) TEST_ASSERT_EQUAL_UINT32(i, createClosedRun(i * 1000));
+
+  // The manifest survives a reload, newest first.
+  initRunHistory();
+  RunManifestEntry entries[RUN_HISTORY_SLOTS];
+  TEST_ASSERT_EQUAL_UINT32(RUN_HISTORY_SLOTS, listRunHistory(entries, RUN_HISTORY_SLOTS));
+  TEST_ASSERT_EQUAL_UINT32(RUN_HISTORY_SLOTS, entries[0].runId);
+  TEST_ASSERT_EQUAL_UINT32(1, entries[RUN_HISTORY_SLOTS - 1].runId);
+  TEST_ASSERT_EQUAL_UINT32(100 + RUN_HISTORY_SLOTS, entries[0].sampleCount);
+  TEST_ASSERT_EQUAL_UINT32(RUN_HISTORY_SLOTS * 1000, entries[0].startMs);
+  TEST_ASSERT_EQUAL_STRING("1200 - 1 - 2", entries[0].sequence);
+  TEST_ASSERT_EQUAL_UINT32(RUN_HISTORY_SLOTS, latestRunId());
+
+  // A new run evicts the oldest one and its file.
+  const uint32_t next = createClosedRun(99000);
+  TEST_ASSERT_EQUAL_UINT32(RUN_HISTORY_SLOTS + 1, next);
+  TEST_ASSERT_FALSE(runFileExists(1));
+  char path[RUN_PATH_LEN];
+  TEST_ASSERT_FALSE(runHistoryPath(1, path, sizeof(path)));
+  TEST_ASSERT_EQUAL_UINT32(RUN_HISTORY_SLOTS, listRunHistory(entries, RUN_HISTORY_SLOTS));
+  TEST_ASSERT_EQUAL_UINT32(next, entries[0].runId);
+  TEST_ASSERT_EQUAL_UINT32(2, entries[RUN_HISTORY_SLOTS - 1].runId);
+
+  // A download pins its run: DELETE is refused and eviction keeps the file until unpinned.
+  TEST_ASSERT_EQUAL_UINT32(2, pinRunHistoryEntry(2));
+  TEST_ASSERT_TRUE(deleteRunHistoryEntry(2) == RunDeleteResult::IN_USE);
+  TEST_ASSERT_EQUAL_UINT32(RUN_HISTORY_SLOTS + 2, createClosedRun(100000));
+  TEST_ASSERT_FALSE(runHistoryPath(2, path, sizeof(path)));
+  TEST_ASSERT_TRUE(runFileExists(2));
+  TEST_ASSERT_EQUAL_UINT32(0, pinRunHistoryEntry(RUN_HISTORY_SLOTS + 2)); // slot still held by run 2
+  unpinRunHistoryEntry(2);
+  TEST_ASSERT_FALSE(runFileExists(2));
+  TEST_ASSERT_EQUAL_UINT32(RUN_HISTORY_SLOTS + 2, pinRunHistoryEntry(0));
+  unpinRunHistoryEntry(RUN_HISTORY_SLOTS + 2);
+
+  TEST_ASSERT_TRUE(deleteRunHistoryEntry(3) == RunDeleteResult::DELETED);
+  TEST_ASSERT_FALSE(runFileExists(3));
+  TEST_ASSERT_TRUE(deleteRunHistoryEntry(3) == RunDeleteResult::NOT_FOUND);
+  TEST_ASSERT_EQUAL_UINT32(RUN_HISTORY_SLOTS - 1, listRunHistory(entries, RUN_HISTORY_SLOTS));
+}
+
+static void test_result_journal_recovery() {
+  resetRunHistory();
+  // A run cut short: two valid blocks, then a torn one.
+  const uint32_t runId = createRunHistoryEntry(0, 5000, 1, "1500 - 1 - 1");
+  char path[RUN_PATH_LEN];
+  TEST_ASSERT_TRUE(runHistoryPath(runId, path, sizeof(path)));
+  File f = halFs().open(path, "w");
+  JournalFileHeader header = {};
+  header.magic = JOURNAL_FILE_MAGIC;
+  header.version = JOURNAL_VERSION;
+  header.headerSize = sizeof(header);
+  f.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+  JournalBlock block = {};
+  for (uint32_t seq = 0; seq < 3; seq++) {
+    block.magic = JOURNAL_BLOCK_MAGIC;
+    block.seq = seq == 2 ? 7 : seq;
+    block.count = 10;
+    for (uint16_t i = 0; i < block.count; i++) {
+      block.samples[i].timestamp = seq * 100 + i * 10;
+      block.samples[i].thrust = seq == 1 && i == 4 ? 321.0f : 100.0f;
+    }
+    f.write(reinterpret_cast<const uint8_t *>(&block), sizeof(block));
+  }
+  f.close();
+  RunManifestEntry entries[RUN_HISTORY_SLOTS];
+  TEST_ASSERT_EQUAL_UINT32(1, listRunHistory(entries, RUN_HISTORY_SLOTS));
+  TEST_ASSERT_FALSE(entries[0].flags & JOURNAL_FLAG_CLOSED);
+
+  recoverResultJournal();
+  TEST_ASSERT_EQUAL_UINT32(1, listRunHistory(entries, RUN_HISTORY_SLOTS));
+  TEST_ASSERT_EQUAL_UINT32(20, entries[0].sampleCount);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 321.0f, entries[0].peakThrust);
+  const uint32_t expectedFlags = JOURNAL_FLAG_CLOSED | JOURNAL_FLAG_ABORTED | JOURNAL_FLAG_RECOVERED;
+  TEST_ASSERT_EQUAL_HEX32(expectedFlags, entries[0].flags);
+
+  ResultJournalReader reader;
+  TEST_ASSERT_TRUE(openResultJournalReader(reader, runId));
+  TEST_ASSERT_EQUAL_UINT32(20, reader.header.sampleCount);
+  TEST_ASSERT_EQUAL_UINT32(2, reader.header.blockCount);
+  DataPoint point;
+  uint32_t samples = 0;
+  while (nextResultJournalSample(reader, point)) samples++;
+  TEST_ASSERT_EQUAL_UINT32(20, samples);
+  TEST_ASSERT_TRUE(deleteRunHistoryEntry(runId) == RunDeleteResult::DELETED);
+}
+
+static void test_min_max_downsampler_keeps_spike() {
+  MinMaxDownsampler downsampler;
+  downsampler.begin(0, 99, 10);
+  DataPoint out[2];
+  size_t total = 0;
+  bool sawSpike = false;
+  unsigned long lastTime = 0;
+  for (int i = 0; i < 100; i++) {
+    DataPoint point = {(unsigned long)i, i == 50 ? 1000.0f : (float)(i % 7), 1100, 0, 0.0f, 0.0f, 0};
+    size_t n = downsampler.push(point, out);
+    for (size_t k = 0; k < n; k++) {
+      if (out[k].thrust == 1000.0f) sawSpike = true;
+      TEST_ASSERT_TRUE(total + k == 0 || out[k].timestamp > lastTime);
+      lastTime = out[k].timestamp;
+    }
+    total += n;
+  }
+  total += downsampler.finish(out);
+  TEST_ASSERT_TRUE(sawSpike);
+  TEST_ASSERT_TRUE(total <= 10);
+}
+
+static void test_step_stats_stable_window() {
+  StepStats stats;
+  stats.begin(0, 1500);
+  // Spin-up samples only feed settling; the stable window alternates 99/101 g at 10 V, 2 A.
+  for (int i = 0; i < 10; i++) stats.add(i * 10, false, i * 10.0f, true, 10.0f, 2.0f, 1500);
+  for (int i = 0; i < 100; i++) stats.add(100 + i * 10, true, (i % 2) ? 101.0f : 99.0f, true, 10.0f, 2.0f, 1500);
+  StepSummary summary = stats.summary();
+  TEST_ASSERT_EQUAL_UINT32(100, summary.samples);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 100.0f, summary.meanThrust);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.005f, summary.stddevThrust);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 99.0f, summary.minThrust);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 101.0f, summary.maxThrust);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 5.0f, summary.gramsPerWatt);
+  // The last ramp sample (90 g at 90 ms) is the last one outside 100 +/- 2 g.
+  TEST_ASSERT_EQUAL_UINT32(100, summary.settleMs);
+
+  // 200 -> 500 g that settles within one sample reports one sample period at 10 and 80 SPS:
+  // the first conversion still shows the previous step, the rest sit within +/- 1 g.
+  const unsigned long periods[] = {100, 12};
+  for (unsigned long period : periods) {
+    stats.begin(1, 1600);
+    stats.add(0, false, 200.0f, false, 0.0f, 0.0f, 1600);
+    for (unsigned long t = period; t < 3000; t += period) {
+      stats.add(t, t >= 1000, ((t / period) % 2) ? 501.0f : 499.0f, false, 0.0f, 0.0f, 1600);
+    }
+    TEST_ASSERT_EQUAL_UINT32(period, stats.summary().settleMs);
+  }
+
+  // A slow approach is followed to the end, past the envelope's capacity.
+  stats.begin(2, 1600);
+  for (unsigned long t = 0; t < 4000; t += 10) {
+    const float thrust = t < 2000 ? 500.0f * (float)t / 2000.0f : 500.0f;
+    stats.add(t, t >= 3000, thrust, false, 0.0f, 0.0f, 1600);
+  }
+  // 490 g (500 - 2 %) is reached at 1960 ms.
+  TEST_ASSERT_EQUAL_UINT32(1960, stats.summary().settleMs);
+}
+
+static void test_sim_runner_repeatable() {
+  BoardConfig cfg;
+  setBoardConfigDefaults(cfg);
+  cfg.sim_enabled = true;
+  cfg.sim_seed = 42;
+  AsyncWebSocket ws("/sim");
+  SimRunOptions options;
+  SimRunResult first, second;
+  AppState a, b;
+  TEST_ASSERT_TRUE(runSimulatedSequence(a, cfg, ws, "1200 - 1 - 2; 1400 - 0 - 1", options, first));
+  TEST_ASSERT_TRUE(runSimulatedSequence(b, cfg, ws, "1200 - 1 - 2; 1400 - 0 - 1", options, second));
+  TEST_ASSERT_TRUE(first.completed);
+  TEST_ASSERT_TRUE(first.samples > 0);
+  TEST_ASSERT_TRUE(first.simulatedMs >= 4000);
+  TEST_ASSERT_EQUAL_UINT32(first.samples, second.samples);
+  TEST_ASSERT_EQUAL_HEX32(first.digest, second.digest);
+  // One 1 ms tick per pass, and the whole run takes less wall time than it simulates.
+  TEST_ASSERT_EQUAL_UINT32(first.ticks, second.ticks);
+  TEST_ASSERT_EQUAL_UINT32(first.simulatedMs, first.ticks);
+  TEST_ASSERT_TRUE(first.wallUs > 0);
+  TEST_ASSERT_TRUE(first.wallUs < (uint64_t)first.simulatedMs * 1000);
+  TEST_ASSERT_TRUE(first.ticksPerSecond > 1000.0f);
+  TEST_ASSERT_FALSE(halVirtualClockEnabled());
+}
+
+static void test_sim_zero_spinup_steps() {
+  BoardConfig cfg;
+  setBoardConfigDefaults(cfg);
+  cfg.sim_enabled = true;
+  cfg.sim_seed = 7;
+  AsyncWebSocket ws("/sim");
+  std::vector<DataPoint> points;
+  SimRunOptions options;
+  options.points = &points;
+  SimRunResult result;
+  AppState state;
+  // Steps without spin-up jump straight to their PWM and still end on time.
+  TEST_ASSERT_TRUE(runSimulatedSequence(state, cfg, ws, "1300 - 0 - 1; 1500 - 0 - 1", options, result));
+  TEST_ASSERT_TRUE(result.completed);
+  TEST_ASSERT_TRUE(result.simulatedMs < cfg.pre_test_tare_spinup_ms + cfg.pre_test_tare_settle_ms + 2500);
+  TEST_ASSERT_TRUE(points.size() > 0);
+  TEST_ASSERT_EQUAL_INT(1300, points.front().pwm);
+  TEST_ASSERT_EQUAL_INT(1500, points.back().pwm);
+}
+
+static uint32_t frameU32(const std::string &frame, size_t at) {
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(frame.data()) + at;
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t frameU16(const std::string &frame, size_t at) {
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(frame.data()) + at;
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void test_sim_live_batches_contiguous() {
+  BoardConfig cfg;
+  setBoardConfigDefaults(cfg);
+  cfg.sim_enabled = true;
+  cfg.sim_seed = 42;
+  AsyncWebSocket ws("/sim");
+  AsyncWebSocketClient *client = ws.addClient();
+  attachWsClientSession(client);
+  wsClientSession(client)->binaryLive = true;
+  std::vector<DataPoint> points;
+  SimRunOptions options;
+  options.points = &points;
+  SimRunResult result;
+  AppState state;
+  TEST_ASSERT_TRUE(runSimulatedSequence(state, cfg, ws, "1200 - 1 - 2; 1400 - 0 - 1", options, result));
+  TEST_ASSERT_TRUE(result.completed);
+
+  // Each batch starts where the previous one ended, and together they replay every recorded point once.
+  size_t next = 0;
+  size_t batches = 0;
+  for (const std::string &frame : client->binaryFrames) {
+    if ((uint8_t)frame[0] != LIVE_FRAME_TYPE_BATCH) continue;
+    const uint16_t count = frameU16(frame, 8);
+    TEST_ASSERT_EQUAL_UINT32(next, frameU32(frame, 4));
+    TEST_ASSERT_TRUE(count > 0 && count <= LIVE_BATCH_MAX_SAMPLES);
+    TEST_ASSERT_EQUAL_UINT32(LIVE_BATCH_HEADER_SIZE + count * LIVE_BATCH_SAMPLE_SIZE, frame.size());
+    for (uint16_t i = 0; i < count; i++) {
+      const size_t at = LIVE_BATCH_HEADER_SIZE + i * LIVE_BATCH_SAMPLE_SIZE;
+      TEST_ASSERT_TRUE(next + i < points.size());
+      TEST_ASSERT_EQUAL_UINT32(points[next + i].timestamp, frameU32(frame, at));
+      TEST_ASSERT_EQUAL_UINT16(points[next + i].pwm, frameU16(frame, at + 8));
+    }
+    next += count;
+    batches++;
+  }
+  TEST_ASSERT_TRUE(batches > 1);
+  TEST_ASSERT_EQUAL_UINT32(points.size(), next);
+
+  releaseWsClientSession(client);
+  reapWsClientSessions();
+}
+
+static void fillFinalizingRun(AppState &state, size_t points) {
+  state.testResults.begin(points, points * SAMPLE_STORE_BYTES_PER_SAMPLE);
+  for (size_t i = 0; i < points; i++) state.testResults.push({(unsigned long)(i * 10), 1.0f, 1300, 0, 0.0f, 0.0f, 0});
+  state.currentState = State::FINALIZING;
+  state.finalizeCursor = 0;
+  state.finalizeProgressMs = halMillis();
+}
+
+// Start indices of the final_results_chunk frames; anything else counts as final_results_end.
+static void collectFinalFrames(const AsyncWebSocketClient *client, std::vector<unsigned> &chunks, size_t &ends) {
+  chunks.clear();
+  ends = 0;
+  for (const std::string &frame : client->textFrames) {
+    unsigned index = 0;
+    if (sscanf(frame.c_str(), "{\"type\":\"final_results_chunk\",\"index\":%u", &index) == 1) {
+      chunks.push_back(index);
+    } else {
+      ends++;
+    }
+  }
+}
+
+static void test_final_results_cursor() {
+  BoardConfig cfg;
+  setBoardConfigDefaults(cfg);
+  AsyncWebSocket ws("/ws");
+  AsyncWebSocketClient *fast = ws.addClient();
+  AsyncWebSocketClient *slow = ws.addClient();
+  attachWsClientSession(fast);
+  attachWsClientSession(slow);
+  std::vector<unsigned> chunks;
+  size_t ends = 0;
+  halSetVirtualClock(true);
+
+  // 100 points go out 36 at a time, two chunks per tick; a full queue pauses the cursor.
+  AppState state;
+  fillFinalizingRun(state, 100);
+  tickTestRunner(state, cfg, true, nullptr, ws);
+  TEST_ASSERT_EQUAL_UINT32(72, state.finalizeCursor);
+  slow->queueFull = true;
+  for (int i = 0; i < 3; i++) {
+    halAdvanceClock(1000000);
+    tickTestRunner(state, cfg, true, nullptr, ws);
+  }
+  TEST_ASSERT_EQUAL_UINT32(72, state.finalizeCursor);
+  TEST_ASSERT_TRUE(state.currentState == State::FINALIZING);
+  slow->queueFull = false;
+  for (int i = 0; i < 3; i++) tickTestRunner(state, cfg, true, nullptr, ws);
+  TEST_ASSERT_TRUE(state.currentState == State::IDLE);
+  collectFinalFrames(fast, chunks, ends);
+  TEST_ASSERT_EQUAL_UINT32(3, chunks.size());
+  TEST_ASSERT_EQUAL_UINT32(0, chunks[0]);
+  TEST_ASSERT_EQUAL_UINT32(36, chunks[1]);
+  TEST_ASSERT_EQUAL_UINT32(72, chunks[2]);
+  TEST_ASSERT_EQUAL_UINT32(1, ends);
+  collectFinalFrames(slow, chunks, ends);
+  TEST_ASSERT_EQUAL_UINT32(3, chunks.size());
+  TEST_ASSERT_EQUAL_UINT32(1, ends);
+
+  // A client that never drains ends the transfer after the stall timeout, once.
+  fast->textFrames.clear();
+  AppState stalled;
+  fillFinalizingRun(stalled, 100);
+  slow->queueFull = true;
+  tickTestRunner(stalled, cfg, true, nullptr, ws);
+  halAdvanceClock(4999000);
+  tickTestRunner(stalled, cfg, true, nullptr, ws);
+  TEST_ASSERT_TRUE(stalled.currentState == State::FINALIZING);
+  halAdvanceClock(1000);
+  for (int i = 0; i < 3; i++) tickTestRunner(stalled, cfg, true, nullptr, ws);
+  TEST_ASSERT_TRUE(stalled.currentState == State::IDLE);
+  TEST_ASSERT_EQUAL_UINT32(0, stalled.testResults.size());
+  collectFinalFrames(fast, chunks, ends);
+  TEST_ASSERT_EQUAL_UINT32(0, chunks.size());
+  TEST_ASSERT_EQUAL_UINT32(1, ends);
+
+  halSetVirtualClock(false);
+  releaseWsClientSession(fast);
+  releaseWsClientSession(slow);
+  reapWsClientSessions();
+}
+
+static void test_thrust_pid_limits() {
+  ThrustPidGains gains = {0.2f, 1.0f, 0.0f, 0.0f, 1000, 2000};
+  ThrustPid pid;
+  pid.begin(1000.0f);
+  // Stalled motor: 10 s pinned at full throttle must not wind the integral up.
+  uint64_t t = 0;
+  for (int i = 0; i <= 1000; i++, t += 10000) pid.update(gains, 1000.0f, 0.0f, t);
+  TEST_ASSERT_EQUAL_FLOAT(2000.0f, pid.output());
+  TEST_ASSERT_TRUE(pid.atMaxUs() > 9000000ULL);
+  pid.update(gains, 1000.0f, 1500.0f, t);
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)pid.atMaxUs());
+  TEST_ASSERT_TRUE(pid.output() <= 1900.0f);
+
+  // Rate limit: 100 us/s from 1000 us allows 100 us over one second of samples.
+  gains.slewUsPerS = 100.0f;
+  pid.begin(1000.0f);
+  for (int i = 0; i <= 100; i++) pid.update(gains, 1000.0f, 0.0f, (uint64_t)i * 10000);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 1100.0f, pid.output());
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)pid.atMaxUs());
+}
+
+static void test_sim_thrust_target_step() {
+  BoardConfig cfg;
+  setBoardConfigDefaults(cfg);
+  cfg.sim_enabled = true;
+  cfg.sim_seed = 7;
+  AsyncWebSocket ws("/sim");
+  AppState state;
+  TEST_ASSERT_FALSE(parseAndStoreSequence(state, cfg, "0g - 1 - 1"));
+  state.testSequence.clear();
+  SimRunOptions options;
+  SimRunResult result;
+  TEST_ASSERT_TRUE(runSimulatedSequence(state, cfg, ws, "500g - 4 - 2; 1500 - 1 - 1", options, result));
+  TEST_ASSERT_TRUE(result.completed);
+  TEST_ASSERT_EQUAL_UINT32(2, state.stepSummaries.size());
+  const StepSummary &held = state.stepSummaries[0];
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 500.0f, held.targetThrust);
+  TEST_ASSERT_FLOAT_WITHIN(10.0f, 500.0f, held.meanThrust);
+  // The simulator gives 2 g/us above MIN_PULSE_WIDTH, so 500 g needs about 1250 us.
+  TEST_ASSERT_FLOAT_WITHIN(10.0f, 1250.0f, held.meanPwm);
+  TEST_ASSERT_EQUAL_INT((int)lroundf(held.meanPwm), held.pwm);
+  TEST_ASSERT_TRUE(held.meanCurrent > 0.0f);
+  TEST_ASSERT_EQUAL_INT(1500, state.stepSummaries[1].pwm);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, state.stepSummaries[1].targetThrust);
+
+  // Beyond what the motor can give: stopped after THRUST_PID_MAX_HOLD_MS at full throttle.
+  resetTest(state);
+  cfg.thrust_pid_max_hold_ms = 1000;
+  TEST_ASSERT_TRUE(runSimulatedSequence(state, cfg, ws, "20000g - 10 - 5", options, result));
+  TEST_ASSERT_FALSE(result.completed);
+  TEST_ASSERT_TRUE(state.currentState == State::SAFETY_SHUTDOWN);
+  TEST_ASSERT_TRUE(result.simulatedMs < 10000);
+  TEST_ASSERT_EQUAL_INT(cfg.min_pulse_width, state.currentPwm);
+}
+
+static void test_sim_no_result_buffer() {
+  BoardConfig cfg;
+  setBoardConfigDefaults(cfg);
+  cfg.sim_enabled = true;
+  cfg.max_test_samples = 0; // no buffer can be allocated
+  AsyncWebSocket ws("/sim");
+  AppState state;
+  SimRunOptions options;
+  SimRunResult result;
+  TEST_ASSERT_TRUE(runSimulatedSequence(state, cfg, ws, "1500 - 1 - 1", options, result));
+  TEST_ASSERT_FALSE(result.completed);
+  TEST_ASSERT_TRUE(state.currentState == State::SAFETY_SHUTDOWN);
+  TEST_ASSERT_EQUAL_UINT32(0, result.samples);
+  TEST_ASSERT_EQUAL_INT(cfg.min_pulse_width, state.currentPwm);
+}
+
+static void test_perf_stage_histogram() {
+  resetPerfStats();
+  perfRecordUs(PerfStage::FS_WRITE, 0);
+  perfRecordUs(PerfStage::FS_WRITE, 3);
+  perfRecordUs(PerfStage::FS_WRITE, 1500);
+  PerfStageStats stats;
+  getPerfStageStats(PerfStage::FS_WRITE, stats);
+#if ENABLE_PERF_STATS
+  TEST_ASSERT_EQUAL_UINT32(3, stats.count);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.minUs);
+  TEST_ASSERT_EQUAL_UINT32(1500, stats.maxUs);
+  TEST_ASSERT_EQUAL_UINT32(1503, (uint32_t)stats.totalUs);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.histogram[0]);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.histogram[2]);  // [2, 4) us
+  TEST_ASSERT_EQUAL_UINT32(1, stats.histogram[11]); // [1024, 2048) us
+#endif
+  resetPerfStats();
+  getPerfStageStats(PerfStage::FS_WRITE, stats);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.count);
+}
+
+static void test_sample_rate_stats_gaps() {
+  SampleRateStats rate;
+  rate.begin(0);
+  // 80 SPS with one conversion missed, starting just before the micros() wrap.
+  uint32_t t = 0xFFFFFFFFu - 30000u;
+  for (int i = 0; i < 20; i++) {
+    rate.add(t);
+    t += (i == 10) ? 25000u : 12500u;
+  }
+  SampleRateSummary summary = rate.summary();
+  TEST_ASSERT_EQUAL_UINT32(19, summary.intervals);
+  TEST_ASSERT_EQUAL_UINT32(1, summary.gaps);
+  TEST_ASSERT_EQUAL_UINT32(12500, summary.minUs);
+  TEST_ASSERT_EQUAL_UINT32(25000, summary.maxUs);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 19.0f * 1e6f / (18 * 12500.0f + 25000.0f), summary.sps);
+
+  rate.begin(30000);
+  for (int i = 0; i < 5; i++) rate.add(i * 20000u);
+  TEST_ASSERT_EQUAL_UINT32(0, rate.summary().gaps);
+}
+
+static int runSmokeTests() {
   UNITY_BEGIN();
   RUN_TEST(test_parse_sequence_ok);
   RUN_TEST(test_parse_sequence_invalid);
@@ -98,7 +1175,46 @@ void setup() {
   RUN_TEST(test_config_parse_strict_ok);
   RUN_TEST(test_config_parse_strict_rejects_unknown);
   RUN_TEST(test_config_parse_detailed_invalid_value);
-  UNITY_END();
+  RUN_TEST(test_config_hx711_rate);
+  RUN_TEST(test_config_default_text_round_trip);
+  RUN_TEST(test_config_live_apply);
+  RUN_TEST(test_config_stream_chunks);
+  RUN_TEST(test_static_asset_etags);
+  RUN_TEST(test_esc_output_encoders);
+  RUN_TEST(test_dshot_telemetry_decode);
+  RUN_TEST(test_kiss_telemetry_parser);
+  RUN_TEST(test_sample_store_rpm_column);
+  RUN_TEST(test_live_frame_binary_layout);
+  RUN_TEST(test_virtual_clock_consistent);
+  RUN_TEST(test_tare_filter_long_uptime);
+  RUN_TEST(test_ws_channel_subscriptions);
+  RUN_TEST(test_ws_broadcast_backpressure);
+  RUN_TEST(test_ws_broadcast_late_client);
+  RUN_TEST(test_sample_store_round_trip);
+  RUN_TEST(test_sample_store_electrical_column);
+  RUN_TEST(test_run_history_manifest_and_eviction);
+  RUN_TEST(test_result_journal_recovery);
+  RUN_TEST(test_min_max_downsampler_keeps_spike);
+  RUN_TEST(test_step_stats_stable_window);
+  RUN_TEST(test_sim_runner_repeatable);
+  RUN_TEST(test_sim_zero_spinup_steps);
+  RUN_TEST(test_sim_live_batches_contiguous);
+  RUN_TEST(test_final_results_cursor);
+  RUN_TEST(test_thrust_pid_limits);
+  RUN_TEST(test_sim_thrust_target_step);
+  RUN_TEST(test_sim_no_result_buffer);
+  RUN_TEST(test_perf_stage_histogram);
+  RUN_TEST(test_sample_rate_stats_gaps);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+  delay(2000);
+  runSmokeTests();
 }
 
 void loop() {}
+#else
+int main() { return runSmokeTests(); }
+#endif